@@ -208,6 +208,19 @@ void setup()
   Serial.print("Volume size (Gb):  ");
   Serial.println((float)volumesize / 1024.0);
 
+  // free space, first call may read the whole FAT
+  uint32_t countMicros = micros();
+  int32_t freeClusters = volume.freeClusterCount();
+  countMicros = micros() - countMicros;
+
+  if (freeClusters >= 0)
+  {
+    Serial.print("Free space (Mb):   ");
+    Serial.println((uint32_t)((uint64_t) freeClusters * volume.blocksPerCluster() / 2048));
+    Serial.print("Free count (us):   ");
+    Serial.println(countMicros);
+  }
+
   if (!SD.begin(PIN_SD_SS))
   {
     Serial.println("Initialization failed!");
@@ -0,0 +1,89 @@
+/****************************************************************************************************************************
+  bench_raw.cpp
+
+  RP2040_RawStreamWriter against RP2040_SdFile::write() on a card busy 400
+  bytes after each written block.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// 2 MB in 100 byte records, with 0, 16 and 100 poll() calls between records
+HOST_CASE(raw)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  SPI.setLatency(24, 400);
+  SPI.setLatency(25, 400);
+
+  const uint32_t total = 2000000;
+  uint8_t buf[100];
+  const uint32_t polls[] = { 0, 16, 100 };
+
+  for (uint32_t p = 0; p < sizeof polls / sizeof polls[0]; p++)
+  {
+    RP2040_RawStreamWriter w;
+    RP2040_SdFile::remove(&root, "P9.BIN");
+    SPI.clearStats();
+    CHECK(w.begin(&root, "P9.BIN", 4000000));
+    double t0 = hostSeconds();
+
+    for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, 9);
+      }
+
+      CHECK(w.write(buf, sizeof buf) == sizeof buf);
+
+      // the caller's idle loop
+      for (uint32_t k = 0; k < polls[p]; k++)
+      {
+        CHECK(w.poll());
+      }
+    }
+
+    CHECK(w.finish());
+    double t = hostSeconds() - t0;
+    printf("raw     stream, %3u polls a record: %4u overruns, longest write() %4u us, %6.1f MB/s, CMD25 %u\n",
+           (unsigned) polls[p], (unsigned) w.overrunCount(), (unsigned) w.maxWriteMicros(), total / t / 1e6,
+           (unsigned) SPI.commandCount(25));
+  }
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "P7.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  SPI.clearStats();
+  double t0 = hostSeconds();
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, 7);
+    }
+
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+  }
+
+  CHECK(f.close());
+  double t = hostSeconds() - t0;
+  printf("raw     file write():                                          %6.1f MB/s, CMD24 %u\n",
+         total / t / 1e6, (unsigned) SPI.commandCount(24));
+
+  SPI.setLatency(24, 0);
+  SPI.setLatency(25, 0);
+  CHECK(vol.sync());
+  dev.end();
+}
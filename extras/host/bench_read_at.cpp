@@ -0,0 +1,94 @@
+/****************************************************************************************************************************
+  bench_read_at.cpp
+
+  FAT lookups of RP2040_SdFile::readAt() and writeAt() between appends of
+  a fragmented 5 MB file, against seekSet() and read().
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+static uint32_t fatLookups(RP2040_SdVolume& vol)
+{
+  return vol.fatCacheHitCount() + vol.fatCacheMissCount();
+}
+//------------------------------------------------------------------------------
+// reads at fixed offsets between appends
+HOST_CASE(readAt)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // two files grown in turn, so the chain has a run every cluster or two
+  RP2040_SdFile f;
+  RP2040_SdFile g;
+  CHECK(f.open(&root, "IDX.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(g.open(&root, "OTHER.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  static uint8_t buf[1500];
+  uint8_t rb[32];
+
+  for (uint32_t i = 0; i < sizeof buf; i++)
+  {
+    buf[i] = i;
+  }
+
+  while (f.fileSize() < 5000000)
+  {
+    CHECK(f.write(buf, 1500) == 1500);
+    CHECK(g.write(buf, 700) == 700);
+  }
+
+  CHECK(g.close());
+  CHECK(f.seekEnd());
+
+  uint32_t l0 = fatLookups(vol);
+  double t0 = hostSeconds();
+
+  for (int i = 0; i < 2000; i++)
+  {
+    CHECK(f.seekSet(64));
+    CHECK(f.read(rb, 32) == 32);
+    CHECK(f.seekEnd());
+    CHECK(f.write(buf, 100) == 100);
+  }
+
+  uint32_t l1 = fatLookups(vol);
+  double t1 = hostSeconds();
+
+  for (int i = 0; i < 2000; i++)
+  {
+    CHECK(f.readAt(64, rb, 32) == 32);
+    CHECK(f.write(buf, 100) == 100);
+  }
+
+  uint32_t l2 = fatLookups(vol);
+  double t2 = hostSeconds();
+
+  for (int i = 0; i < 1000; i++)
+  {
+    CHECK(f.readAt(400000, rb, 32) == 32);
+    CHECK(f.writeAt(400040, buf, 16) == 16);
+    CHECK(f.write(buf, 10) == 10);
+  }
+
+  uint32_t l3 = fatLookups(vol);
+
+  printf("readat  2000 reads at 64 between appends: seekSet() %8u FAT lookups %7.2f ms, readAt() %4u FAT lookups %5.2f ms\n",
+         (unsigned) (l1 - l0), (t1 - t0) * 1e3, (unsigned) (l2 - l1), (t2 - t1) * 1e3);
+  printf("readat  readAt(400000) and writeAt(400040) between appends: %.2f FAT lookups a round\n", (l3 - l2) / 1000.0);
+
+  CHECK(f.close());
+  CHECK(vol.sync());
+  dev.end();
+}
@@ -0,0 +1,129 @@
+/****************************************************************************************************************************
+  bench_sd.cpp
+
+  SDClass and File, the only file of host_bench that includes RP2040_SD.h.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+#include "RP2040_SD.h"
+
+//------------------------------------------------------------------------------
+// block reads of a depth 4 path opened 200 times, with 60 siblings at each
+// level so each level searched costs a scan
+HOST_CASE(path)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+
+  CHECK(SD.mkdir("/logs/2026/10/17"));
+  CHECK(SD.mkdir("/logs/2026/10/18"));
+
+  for (int i = 0; i < 60; i++)
+  {
+    char name[40];
+    snprintf(name, sizeof name, "/logs/2026/F%d.TXT", i);
+    File f = SD.open(name, FILE_WRITE);
+    CHECK(f);
+    f.close();
+
+    snprintf(name, sizeof name, "/logs/F%d.TXT", i);
+    f = SD.open(name, FILE_WRITE);
+    CHECK(f);
+    f.close();
+  }
+
+  SPI.clearStats();
+  double t0 = hostSeconds();
+
+  for (int i = 0; i < 200; i++)
+  {
+    File f = SD.open("/logs/2026/10/17/a.csv", FILE_WRITE);
+    CHECK(f);
+    CHECK(f.write((const uint8_t*) "x", 1) == 1);
+    f.close();
+    CHECK(SD.exists("logs/2026/10/17/A.CSV"));
+    CHECK(SD.exists("/LOGS/2026/10/18/"));
+  }
+
+  double t = hostSeconds() - t0;
+  printf("path    %u cached paths: 200 opens of a depth 4 path, %5u block reads, %6.2f ms\n",
+         (unsigned) SD_PATH_CACHE_ENTRIES, (unsigned) (SPI.commandCount(17) + SPI.commandCount(18)), t * 1e3);
+
+  SD.end();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+// a 500 file directory listed with File::openNextFile() and with
+// readDirEntries() in batches of 32
+HOST_CASE(list)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+  CHECK(SD.mkdir("/logs"));
+
+  for (int i = 0; i < 500; i++)
+  {
+    char name[40];
+    snprintf(name, sizeof name, "/logs/L%d.CSV", i);
+    File f = SD.open(name, FILE_WRITE);
+    CHECK(f);
+    CHECK(f.write((const uint8_t*) name, i % 40) == (size_t)(i % 40));
+    f.close();
+  }
+
+  uint32_t size = 0;
+  File dir = SD.open("/logs");
+  CHECK(dir);
+
+  uint32_t handles = SDFilePool.heapCount();
+
+  SPI.clearStats();
+  double t0 = hostSeconds();
+
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+  {
+    size += f.size();
+    f.close();
+  }
+
+  double t = hostSeconds() - t0;
+  printf("list    openNextFile():    %5u bytes in 500 files, %4u block reads, %4u heap handles, %6.2f ms\n",
+         (unsigned) size, (unsigned) (SPI.commandCount(17) + SPI.commandCount(18)),
+         (unsigned) (SDFilePool.heapCount() - handles), t * 1e3);
+
+  dirinfo_t list[32];
+  int n;
+  size = 0;
+  dir.rewindDirectory();
+  handles = SDFilePool.heapCount();
+  SPI.clearStats();
+  t0 = hostSeconds();
+
+  while ((n = dir.readDirEntries(list, 32)) > 0)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      size += list[i].size;
+    }
+  }
+
+  t = hostSeconds() - t0;
+  CHECK(n == 0);
+  printf("list    readDirEntries():  %5u bytes in 500 files, %4u block reads, %4u heap handles, %6.2f ms\n",
+         (unsigned) size, (unsigned) (SPI.commandCount(17) + SPI.commandCount(18)),
+         (unsigned) (SDFilePool.heapCount() - handles), t * 1e3);
+
+  dir.close();
+  SD.end();
+  dev.end();
+}
@@ -0,0 +1,71 @@
+/****************************************************************************************************************************
+  bench_spi.cpp
+
+  SPI transfer() calls and bytes clocked per block for single and multiple
+  block commands.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+static void report(const char* what, uint32_t count)
+{
+  printf("spi     %s %5.1f transfer() calls %6.1f bytes per block\n", what,
+         (double) SPI.transferCalls() / count, (double) SPI.bytesClocked() / count);
+}
+//------------------------------------------------------------------------------
+HOST_CASE(spi)
+{
+  std::string path = hostImage("card.img");
+  hostBlank(path, 8192);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  const uint32_t first = 4000;
+  const uint32_t count = 256;
+  uint8_t buf[512];
+
+  SPI.clearStats();
+
+  for (uint32_t b = first; b < first + count; b++)
+  {
+    CHECK(card.readBlock(b, buf));
+  }
+
+  report("CMD17 read ", count);
+
+  SPI.clearStats();
+  CHECK(card.readStart(first));
+
+  for (uint32_t b = 0; b < count; b++)
+  {
+    CHECK(card.readData(buf));
+  }
+
+  CHECK(card.readStop());
+  report("CMD18 read ", count);
+
+  SPI.clearStats();
+
+  for (uint32_t b = first; b < first + count; b++)
+  {
+    CHECK(card.writeBlock(b, buf));
+  }
+
+  report("CMD24 write", count);
+
+  SPI.clearStats();
+  CHECK(card.writeStart(first, count));
+
+  for (uint32_t b = 0; b < count; b++)
+  {
+    CHECK(card.writeData(buf));
+  }
+
+  CHECK(card.writeStop());
+  report("CMD25 write", count);
+
+  dev.end();
+}
@@ -0,0 +1,98 @@
+/****************************************************************************************************************************
+  bench_stat.cpp
+
+  RP2040_SdFile::statEntries() of 200 names against an open() of each, on
+  FAT32 and exFAT.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// 100 files named by format, 200 names of which half exist
+static void statBench(Sd2Card& card, const char* type, const char* format)
+{
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile dir;
+  CHECK(dir.makeDir(&root, "STAT"));
+
+  char name[40];
+
+  for (int i = 0; i < 100; i++)
+  {
+    snprintf(name, sizeof name, format, i);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&dir, name, O_CREAT | O_WRITE | O_EXCL));
+    CHECK(f.close());
+  }
+
+  std::vector<std::string> names;
+  std::vector<const char*> p;
+  std::vector<dirinfo_t> list(200);
+
+  for (int i = 0; i < 200; i++)
+  {
+    snprintf(name, sizeof name, format, 199 - i);
+    names.push_back(name);
+  }
+
+  for (int i = 0; i < 200; i++)
+  {
+    p.push_back(names[i].c_str());
+  }
+
+  SPI.clearStats();
+  double t0 = hostSeconds();
+  int found = dir.statEntries(p.data(), p.size(), list.data());
+  double t = hostSeconds() - t0;
+  uint32_t reads = SPI.commandCount(17) + SPI.commandCount(18);
+
+  SPI.clearStats();
+  t0 = hostSeconds();
+
+  for (int i = 0; i < 200; i++)
+  {
+    RP2040_SdFile f;
+
+    if (f.open(&dir, p[i], O_READ))
+    {
+      f.close();
+    }
+  }
+
+  double t2 = hostSeconds() - t0;
+  CHECK(found == 100);
+  printf("stat    %-6s 200 names, 100 found: statEntries() %4u block reads %6.2f ms, open() each %5u block reads %6.2f ms\n",
+         type, (unsigned) reads, t * 1e3, (unsigned) (SPI.commandCount(17) + SPI.commandCount(18)), t2 * 1e3);
+
+  CHECK(dir.close());
+  CHECK(vol.sync());
+}
+//------------------------------------------------------------------------------
+HOST_CASE(stat)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+  statBench(card, "FAT32", "F%d.CSV");
+  dev.end();
+
+#if SD_EXFAT
+  path = hostImage("exfat.img");
+  hostFormatExFat(path, 16, 0, false);
+  hostCard(dev, card, path);
+  statBench(card, "exFAT", "log file number %d.csv");
+  dev.end();
+#endif  // SD_EXFAT
+}
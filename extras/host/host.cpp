@@ -0,0 +1,207 @@
+/****************************************************************************************************************************
+  host.cpp
+
+  Case runner and helpers for the host checks and benchmarks, see host.h.
+
+  host_test [case ...]
+  host_bench [case ...]
+
+  Images are created next to the program.  HOST_TOOLS and HOST_PYTHON are set
+  by the Makefile.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <unistd.h>
+
+#include <chrono>
+
+HostCase* HostCase::first_ = NULL;
+HostCase* HostCase::last_ = NULL;
+
+// directory of the running program
+static std::string programDir = ".";
+
+//------------------------------------------------------------------------------
+HostCase::HostCase(const char* name, HostCaseFunction run) : name_(name), run_(run), next_(NULL)
+{
+  if (last_)
+  {
+    last_->next_ = this;
+  }
+  else
+  {
+    first_ = this;
+  }
+
+  last_ = this;
+}
+//------------------------------------------------------------------------------
+int HostCase::runAll(int argc, char** argv)
+{
+  std::string program = argv[0];
+  size_t slash = program.rfind('/');
+
+  if (slash != std::string::npos)
+  {
+    programDir = program.substr(0, slash);
+  }
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool known = false;
+
+    for (HostCase* c = first_; c; c = c->next_)
+    {
+      known |= !strcmp(argv[i], c->name_);
+    }
+
+    if (!known)
+    {
+      printf("unknown case %s, cases are:", argv[i]);
+
+      for (HostCase* c = first_; c; c = c->next_)
+      {
+        printf(" %s", c->name_);
+      }
+
+      printf("\n");
+      return 2;
+    }
+  }
+
+  int count = 0;
+
+  for (HostCase* c = first_; c; c = c->next_)
+  {
+    bool wanted = argc < 2;
+
+    for (int i = 1; i < argc; i++)
+    {
+      wanted |= !strcmp(argv[i], c->name_);
+    }
+
+    if (wanted)
+    {
+      c->run_();
+      count++;
+    }
+  }
+
+  printf("PASS %d cases\n", count);
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+uint8_t hostPattern(uint32_t i, int seed)
+{
+  return (uint8_t)(i * 7 + seed + (i >> 9));
+}
+//------------------------------------------------------------------------------
+std::string hostImage(const char* name)
+{
+  return programDir + "/" + name;
+}
+//------------------------------------------------------------------------------
+void hostBlank(const std::string& path, uint32_t blocks)
+{
+  FILE* f = fopen(path.c_str(), "wb");
+  CHECK(f);
+  fclose(f);
+  CHECK(truncate(path.c_str(), (off_t) blocks * 512) == 0);
+}
+//------------------------------------------------------------------------------
+void hostFormat(const std::string& path, int fatType, int sizeMB, int blocksPerCluster)
+{
+  char args[40];
+  snprintf(args, sizeof args, " %d %d %d > /dev/null", fatType, sizeMB, blocksPerCluster);
+
+  std::string cmd = std::string(HOST_PYTHON " " HOST_TOOLS "/mkfat.py ") + path + args;
+  CHECK(system(cmd.c_str()) == 0);
+}
+//------------------------------------------------------------------------------
+void hostFormatExFat(const std::string& path, int sizeMB, int clusterShift, bool pre)
+{
+  char args[40];
+  snprintf(args, sizeof args, " %d %d%s > /dev/null", sizeMB, clusterShift, pre ? " pre" : "");
+
+  std::string cmd = std::string(HOST_PYTHON " " HOST_TOOLS "/mkexfat.py ") + path + args;
+  CHECK(system(cmd.c_str()) == 0);
+}
+//------------------------------------------------------------------------------
+void hostFsck(const std::string& path)
+{
+  // the file system name in the boot sector
+  char name[8] = {0};
+  FILE* f = fopen(path.c_str(), "rb");
+  CHECK(f);
+  CHECK(fseek(f, 3, SEEK_SET) == 0 && fread(name, 1, sizeof name, f) == sizeof name);
+  fclose(f);
+
+  const char* tool = memcmp(name, "EXFAT   ", 8) ? "/fsck.py " : "/exfsck.py ";
+  std::string cmd = std::string(HOST_PYTHON " " HOST_TOOLS) + tool + path;
+
+  if (system((cmd + " > /dev/null").c_str()) != 0)
+  {
+    // again with the report shown
+    CHECK(system(cmd.c_str()) == 0);
+  }
+}
+//------------------------------------------------------------------------------
+void hostCard(RP2040_FileBlockDevice& dev, Sd2Card& card, const std::string& path, RP2040_SdSpiEmulator& spi)
+{
+  CHECK(dev.begin(path.c_str()));
+
+  spi.setDevice(&dev);
+  spi.setReadError(0XFFFFFFFF);
+  CHECK(card.init(SPI_FULL_SPEED, 17, spi));
+  spi.clearStats();
+}
+//------------------------------------------------------------------------------
+uint32_t hostChainRuns(RP2040_BlockDevice& dev, RP2040_SdVolume& vol, uint32_t cluster, uint32_t* length)
+{
+  uint8_t shift = vol.fatType() == 16 ? 8 : 7;
+  uint32_t eoc = vol.fatType() == 16 ? 0XFFF8 : 0X0FFFFFF8;
+  uint32_t runs = 0;
+  uint32_t prev = 0;
+  *length = 0;
+
+  while (cluster >= 2 && cluster < eoc)
+  {
+    if (cluster != prev + 1)
+    {
+      runs++;
+    }
+
+    uint8_t block[512];
+    CHECK(dev.readBlock(vol.fatStartBlock() + (cluster >> shift), block));
+
+    prev = cluster;
+
+    if (vol.fatType() == 16)
+    {
+      uint16_t e;
+      memcpy(&e, block + 2 * (cluster & 0XFF), 2);
+      cluster = e;
+    }
+    else
+    {
+      memcpy(&cluster, block + 4 * (cluster & 0X7F), 4);
+      cluster &= 0X0FFFFFFF;
+    }
+
+    (*length)++;
+  }
+
+  return runs;
+}
+//------------------------------------------------------------------------------
+double hostSeconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  return HostCase::runAll(argc, argv);
+}
@@ -0,0 +1,84 @@
+/****************************************************************************************************************************
+  host.h
+
+  Helpers shared by the host checks and benchmarks, see extras/host/README.md.
+
+  Each test_*.cpp and bench_*.cpp file adds cases with HOST_CASE().  host_test
+  and host_bench run every case, or the cases named on the command line, in
+  link order.  A failed CHECK() ends the program with exit status 1.
+
+  RP2040_SD.h defines SD and the File and SDClass members, so a program can
+  include it from one file only: test_sd.cpp in host_test, bench_sd.cpp in
+  host_bench.  The other files use the RP2040_Sd* classes.
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "utility/SdFat.h"
+#include "utility/RawStreamWriter.h"
+#include "FileBlockDevice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+/** End the program with exit status 1 if \a x is false. */
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+typedef void (*HostCaseFunction)();
+
+/** A named check or benchmark, see HOST_CASE(). */
+class HostCase
+{
+  public:
+    HostCase(const char* name, HostCaseFunction run);
+
+    /** Run the cases named in argv, or every case if there are none. */
+    static int runAll(int argc, char** argv);
+
+  private:
+    const char*       name_;
+    HostCaseFunction  run_;
+    HostCase*         next_;
+
+    static HostCase*  first_;
+    static HostCase*  last_;
+};
+
+/** Define and register the case \a name. */
+#define HOST_CASE(name) \
+  static void name(); \
+  static HostCase name##Case(#name, name); \
+  static void name()
+
+/** Byte \a i of a file with pattern \a seed, tools/fsck.py checks F<n>.BIN, P<n>.BIN, A.TXT and B.TXT. */
+uint8_t hostPattern(uint32_t i, int seed);
+
+/** Path of the image \a name in the directory of the program. */
+std::string hostImage(const char* name);
+
+/** Create the image \a path of \a blocks zero blocks, sparse where the host allows. */
+void hostBlank(const std::string& path, uint32_t blocks);
+
+/** Create the FAT16 or FAT32 image \a path with tools/mkfat.py. */
+void hostFormat(const std::string& path, int fatType, int sizeMB, int blocksPerCluster);
+
+/** Create the exFAT image \a path with tools/mkexfat.py, clusters of 1 << \a clusterShift blocks,
+    with the files of another formatter if \a pre. */
+void hostFormatExFat(const std::string& path, int sizeMB, int clusterShift, bool pre);
+
+/** Check the image \a path with tools/fsck.py, or tools/exfsck.py for exFAT. */
+void hostFsck(const std::string& path);
+
+/** Open the image \a path on \a dev and start \a card on the emulated card \a spi. */
+void hostCard(RP2040_FileBlockDevice& dev, Sd2Card& card, const std::string& path, RP2040_SdSpiEmulator& spi = SPI);
+
+/** Contiguous runs in the FAT16 or FAT32 chain of \a vol that starts at \a cluster, read from \a dev,
+    and the length of the chain in \a length. */
+uint32_t hostChainRuns(RP2040_BlockDevice& dev, RP2040_SdVolume& vol, uint32_t cluster, uint32_t* length);
+
+/** Seconds from a steady clock. */
+double hostSeconds();
@@ -0,0 +1,71 @@
+/****************************************************************************************************************************
+  Arduino.h
+
+  Minimal Arduino core for building RP2040_SD on a host, see extras/host/README.md.
+  Only what the library and the host programs use is declared.
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH        1
+#define LOW         0
+#define INPUT       0
+#define OUTPUT      1
+
+#define SS          17
+#define MOSI        19
+#define MISO        16
+#define SCK         18
+
+#define MSBFIRST    1
+#define SPI_MODE0   0
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+unsigned long millis();
+unsigned long micros();
+void yield();
+
+class String
+{
+  public:
+    String(const char* s = "") : s_(s) {}
+
+    const char* c_str() const
+    {
+      return s_.c_str();
+    }
+
+  private:
+    std::string s_;
+};
+
+#include "Print.h"
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// output is discarded, the host programs print with printf()
+class HostSerial : public Print
+{
+  public:
+    size_t write(uint8_t)
+    {
+      return 1;
+    }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,205 @@
+/****************************************************************************************************************************
+  FileBlockDevice.h
+
+  For all RP2040 boads using Arduimo-mbed or arduino-pico core
+
+  RP2040_SD is a library enable the usage of SD on RP2040-based boards
+
+  This Library is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+  This Library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with the Arduino SdFat Library.
+  If not, see <http://www.gnu.org/licenses/>.
+
+  Based on and modified from  Arduino SdFat Library (https://github.com/arduino/Arduino)
+
+  (C) Copyright 2009 by William Greiman
+  (C) Copyright 2010 SparkFun Electronics
+  (C) Copyright 2021 by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/RP2040_SD
+  Licensed under GPL-3.0 license
+
+  Version: 1.0.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0  K Hoang       18/06/2021 Port to RP2040-based boards using Arduimo-mbed or arduino-pico core
+  1.0.1  K Hoang       22/10/2021 Fix platform in library.json for PIO
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef FileBlockDevice_h
+#define FileBlockDevice_h
+
+/**
+   \file
+   RP2040_FileBlockDevice class
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "utility/BlockDevice.h"
+
+//------------------------------------------------------------------------------
+/**
+   \class RP2040_FileBlockDevice
+   \brief Block device backed by a disk image file opened with stdio.
+
+   Part of the host build, not of the library.  Allows a RP2040_SdVolume
+   to mount a FAT image on a host so the FAT layer can be run without an
+   SD card.
+
+   Offsets are 64-bit and use fseeko()/ftello().  The host Makefile sets
+   -D_FILE_OFFSET_BITS=64 so a 32-bit host reaches blocks past 2 GB, without
+   it such blocks fail to read or write instead of wrapping.
+*/
+class RP2040_FileBlockDevice : public RP2040_BlockDevice
+{
+  public:
+    RP2040_FileBlockDevice() : block_(0), file_(NULL) {}
+
+    ~RP2040_FileBlockDevice()
+    {
+      end();
+    }
+
+    /** Open the image file \a path for read and write. */
+    uint8_t begin(const char* path)
+    {
+      end();
+      file_ = fopen(path, "r+b");
+
+      return file_ != NULL;
+    }
+
+    /** Close the image file. */
+    void end()
+    {
+      if (file_)
+      {
+        fclose(file_);
+        file_ = NULL;
+      }
+    }
+
+    uint32_t cardSize()
+    {
+      if (!file_ || fseeko(file_, 0, SEEK_END))
+      {
+        return 0;
+      }
+
+      off_t size = ftello(file_);
+
+      return size < 0 ? 0 : (uint32_t)((uint64_t)size >> 9);
+    }
+
+    uint8_t erase(uint32_t firstBlock, uint32_t lastBlock)
+    {
+      uint8_t zero[512];
+
+      memset(zero, 0, sizeof(zero));
+
+      for (uint32_t b = firstBlock; b <= lastBlock; b++)
+      {
+        if (!writeBlock(b, zero))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    uint8_t isBusy()
+    {
+      return false;
+    }
+
+    uint8_t readBlock(uint32_t block, uint8_t* dst)
+    {
+      return readData(block, 0, 512, dst);
+    }
+
+    uint8_t readData(uint32_t block, uint16_t offset, uint16_t count, uint8_t* dst)
+    {
+      if (!seek(block, offset))
+      {
+        return false;
+      }
+
+      return fread(dst, 1, count, file_) == count;
+    }
+
+    uint8_t readData(uint8_t* dst)
+    {
+      return readBlock(block_++, dst);
+    }
+
+    uint8_t readStart(uint32_t block)
+    {
+      block_ = block;
+      return file_ != NULL;
+    }
+
+    uint8_t readStop()
+    {
+      return true;
+    }
+
+    uint8_t syncBlocks()
+    {
+      return file_ && fflush(file_) == 0;
+    }
+
+    uint8_t writeBlock(uint32_t block, const uint8_t* src, uint8_t /* blocking */ = 1)
+    {
+      if (!seek(block, 0))
+      {
+        return false;
+      }
+
+      return fwrite(src, 1, 512, file_) == 512;
+    }
+
+    uint8_t writeData(const uint8_t* src)
+    {
+      return writeBlock(block_++, src);
+    }
+
+    uint8_t writeStart(uint32_t block, uint32_t /* eraseCount */)
+    {
+      block_ = block;
+      return file_ != NULL;
+    }
+
+    uint8_t writeStop()
+    {
+      return true;
+    }
+
+  private:
+    uint32_t  block_;   // next block in a multiple block sequence
+    FILE*     file_;    // image file
+
+    uint8_t seek(uint32_t block, uint16_t offset)
+    {
+      uint64_t pos = ((uint64_t)block << 9) + offset;
+
+      // refuse offsets a 32-bit off_t cannot hold
+      if (!file_ || (off_t)pos < 0 || (uint64_t)(off_t)pos != pos)
+      {
+        return false;
+      }
+
+      return fseeko(file_, (off_t)pos, SEEK_SET) == 0;
+    }
+};
+#endif  // FileBlockDevice_h
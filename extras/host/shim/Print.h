@@ -0,0 +1,79 @@
+/****************************************************************************************************************************
+  Print.h
+
+  Minimal Arduino Print class for building RP2040_SD on a host.
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class Print
+{
+  public:
+    Print() : writeError_(0) {}
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t) = 0;
+
+    virtual size_t write(const uint8_t* buf, size_t n)
+    {
+      size_t r = 0;
+
+      while (n--)
+      {
+        r += write(*buf++);
+      }
+
+      return r;
+    }
+
+    size_t write(const char* s)
+    {
+      return write((const uint8_t*) s, strlen(s));
+    }
+
+    virtual int availableForWrite()
+    {
+      return 0;
+    }
+
+    virtual void flush() {}
+
+    int getWriteError()
+    {
+      return writeError_;
+    }
+
+    void clearWriteError()
+    {
+      writeError_ = 0;
+    }
+
+    // printed values are discarded
+    template <class T> size_t print(T, int = 0)
+    {
+      return 0;
+    }
+
+    template <class T> size_t println(T, int = 0)
+    {
+      return 0;
+    }
+
+    size_t println()
+    {
+      return 0;
+    }
+
+  protected:
+    void setWriteError(int err = 1)
+    {
+      writeError_ = err;
+    }
+
+  private:
+    int writeError_;
+};
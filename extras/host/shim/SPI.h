@@ -0,0 +1,30 @@
+/****************************************************************************************************************************
+  SPI.h
+
+  SPI declarations for building RP2040_SD on a host.  SPI and SPI1 are
+  RP2040_SdSpiEmulator cards with no storage until setDevice().
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include "SdSpiEmulator.h"
+
+class SPISettings
+{
+  public:
+    SPISettings(uint32_t clock = 4000000, int order = MSBFIRST, int mode = SPI_MODE0) : clock_(clock)
+    {
+      (void) order;
+      (void) mode;
+    }
+
+  private:
+    uint32_t clock_;
+};
+
+/** Every SPI controller of the host is an emulated card. */
+typedef RP2040_SdSpiEmulator SPIClass;
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
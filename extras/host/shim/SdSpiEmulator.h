@@ -0,0 +1,621 @@
+/****************************************************************************************************************************
+  SdSpiEmulator.h
+
+  For all RP2040 boads using Arduimo-mbed or arduino-pico core
+
+  RP2040_SD is a library enable the usage of SD on RP2040-based boards
+
+  This Library is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+  This Library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with the Arduino SdFat Library.
+  If not, see <http://www.gnu.org/licenses/>.
+
+  Based on and modified from  Arduino SdFat Library (https://github.com/arduino/Arduino)
+
+  (C) Copyright 2009 by William Greiman
+  (C) Copyright 2010 SparkFun Electronics
+  (C) Copyright 2021 by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/RP2040_SD
+  Licensed under GPL-3.0 license
+
+  Version: 1.0.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0  K Hoang       18/06/2021 Port to RP2040-based boards using Arduimo-mbed or arduino-pico core
+  1.0.1  K Hoang       22/10/2021 Fix platform in library.json for PIO
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef SdSpiEmulator_h
+#define SdSpiEmulator_h
+
+/**
+   \file
+   RP2040_SdSpiEmulator class
+*/
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "utility/SdInfo.h"
+#include "utility/BlockDevice.h"
+
+//------------------------------------------------------------------------------
+/**
+   \class RP2040_SdSpiEmulator
+   \brief Host model of an SD card in SPI mode.
+
+   Part of the host build, not of the library.  The emulator has the
+   SPIClass functions used by Sd2Card, and the host SPI.h makes it the
+   SPIClass, so SPI and SPI1 are each an emulated card.
+
+   Card data is kept in a RP2040_BlockDevice such as RP2040_FileBlockDevice.
+   Latencies are counted in SPI bytes, one byte being eight SCK cycles.
+   Counters record bytes clocked, transfer() calls and bytes per command
+   so protocol overhead can be compared between builds.
+*/
+class RP2040_SdSpiEmulator
+{
+  public:
+    /** Create an emulated SDHC card backed by \a dev. */
+    RP2040_SdSpiEmulator(RP2040_BlockDevice* dev = NULL) : dev_(dev), highCapacity_(true), initPolls_(2),
+      readError_(0XFFFFFFFF)
+    {
+      memset(latency_, 0, sizeof(latency_));
+      reset();
+      clearStats();
+    }
+
+    //----------------------------------------------------------------------------
+    // configuration
+
+    /** Set the storage for the card data. */
+    void setDevice(RP2040_BlockDevice* dev)
+    {
+      dev_ = dev;
+    }
+
+    /** Emulate a SDHC card if \a value is true else a byte addressed SD2 card. */
+    void setHighCapacity(bool value)
+    {
+      highCapacity_ = value;
+    }
+
+    /** Number of ACMD41 calls answered with idle before the card is ready. */
+    void setInitPolls(uint16_t polls)
+    {
+      initPolls_ = polls;
+    }
+
+    /**
+       Set the latency for a command in SPI bytes.  For CMD9, CMD10, CMD17
+       and CMD18 it is the wait before each data token.  For CMD24 and CMD25 it
+       is the busy time after each data block.  For CMD38 and CMD12 it is
+       the busy time after the response.
+    */
+    void setLatency(uint8_t cmd, uint32_t bytes)
+    {
+      latency_[cmd & 0X3F] = bytes;
+    }
+
+    /**
+       Answer reads of \a block with a data error token instead of the data,
+       0XFFFFFFFF for none.  In a CMD18 stream the card goes on to the next
+       block, as a card does until CMD12.
+    */
+    void setReadError(uint32_t block)
+    {
+      readError_ = block;
+    }
+
+    //----------------------------------------------------------------------------
+    // statistics
+
+    /** Clear all counters. */
+    void clearStats()
+    {
+      bytes_ = calls_ = 0;
+      memset(cmdCount_, 0, sizeof(cmdCount_));
+      memset(cmdBytes_, 0, sizeof(cmdBytes_));
+    }
+
+    /** \return Total bytes clocked on the bus. */
+    uint32_t bytesClocked() const
+    {
+      return bytes_;
+    }
+
+    /** \return Number of transfer() calls. */
+    uint32_t transferCalls() const
+    {
+      return calls_;
+    }
+
+    /** \return Number of times \a cmd was received. ACMDs are counted with 0X40 added. */
+    uint32_t commandCount(uint8_t cmd) const
+    {
+      return cmdCount_[cmd & 0X7F];
+    }
+
+    /** \return Bytes clocked from the start of \a cmd to the start of the next command. */
+    uint32_t commandBytes(uint8_t cmd) const
+    {
+      return cmdBytes_[cmd & 0X7F];
+    }
+
+    //----------------------------------------------------------------------------
+    // SPIClass functions used by Sd2Card
+
+    void begin() {}
+    void end() {}
+
+    template <class Settings> void beginTransaction(const Settings&) {}
+    void endTransaction() {}
+
+    uint8_t transfer(uint8_t b)
+    {
+      calls_++;
+
+      return clock(b);
+    }
+
+    void transfer(void* buf, size_t n)
+    {
+      uint8_t* p = reinterpret_cast<uint8_t*>(buf);
+
+      calls_++;
+
+      for (size_t i = 0; i < n; i++)
+      {
+        p[i] = clock(p[i]);
+      }
+    }
+
+    void transfer(const void* txbuf, void* rxbuf, size_t n)
+    {
+      const uint8_t* tx = reinterpret_cast<const uint8_t*>(txbuf);
+      uint8_t* rx = reinterpret_cast<uint8_t*>(rxbuf);
+
+      calls_++;
+
+      for (size_t i = 0; i < n; i++)
+      {
+        uint8_t r = clock(tx ? tx[i] : 0XFF);
+
+        if (rx)
+        {
+          rx[i] = r;
+        }
+      }
+    }
+
+    /** Return the card to power up state. */
+    void reset()
+    {
+      state_ = ST_IDLE;
+      idle_ = true;
+      appCmd_ = false;
+      polls_ = 0;
+      cmdLen_ = 0;
+      curCmd_ = 0X7F;
+      out_.clear();
+      outIndex_ = 0;
+    }
+
+  private:
+    // receive states
+    enum
+    {
+      ST_IDLE,          // parse commands
+      ST_READ_MULTI,    // stream blocks until CMD12
+      ST_WRITE_TOKEN,   // wait for single block start token
+      ST_WRITE_MULTI,   // wait for multiple block token or stop token
+      ST_WRITE_DATA     // receive data block and crc
+    };
+
+    RP2040_BlockDevice* dev_;
+    bool      highCapacity_;
+    uint16_t  initPolls_;
+    uint32_t  latency_[64];
+    uint32_t  readError_;
+
+    uint8_t   state_;
+    bool      idle_;
+    bool      appCmd_;
+    uint16_t  polls_;
+    uint8_t   cmd_[6];
+    uint8_t   cmdLen_;
+    uint8_t   curCmd_;
+    uint32_t  block_;
+    uint32_t  eraseStart_;
+    uint32_t  eraseEnd_;
+    uint8_t   data_[512];
+    uint16_t  dataLen_;
+    uint8_t   multi_;
+
+    // bytes to send, as runs of one value so a long latency costs no RAM
+    struct Run
+    {
+      uint8_t   value;
+      uint32_t  count;
+    };
+
+    std::vector<Run> out_;
+    size_t    outIndex_;
+
+    uint32_t  bytes_;
+    uint32_t  calls_;
+    uint32_t  cmdCount_[128];
+    uint32_t  cmdBytes_[128];
+
+    // clock one byte, \a in from the host, return byte from the card
+    uint8_t clock(uint8_t in)
+    {
+      uint8_t r = 0XFF;
+
+      bytes_++;
+      cmdBytes_[curCmd_]++;
+
+      if (outIndex_ < out_.size())
+      {
+        r = next();
+      }
+      else if (state_ == ST_READ_MULTI)
+      {
+        // queue next block of the stream
+        queueBlock(block_++, latency_[CMD18]);
+        r = next();
+      }
+
+      if (state_ == ST_WRITE_TOKEN || state_ == ST_WRITE_MULTI || state_ == ST_WRITE_DATA)
+      {
+        receiveData(in);
+      }
+      else
+      {
+        receiveCommand(in);
+      }
+
+      return r;
+    }
+
+    // next byte to send, there must be one
+    uint8_t next()
+    {
+      Run& run = out_[outIndex_];
+      uint8_t r = run.value;
+
+      if (--run.count == 0)
+      {
+        outIndex_++;
+      }
+
+      return r;
+    }
+
+    void queue(uint8_t b)
+    {
+      queueFill(b, 1);
+    }
+
+    void queueFill(uint8_t b, uint32_t n)
+    {
+      if (n == 0)
+      {
+        return;
+      }
+
+      if (outIndex_ == out_.size())
+      {
+        out_.clear();
+        outIndex_ = 0;
+      }
+
+      if (!out_.empty() && out_.back().value == b)
+      {
+        out_.back().count += n;
+      }
+      else
+      {
+        Run run = {b, n};
+        out_.push_back(run);
+      }
+    }
+
+    // queue latency, data token, data and crc
+    void queueData(const uint8_t* src, uint16_t n, uint32_t latency)
+    {
+      queueFill(0XFF, latency);
+      queue(DATA_START_BLOCK);
+
+      for (uint16_t i = 0; i < n; i++)
+      {
+        queue(src[i]);
+      }
+
+      queueFill(0XFF, 2);
+    }
+
+    void queueBlock(uint32_t block, uint32_t latency)
+    {
+      uint8_t buf[512];
+
+      if (block == readError_)
+      {
+        // error token, card ECC failed
+        queueFill(0XFF, latency);
+        queue(0X02);
+        return;
+      }
+
+      if (!dev_ || !dev_->readBlock(block, buf))
+      {
+        memset(buf, 0, sizeof(buf));
+      }
+
+      queueData(buf, 512, latency);
+    }
+
+    // R1 after one byte of Ncr
+    void queueR1(uint8_t r1)
+    {
+      queue(0XFF);
+      queue(r1);
+    }
+
+    uint8_t r1Ok()
+    {
+      return idle_ ? R1_IDLE_STATE : R1_READY_STATE;
+    }
+
+    uint32_t blockAddress(uint32_t arg)
+    {
+      return highCapacity_ ? arg : arg >> 9;
+    }
+
+    void receiveCommand(uint8_t in)
+    {
+      if (cmdLen_ == 0 && (in & 0XC0) != 0X40)
+      {
+        return;
+      }
+
+      cmd_[cmdLen_++] = in;
+
+      if (cmdLen_ == 6)
+      {
+        cmdLen_ = 0;
+        execute(cmd_[0] & 0X3F, (uint32_t)cmd_[1] << 24 | (uint32_t)cmd_[2] << 16 | (uint32_t)cmd_[3] << 8 | cmd_[4]);
+      }
+    }
+
+    void execute(uint8_t cmd, uint32_t arg)
+    {
+      bool app = appCmd_;
+
+      appCmd_ = false;
+
+      curCmd_ = app ? cmd | 0X40 : cmd;
+      cmdCount_[curCmd_]++;
+
+      if (state_ == ST_READ_MULTI)
+      {
+        if (cmd != CMD12)
+        {
+          // a card sending blocks only takes CMD12, the stream goes on
+          return;
+        }
+
+        // stuff byte, response then busy
+        out_.clear();
+        outIndex_ = 0;
+        queue(0XFF);
+        queue(R1_READY_STATE);
+        queueFill(0X00, latency_[CMD12]);
+        state_ = ST_IDLE;
+        return;
+      }
+
+      // a new command discards any response not yet clocked out
+      out_.clear();
+      outIndex_ = 0;
+
+      if (app)
+      {
+        if (cmd == ACMD41)
+        {
+          if (++polls_ > initPolls_)
+          {
+            idle_ = false;
+          }
+
+          queueR1(r1Ok());
+        }
+        else if (cmd == ACMD23)
+        {
+          queueR1(r1Ok());
+        }
+        else
+        {
+          queueR1(r1Ok() | R1_ILLEGAL_COMMAND);
+        }
+
+        return;
+      }
+
+      switch (cmd)
+      {
+        case CMD0:
+          reset();
+          curCmd_ = CMD0;
+          queueR1(R1_IDLE_STATE);
+          break;
+
+        case CMD8:
+          queueR1(r1Ok());
+          queue(0X00);
+          queue(0X00);
+          queue(0X01);
+          queue(arg & 0XFF);
+          break;
+
+        case CMD55:
+          appCmd_ = true;
+          queueR1(r1Ok());
+          break;
+
+        case CMD58:
+          queueR1(r1Ok());
+          queue(highCapacity_ && !idle_ ? 0XC0 : 0X80);
+          queue(0XFF);
+          queue(0X80);
+          queue(0X00);
+          break;
+
+        case CMD9:
+        {
+          uint8_t csd[16];
+          uint32_t cSize = (dev_ ? dev_->cardSize() >> 10 : 1) - 1;
+
+          memset(csd, 0, sizeof(csd));
+
+          // CSD version 2.0, erase single block enabled
+          csd[0] = 0X40;
+          csd[5] = 0X09;
+          csd[7] = (cSize >> 16) & 0X3F;
+          csd[8] = cSize >> 8;
+          csd[9] = cSize;
+          csd[10] = 0X7F;
+          csd[11] = 0X80;
+          csd[15] = 0X01;
+
+          queueR1(r1Ok());
+          queueData(csd, 16, latency_[CMD9]);
+          break;
+        }
+
+        case CMD10:
+        {
+          uint8_t cid[16] = {0X03, 'R', 'P', 'E', 'M', 'U', 'S', 'D', 0X10, 0, 0, 0, 1, 0X01, 0X5A, 0X01};
+
+          queueR1(r1Ok());
+          queueData(cid, 16, latency_[CMD10]);
+          break;
+        }
+
+        case CMD12:
+          queueR1(r1Ok());
+          break;
+
+        case CMD13:
+          queueR1(r1Ok());
+          queue(0X00);
+          break;
+
+        case CMD17:
+          queueR1(r1Ok());
+          queueBlock(blockAddress(arg), latency_[CMD17]);
+          break;
+
+        case CMD18:
+          queueR1(r1Ok());
+          block_ = blockAddress(arg);
+          queueBlock(block_++, latency_[CMD18]);
+          state_ = ST_READ_MULTI;
+          break;
+
+        case CMD24:
+          queueR1(r1Ok());
+          block_ = blockAddress(arg);
+          multi_ = 0;
+          state_ = ST_WRITE_TOKEN;
+          break;
+
+        case CMD25:
+          queueR1(r1Ok());
+          block_ = blockAddress(arg);
+          multi_ = 1;
+          state_ = ST_WRITE_MULTI;
+          break;
+
+        case CMD32:
+          eraseStart_ = blockAddress(arg);
+          queueR1(r1Ok());
+          break;
+
+        case CMD33:
+          eraseEnd_ = blockAddress(arg);
+          queueR1(r1Ok());
+          break;
+
+        case CMD38:
+          if (!dev_ || !dev_->erase(eraseStart_, eraseEnd_))
+          {
+            queueR1(r1Ok() | R1_ILLEGAL_COMMAND);
+            break;
+          }
+
+          queueR1(r1Ok());
+          queueFill(0X00, latency_[CMD38]);
+          break;
+
+        default:
+          queueR1(r1Ok() | R1_ILLEGAL_COMMAND);
+      }
+    }
+
+    void receiveData(uint8_t in)
+    {
+      if (state_ == ST_WRITE_TOKEN || state_ == ST_WRITE_MULTI)
+      {
+        if (state_ == ST_WRITE_TOKEN ? in == DATA_START_BLOCK : in == WRITE_MULTIPLE_TOKEN)
+        {
+          dataLen_ = 0;
+          state_ = ST_WRITE_DATA;
+        }
+        else if (state_ == ST_WRITE_MULTI && in == STOP_TRAN_TOKEN)
+        {
+          // Nbr then busy
+          queue(0XFF);
+          queueFill(0X00, latency_[CMD25]);
+          state_ = ST_IDLE;
+        }
+        else if (in != 0XFF)
+        {
+          // not a token, back to command mode
+          state_ = ST_IDLE;
+          receiveCommand(in);
+        }
+
+        return;
+      }
+
+      // data block then two crc bytes
+      if (dataLen_ < 512)
+      {
+        data_[dataLen_] = in;
+      }
+
+      if (++dataLen_ < 514)
+      {
+        return;
+      }
+
+      bool ok = dev_ && dev_->writeBlock(block_++, data_);
+
+      // data response then busy
+      queue(ok ? 0XE5 : 0XED);
+      queueFill(0X00, latency_[multi_ ? CMD25 : CMD24]);
+
+      state_ = multi_ ? ST_WRITE_MULTI : ST_IDLE;
+    }
+};
+
+#endif  // SdSpiEmulator_h
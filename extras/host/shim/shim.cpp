@@ -0,0 +1,30 @@
+/****************************************************************************************************************************
+  shim.cpp
+
+  Definitions for the host Arduino shim.
+ *****************************************************************************************************************************/
+
+#include "Arduino.h"
+#include "SPI.h"
+
+#include <chrono>
+
+HostSerial Serial;
+SPIClass SPI;
+SPIClass SPI1;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+void yield() {}
+
+unsigned long millis()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
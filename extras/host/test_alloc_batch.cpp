@@ -0,0 +1,96 @@
+/****************************************************************************************************************************
+  test_alloc_batch.cpp
+
+  Cluster allocation in batches of SD_ALLOC_CLUSTERS, or of the size of a
+  write, and release of the unused batch tail.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// two files grown in turn by 100 bytes, then one large write
+HOST_CASE(allocBatch)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  int32_t free = vol.freeClusterCount();
+
+  const uint32_t total = 40000;
+  uint8_t buf[100];
+  RP2040_SdFile f[2];
+  CHECK(f[0].open(&root, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(f[1].open(&root, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (int k = 0; k < 2; k++)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, k);
+      }
+
+      CHECK(f[k].write(buf, sizeof buf) == sizeof buf);
+    }
+  }
+
+  CHECK(f[0].close() && f[1].close());
+  CHECK(vol.sync());
+
+  // the clusters past the end of each file went back at close()
+  uint32_t clusters = (total + 511) / 512;
+  CHECK(vol.freeClusterCount() == free - 2 * (int32_t) clusters);
+
+  uint32_t length;
+  uint32_t runs = hostChainRuns(card, vol, f[0].firstCluster(), &length);
+  CHECK(length == clusters);
+  CHECK(runs <= (clusters + SD_ALLOC_CLUSTERS - 1) / SD_ALLOC_CLUSTERS);
+
+  // a write larger than the batch takes all its clusters at once, past a
+  // one cluster file made in between
+  RP2040_SdFile g;
+  CHECK(g.open(&root, "F2.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  static uint8_t big[20 * 512];
+
+  for (uint32_t i = 0; i < sizeof big; i++)
+  {
+    big[i] = hostPattern(i, 2);
+  }
+
+  CHECK(g.write(big, 100) == 100);
+  CHECK(f[0].open(&root, "F3.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  for (uint32_t i = 0; i < sizeof buf; i++)
+  {
+    buf[i] = hostPattern(i, 3);
+  }
+
+  CHECK(f[0].write(buf, sizeof buf) == sizeof buf);
+  CHECK(g.write(big + 100, sizeof big - 100) == sizeof big - 100);
+
+  // truncate() also releases the tail, with the file still open
+  CHECK(g.truncate(sizeof big - 600));
+  CHECK(g.close());
+  CHECK(f[0].close());
+
+  CHECK(hostChainRuns(card, vol, g.firstCluster(), &length) <= 2);
+  CHECK(length == (sizeof big - 600 + 511) / 512);
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  batch allocation ok, %u clusters in %u runs, %u clusters a batch\n", (unsigned) clusters,
+         (unsigned) runs, (unsigned) SD_ALLOC_CLUSTERS);
+}
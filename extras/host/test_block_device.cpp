@@ -0,0 +1,199 @@
+/****************************************************************************************************************************
+  test_block_device.cpp
+
+  RP2040_FileBlockDevice on its own, then RP2040_SdVolume and RP2040_SdFile
+  mounted straight on it with no SPI in between.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// single and multiple block I/O, erase, and blocks past 4 GB in a sparse image
+HOST_CASE(fileBlockDevice)
+{
+  const uint32_t blocks = 9000000;
+  std::string path = hostImage("sparse.img");
+
+  hostBlank(path, blocks);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  CHECK(dev.cardSize() == blocks);
+
+  // either side of the 2 GB and 4 GB byte offsets, and the last block
+  const uint32_t at[] = {1, 4194303, 4194304, 8388607, 8388608, blocks - 1};
+  uint8_t buf[512];
+  uint8_t in[512];
+
+  for (uint8_t k = 0; k < sizeof(at) / sizeof(at[0]); k++)
+  {
+    for (int i = 0; i < 512; i++)
+    {
+      buf[i] = hostPattern(i, k);
+    }
+
+    CHECK(dev.writeBlock(at[k], buf));
+  }
+
+  for (uint8_t k = 0; k < sizeof(at) / sizeof(at[0]); k++)
+  {
+    CHECK(dev.readBlock(at[k], in));
+
+    for (int i = 0; i < 512; i++)
+    {
+      CHECK(in[i] == hostPattern(i, k));
+    }
+
+    CHECK(dev.readData(at[k], 500, 12, in));
+    CHECK(in[0] == hostPattern(500, k) && in[11] == hostPattern(511, k));
+  }
+
+  CHECK(!dev.readBlock(blocks, in));
+
+  // a multiple block write and read across the 4 GB offset
+  CHECK(dev.writeStart(8388606, 4));
+
+  for (int b = 0; b < 4; b++)
+  {
+    memset(buf, 0X40 + b, sizeof buf);
+    CHECK(dev.writeData(buf));
+  }
+
+  CHECK(dev.writeStop());
+  CHECK(dev.readStart(8388606));
+
+  for (int b = 0; b < 4; b++)
+  {
+    CHECK(dev.readData(in));
+    CHECK(in[0] == 0X40 + b && in[511] == 0X40 + b);
+  }
+
+  CHECK(dev.readStop());
+
+  CHECK(dev.erase(8388607, 8388608));
+  CHECK(dev.readBlock(8388607, in) && in[0] == 0 && in[511] == 0);
+  CHECK(dev.readBlock(8388609, in) && in[0] == 0X43);
+  CHECK(dev.syncBlocks());
+
+  dev.end();
+  CHECK(remove(path.c_str()) == 0);
+
+  printf("  file block device ok, %u blocks\n", (unsigned) blocks);
+}
+//------------------------------------------------------------------------------
+// files written and read back with many chunk sizes, random seeks, truncate
+static void fileIo(RP2040_SdFile& root)
+{
+  const uint32_t sizes[] = {1, 100, 512, 1024, 4096, 20000, 30000};
+  const uint32_t total = 300000;
+  static uint8_t buf[30000];
+
+  for (int k = 0; k < 7; k++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "F%d.BIN", k);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+
+    for (uint32_t pos = 0; pos < total; )
+    {
+      uint32_t n = sizes[k] < total - pos ? sizes[k] : total - pos;
+
+      for (uint32_t i = 0; i < n; i++)
+      {
+        buf[i] = hostPattern(pos + i, k);
+      }
+
+      CHECK(f.write(buf, n) == n);
+      pos += n;
+    }
+
+    CHECK(f.close());
+  }
+
+  for (int k = 0; k < 7; k++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "F%d.BIN", k);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, name, O_READ));
+    CHECK(f.fileSize() == total);
+
+    for (uint32_t pos = 0; pos < total; )
+    {
+      uint32_t n = sizes[6 - k] < total - pos ? sizes[6 - k] : total - pos;
+
+      CHECK(f.read(buf, n) == (int) n);
+
+      for (uint32_t i = 0; i < n; i++)
+      {
+        CHECK(buf[i] == hostPattern(pos + i, k));
+      }
+
+      pos += n;
+    }
+
+    for (int r = 0; r < 50; r++)
+    {
+      uint32_t p = (r * 104729UL) % (total - 3000);
+
+      CHECK(f.seekSet(p));
+      CHECK(f.read(buf, 3000) == 3000);
+
+      for (uint32_t i = 0; i < 3000; i++)
+      {
+        CHECK(buf[i] == hostPattern(p + i, k));
+      }
+    }
+
+    CHECK(f.close());
+  }
+
+  // truncate, rewrite the middle and remove
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F5.BIN", O_RDWR));
+  CHECK(f.truncate(123457));
+  CHECK(f.seekSet(1000));
+
+  for (uint32_t i = 0; i < 9000; i++)
+  {
+    buf[i] = hostPattern(1000 + i, 5);
+  }
+
+  CHECK(f.write(buf, 9000) == 9000);
+  CHECK(f.close());
+  CHECK(RP2040_SdFile::remove(&root, "F2.BIN"));
+}
+//------------------------------------------------------------------------------
+// the FAT layer on FAT32 with 512 byte clusters and FAT16 with 2 KB clusters
+HOST_CASE(volumeOnImage)
+{
+  const int formats[2][3] = {{32, 40, 1}, {16, 16, 4}};
+
+  for (int k = 0; k < 2; k++)
+  {
+    std::string path = hostImage("volume.img");
+    hostFormat(path, formats[k][0], formats[k][1], formats[k][2]);
+
+    RP2040_FileBlockDevice dev;
+    CHECK(dev.begin(path.c_str()));
+
+    RP2040_SdVolume vol;
+    CHECK(vol.init(&dev, 0));
+    CHECK(vol.fatType() == formats[k][0]);
+    CHECK(vol.blocksPerCluster() == formats[k][2]);
+
+    RP2040_SdFile root;
+    CHECK(root.openRoot(&vol));
+    fileIo(root);
+    CHECK(vol.sync());
+
+    dev.end();
+    hostFsck(path);
+
+    printf("  FAT%d volume on an image ok, %u clusters of %u blocks\n", vol.fatType(),
+           (unsigned) vol.clusterCount(), vol.blocksPerCluster());
+  }
+}
@@ -0,0 +1,90 @@
+/****************************************************************************************************************************
+  test_card_stats.cpp
+
+  Sd2Card command latency statistics, built with SD_CARD_STATS nonzero.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#if SD_CARD_STATS
+
+//------------------------------------------------------------------------------
+static uint32_t samples(Sd2Card& card, uint8_t index)
+{
+  return card.stats().latency[index].count;
+}
+//------------------------------------------------------------------------------
+// one sample per command and data token, busy samples only after writes
+HOST_CASE(cardStats)
+{
+  std::string path = hostImage("card.img");
+  hostBlank(path, 8192);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  uint8_t buf[512];
+
+  card.clearStats();
+
+  for (uint32_t b = 10; b < 13; b++)
+  {
+    CHECK(card.readBlock(b, buf));
+  }
+
+  CHECK(samples(card, SD_STATS_CMD17) == 3);
+  CHECK(samples(card, SD_STATS_TOKEN) == 3);
+  CHECK(samples(card, SD_STATS_BUSY) == 0);
+
+  // a blocking write waits once for programming, then polls CMD13
+  memset(buf, 0X5A, sizeof buf);
+  SPI.setLatency(24, 100);
+  card.clearStats();
+
+  for (uint32_t b = 10; b < 12; b++)
+  {
+    CHECK(card.writeBlock(b, buf));
+  }
+
+  CHECK(samples(card, SD_STATS_CMD24) == 2);
+  CHECK(samples(card, SD_STATS_CMD13) == 2);
+  CHECK(samples(card, SD_STATS_BUSY) == 2);
+  CHECK(samples(card, SD_STATS_CMD17) == 0);
+
+  // four blocks, then the busy wait before and after the stop token
+  card.clearStats();
+  CHECK(card.writeStart(20, 4));
+
+  for (int b = 0; b < 4; b++)
+  {
+    CHECK(card.writeData(buf));
+  }
+
+  CHECK(card.writeStop());
+  CHECK(samples(card, SD_STATS_CMD25) == 1);
+  CHECK(samples(card, SD_STATS_BUSY) == 4 + 2);
+
+  card.clearStats();
+  CHECK(card.syncBlocks());
+  CHECK(samples(card, SD_STATS_BUSY) == 1);
+
+  // a data token timeout is a sample and an error
+  SPI.setLatency(17, 2000000000);
+  card.clearStats();
+  CHECK(!card.readBlock(10, buf));
+  CHECK(card.errorCode() == SD_CARD_ERROR_READ_TIMEOUT);
+  CHECK(samples(card, SD_STATS_TOKEN) == 1);
+  CHECK(card.stats().latency[SD_STATS_TOKEN].maxMicros >= 1000UL * SD_READ_TIMEOUT);
+  CHECK(card.stats().errors[SD_CARD_ERROR_READ_TIMEOUT] == 1);
+
+  SPI.setLatency(17, 0);
+  SPI.setLatency(24, 0);
+  CHECK(card.readBlock(10, buf) && buf[0] == 0X5A);
+
+  dev.end();
+
+  printf("  card statistics ok\n");
+}
+
+#endif  // SD_CARD_STATS
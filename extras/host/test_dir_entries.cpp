@@ -0,0 +1,297 @@
+/****************************************************************************************************************************
+  test_dir_entries.cpp
+
+  RP2040_SdFile::readDirEntries() against readDir(), with batches of any
+  size and its attribute and extension filters.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// 8.3 name of a directory entry with a dot before any extension
+static std::string entryName(const dir_t& e)
+{
+  std::string name;
+
+  for (uint8_t i = 0; i < 11; i++)
+  {
+    if (e.name[i] == ' ')
+    {
+      continue;
+    }
+
+    if (i == 8)
+    {
+      name += '.';
+    }
+
+    name += (char) e.name[i];
+  }
+
+  return name;
+}
+//------------------------------------------------------------------------------
+// list dir in batches of count and compare with the readDir() listing
+static void listAll(RP2040_SdFile& dir, const std::map<std::string, dir_t>& all, uint16_t count,
+                    uint8_t attrMask, uint8_t attrValue, const char* ext)
+{
+  std::vector<dirinfo_t> list(count);
+  uint32_t seen = 0;
+  uint32_t want = 0;
+  int n;
+
+  for (std::map<std::string, dir_t>::const_iterator it = all.begin(); it != all.end(); ++it)
+  {
+    const dir_t& e = it->second;
+    bool match = (e.attributes & attrMask) == attrValue;
+
+    if (ext)
+    {
+      std::string x = it->first.find('.') == std::string::npos ? "" : it->first.substr(it->first.find('.') + 1);
+      match = match && !strcasecmp(x.c_str(), ext);
+    }
+
+    want += match;
+  }
+
+  dir.rewind();
+
+  while ((n = dir.readDirEntries(list.data(), count, attrMask, attrValue, ext)) > 0)
+  {
+    CHECK(n <= count);
+
+    for (int i = 0; i < n; i++)
+    {
+      std::map<std::string, dir_t>::const_iterator it = all.find(list[i].name);
+      CHECK(it != all.end());
+
+      const dir_t& e = it->second;
+      CHECK(list[i].attributes == e.attributes);
+      CHECK((list[i].attributes & attrMask) == attrValue);
+      CHECK(list[i].size == e.fileSize);
+      CHECK(list[i].firstCluster == ((uint32_t) e.firstClusterHigh << 16 | e.firstClusterLow));
+      CHECK(list[i].lastWriteDate == e.lastWriteDate && list[i].lastWriteTime == e.lastWriteTime);
+
+      // the index opens the same entry
+      RP2040_SdFile f;
+      CHECK(f.open(&dir, list[i].index, O_READ));
+      CHECK(f.isDir() == !!(list[i].attributes & DIR_ATT_DIRECTORY));
+      CHECK(f.isDir() || f.fileSize() == list[i].size);
+      CHECK(f.firstCluster() == list[i].firstCluster);
+      f.close();
+      seen++;
+    }
+  }
+
+  CHECK(n == 0);
+  CHECK(seen == want);
+}
+//------------------------------------------------------------------------------
+// a directory of files, subdirectories and deleted entries over many blocks
+HOST_CASE(dirEntries)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile top;
+  CHECK(top.makeDir(&root, "LIST"));
+
+  for (int i = 0; i < 150; i++)
+  {
+    char name[13];
+    const char* ext[4] = { "TXT", "CSV", "", "TX" };
+    snprintf(name, sizeof name, i % 4 == 2 ? "N%d" : "N%d.%s", i, ext[i % 4]);
+
+    if (i % 10 == 9)
+    {
+      RP2040_SdFile d;
+      CHECK(d.makeDir(&top, name));
+      CHECK(d.close());
+      continue;
+    }
+
+    RP2040_SdFile f;
+    CHECK(f.open(&top, name, O_CREAT | O_WRITE | O_EXCL));
+
+    for (int k = 0; k < i; k++)
+    {
+      CHECK(f.write((uint8_t) k) == 1);
+    }
+
+    CHECK(f.close());
+  }
+
+  for (int i = 0; i < 150; i += 7)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "N%d.TXT", i);
+    RP2040_SdFile::remove(&top, name);
+  }
+
+  // every entry readDir() returns, but for . and ..
+  std::map<std::string, dir_t> all;
+  dir_t e;
+  top.rewind();
+
+  while (top.readDir(&e) > 0)
+  {
+    if (e.name[0] != '.')
+    {
+      all[entryName(e)] = e;
+    }
+  }
+
+  const uint16_t batches[] = { 1, 3, 16, 17, 200 };
+
+  for (uint32_t b = 0; b < sizeof batches / sizeof batches[0]; b++)
+  {
+    listAll(top, all, batches[b], 0, 0, NULL);
+  }
+
+  listAll(top, all, 10, DIR_ATT_DIRECTORY, 0, NULL);
+  listAll(top, all, 10, DIR_ATT_DIRECTORY, DIR_ATT_DIRECTORY, NULL);
+  listAll(top, all, 10, DIR_ATT_DIRECTORY, 0, "txt");
+  listAll(top, all, 10, 0, 0, "TX");
+  listAll(top, all, 10, 0, 0, "");
+
+  // after a mount, one read of each block of the directory, plus the two
+  // FAT blocks its chain is in with a one block FAT window
+  std::vector<dirinfo_t> list(all.size());
+  uint32_t blocks = (top.fileSize() + 511) / 512;
+  CHECK(top.close());
+  root.close();
+  CHECK(vol.sync());
+  CHECK(vol.init(&card, 0));
+  CHECK(root.openRoot(&vol));
+  CHECK(top.open(&root, "LIST", O_READ));
+  SPI.clearStats();
+  CHECK(top.readDirEntries(list.data(), list.size()) == (int) all.size());
+  CHECK(SPI.commandCount(17) + SPI.commandCount(18) <= blocks + 2);
+
+  // not a directory, or not at an entry
+  RP2040_SdFile f;
+  CHECK(f.open(&top, "N1.CSV", O_READ));
+  CHECK(f.readDirEntries(list.data(), 1) == -1);
+  f.close();
+
+  top.rewind();
+  CHECK(top.seekSet(5));
+  CHECK(top.readDirEntries(list.data(), 1) == -1);
+
+  CHECK(top.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  readDirEntries() ok, %u entries in %u blocks\n", (unsigned) all.size(), (unsigned) blocks);
+}
+#if SD_EXFAT
+//------------------------------------------------------------------------------
+// exFAT entry sets listed in batches, each index opens its file
+HOST_CASE(dirEntriesExFat)
+{
+  std::string path = hostImage("exfat.img");
+  hostFormatExFat(path, 16, 0, false);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&dev, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile top;
+  CHECK(top.makeDir(&root, "a listed directory"));
+
+  uint32_t total = 0;
+
+  for (int i = 0; i < 40; i++)
+  {
+    char name[40];
+    snprintf(name, sizeof name, i % 5 ? "a long file name %d.log" : "subdirectory %d", i);
+
+    RP2040_SdFile f;
+
+    if (i % 5 == 0)
+    {
+      CHECK(f.makeDir(&top, name));
+    }
+    else
+    {
+      CHECK(f.open(&top, name, O_CREAT | O_WRITE | O_EXCL));
+
+      for (int k = 0; k < i; k++)
+      {
+        CHECK(f.write((uint8_t) k) == 1);
+      }
+
+      total += i;
+    }
+
+    CHECK(f.close());
+  }
+
+  dirinfo_t list[7];
+  uint32_t files = 0;
+  uint32_t dirs = 0;
+  uint32_t size = 0;
+  int n;
+
+  top.rewind();
+
+  while ((n = top.readDirEntries(list, 7)) > 0)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      RP2040_SdFile f;
+      CHECK(f.open(&top, list[i].index, O_READ));
+      CHECK(f.isDir() == !!(list[i].attributes & DIR_ATT_DIRECTORY));
+      CHECK(f.firstCluster() == list[i].firstCluster);
+
+      if (f.isDir())
+      {
+        dirs++;
+      }
+      else
+      {
+        CHECK(f.fileSize() == list[i].size);
+        files++;
+        size += list[i].size;
+      }
+
+      f.close();
+    }
+  }
+
+  CHECK(n == 0);
+  CHECK(files == 32 && dirs == 8 && size == total);
+
+  top.rewind();
+  CHECK(top.readDirEntries(list, 7, DIR_ATT_DIRECTORY, DIR_ATT_DIRECTORY) == 7);
+  CHECK(top.readDirEntries(list, 7, DIR_ATT_DIRECTORY, DIR_ATT_DIRECTORY) == 1);
+  CHECK(top.readDirEntries(list, 7, DIR_ATT_DIRECTORY, DIR_ATT_DIRECTORY) == 0);
+
+  CHECK(top.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  exFAT readDirEntries() ok\n");
+}
+#endif  // SD_EXFAT
@@ -0,0 +1,145 @@
+/****************************************************************************************************************************
+  test_dir_index.cpp
+
+  RP2040_SdFile::open() in large directories, with and without the
+  SD_DIR_INDEX_ENTRIES name index.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <set>
+#include <string>
+
+//------------------------------------------------------------------------------
+// random opens, creates and removes in two directories checked against a
+// model, so the index follows one directory then the other
+HOST_CASE(dirIndex)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile top;
+  RP2040_SdFile sub;
+  CHECK(top.makeDir(&root, "DIRS"));
+  CHECK(sub.makeDir(&top, "SUB"));
+
+  RP2040_SdFile* dirs[2] = { &top, &sub };
+  std::set<std::string> model[2];
+  const int nfiles = 150;
+  srand(7);
+
+  for (int op = 0; op < nfiles * 8; op++)
+  {
+    int d = rand() & 1;
+    char name[13];
+    snprintf(name, sizeof name, "N%d.TXT", rand() % nfiles);
+
+    int r = rand() % 4;
+    bool have = model[d].count(name);
+    RP2040_SdFile f;
+
+    if (r == 0)
+    {
+      CHECK(f.open(dirs[d], name, O_READ) == have);
+
+      if (have)
+      {
+        char c;
+        CHECK(f.read(&c, 1) == 1 && c == name[1]);
+        f.close();
+      }
+    }
+    else if (r == 1)
+    {
+      CHECK(f.open(dirs[d], name, O_CREAT | O_EXCL | O_WRITE) == !have);
+
+      if (!have)
+      {
+        CHECK(f.write(name + 1, 1) == 1);
+        CHECK(f.close());
+        model[d].insert(name);
+      }
+    }
+    else if (r == 2)
+    {
+      CHECK(f.open(dirs[d], name, O_CREAT | O_WRITE));
+
+      if (!have)
+      {
+        CHECK(f.write(name + 1, 1) == 1);
+        model[d].insert(name);
+      }
+
+      CHECK(f.close());
+    }
+    else
+    {
+      CHECK(RP2040_SdFile::remove(dirs[d], name) == have);
+      model[d].erase(name);
+    }
+  }
+
+  // empty and remove a directory, then reuse its entry
+  for (std::set<std::string>::iterator it = model[1].begin(); it != model[1].end(); ++it)
+  {
+    CHECK(RP2040_SdFile::remove(&sub, it->c_str()));
+  }
+
+  CHECK(sub.rmDir());
+
+  RP2040_SdFile s2;
+  RP2040_SdFile g;
+  CHECK(s2.makeDir(&top, "SUB2"));
+  CHECK(!g.open(&s2, "N1.TXT", O_READ));
+  CHECK(g.open(&s2, "N1.TXT", O_CREAT | O_WRITE));
+  CHECK(g.close());
+  CHECK(s2.close());
+
+  for (int i = 0; i < nfiles; i++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "N%d.TXT", i);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&top, name, O_READ) == (bool) model[0].count(name));
+  }
+
+  // lookups of missing names and creates after one scan of the directory
+  SPI.clearStats();
+
+  for (int i = 0; i < 100; i++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "M%d.TXT", i);
+
+    RP2040_SdFile f;
+    CHECK(!f.open(&top, name, O_READ));
+    CHECK(f.open(&top, name, O_CREAT | O_EXCL | O_WRITE));
+    CHECK(f.close());
+  }
+
+  uint32_t reads = SPI.commandCount(17) + SPI.commandCount(18);
+
+#if SD_DIR_INDEX_ENTRIES >= 400
+  // about one block for each create, not a scan for each lookup
+  CHECK(reads < 150);
+#endif  // SD_DIR_INDEX_ENTRIES
+
+  CHECK(top.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  directory index of %u names ok, %u files, %u block reads for 100 lookups and creates\n",
+         (unsigned) SD_DIR_INDEX_ENTRIES, (unsigned) model[0].size(), (unsigned) reads);
+}
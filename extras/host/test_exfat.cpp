@@ -0,0 +1,383 @@
+/****************************************************************************************************************************
+  test_exfat.cpp
+
+  exFAT volumes: files from another formatter, long UTF-8 names, directories
+  past one cluster, NoFatChain files, and entry sets over three blocks.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#if SD_EXFAT
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// read a whole file in 30000 byte pieces and compare with its pattern
+static void readAll(RP2040_SdFile& f, std::vector<uint8_t>& buf, int seed)
+{
+  uint32_t n = f.fileSize();
+
+  for (uint32_t k = 0; k < n; k += 30000)
+  {
+    CHECK(f.read(buf.data() + k, 30000) == (int)(n - k < 30000 ? n - k : 30000));
+  }
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    CHECK(buf[i] == hostPattern(i, seed));
+  }
+}
+//------------------------------------------------------------------------------
+// the files tools/mkexfat.py writes, then changes tools/exfsck.py checks
+HOST_CASE(exFat)
+{
+  std::string path = hostImage("exfat.img");
+  hostFormatExFat(path, 64, 3, true);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&dev, 0));
+  CHECK(vol.fatType() == 64);
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  std::vector<uint8_t> buf(1 << 20);
+  uint32_t first;
+  uint32_t last;
+
+  // files from the formatter, names match without case
+  {
+    RP2040_SdFile f;
+    CHECK(f.open(&root, "pre long NAME.BIN", O_READ));
+    readAll(f, buf, 20);
+    CHECK(f.contiguousRange(&first, &last));
+    f.close();
+
+    CHECK(f.open(&root, "FRAG.DAT", O_READ));
+    CHECK(f.seekSet(f.fileSize() - 5));
+    CHECK(f.read(buf.data(), 5) == 5);
+
+    for (uint32_t i = 0; i < 5; i++)
+    {
+      CHECK(buf[i] == hostPattern(f.fileSize() - 5 + i, 21));
+    }
+
+    CHECK(f.seekSet(0));
+    readAll(f, buf, 21);
+    CHECK(!f.contiguousRange(&first, &last));
+    f.close();
+
+    RP2040_SdFile d;
+    CHECK(d.open(&root, "subdir", O_READ));
+    CHECK(d.isDir());
+    CHECK(f.open(&d, "README.TXT", O_READ));
+    CHECK(f.read(buf.data(), 100) == 12);
+    CHECK(!memcmp(buf.data(), "hello exfat\n", 12));
+    f.close();
+    d.close();
+
+    CHECK(!f.open(&root, "missing.txt", O_READ));
+    CHECK(!f.open(&root, "Pre Long Name.bin", O_CREAT | O_EXCL | O_RDWR));
+  }
+
+  // long mixed case UTF-8 names
+  {
+    const char* name = "A rather long file name \xc3\xa9t\xc3\xa9 with many characters in it.log";
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_EXCL));
+
+    for (int i = 0; i < 5000; i++)
+    {
+      buf[i] = hostPattern(i, 30);
+    }
+
+    CHECK(f.write(buf.data(), 5000) == 5000);
+    CHECK(f.close());
+    CHECK(f.open(&root, "A RATHER LONG FILE NAME \xc3\x89T\xc3\x89 WITH MANY CHARACTERS IN IT.LOG", O_READ));
+    CHECK(f.fileSize() == 5000);
+    f.close();
+
+    CHECK(!f.open(&root, ".", O_CREAT | O_RDWR));
+    CHECK(!f.open(&root, "bad\xff.txt", O_CREAT | O_RDWR));
+  }
+
+  // a directory that grows past one cluster, with removed entries reused
+  {
+    RP2040_SdFile d;
+    CHECK(d.makeDir(&root, "Many Files"));
+
+    for (int i = 0; i < 300; i++)
+    {
+      char name[40];
+      snprintf(name, sizeof name, "entry number %04d.txt", i);
+
+      RP2040_SdFile f;
+      CHECK(f.open(&d, name, O_CREAT | O_WRITE | O_EXCL));
+      CHECK(f.write(name, strlen(name)) == strlen(name));
+      CHECK(f.close());
+    }
+
+    for (int i = 0; i < 300; i += 7)
+    {
+      char name[40];
+      snprintf(name, sizeof name, "ENTRY NUMBER %04d.TXT", i);
+      CHECK(RP2040_SdFile::remove(&d, name));
+    }
+
+    for (int i = 0; i < 300; i++)
+    {
+      char name[40];
+      snprintf(name, sizeof name, "entry number %04d.txt", i);
+
+      RP2040_SdFile f;
+      uint8_t ok = f.open(&d, name, O_READ);
+      CHECK(ok == (i % 7 != 0));
+
+      if (ok)
+      {
+        CHECK(f.read(buf.data(), 100) == (int) strlen(name));
+        CHECK(!memcmp(buf.data(), name, strlen(name)));
+      }
+    }
+
+    RP2040_SdFile f;
+    CHECK(f.open(&d, "x.txt", O_CREAT | O_WRITE));
+    f.close();
+
+    dir_t e;
+    int n = 0;
+    d.rewind();
+
+    while (d.readDir(&e) > 0)
+    {
+      n++;
+    }
+
+    CHECK(n == 300 - 43 + 1);
+    d.close();
+  }
+
+  // nested directories removed with rmRfStar()
+  {
+    RP2040_SdFile d;
+    RP2040_SdFile s;
+    RP2040_SdFile f;
+    CHECK(d.makeDir(&root, "tree"));
+    CHECK(s.makeDir(&d, "inner"));
+    CHECK(f.open(&s, "deep file.bin", O_CREAT | O_WRITE));
+
+    for (int k = 0; k < 7; k++)
+    {
+      CHECK(f.write(buf.data(), 10000) == 10000);
+    }
+
+    f.close();
+    s.close();
+    CHECK(d.rmRfStar());
+    CHECK(!d.open(&root, "tree", O_READ));
+  }
+
+  // FAT chained and contiguous files truncated, removed and written
+  {
+    RP2040_SdFile f;
+    CHECK(f.open(&root, "frag.dat", O_RDWR));
+    CHECK(f.truncate(100));
+    f.close();
+    CHECK(RP2040_SdFile::remove(&root, "Pre Long Name.bin"));
+
+    CHECK(f.open(&root, "P7.BIN", O_CREAT | O_RDWR));
+
+    for (uint32_t i = 0; i < buf.size(); i++)
+    {
+      buf[i] = hostPattern(i, 7);
+    }
+
+    for (uint32_t k = 0; k < buf.size(); k += 32768)
+    {
+      CHECK(f.write(buf.data() + k, 32768) == 32768);
+    }
+
+    CHECK(f.close());
+
+    RP2040_SdFile c;
+    CHECK(c.createContiguous(&root, "P8.BIN", 200000));
+    CHECK(c.contiguousRange(&first, &last));
+
+    for (uint32_t i = 0; i < 200000; i++)
+    {
+      buf[i] = hostPattern(i, 8);
+    }
+
+    for (uint32_t k = 0; k < 200000; k += 20000)
+    {
+      CHECK(c.write(buf.data() + k, 20000) == 20000);
+    }
+
+    CHECK(c.close());
+  }
+
+  int32_t free = vol.freeClusterCount();
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  exFAT ok, %d free clusters\n", (int) free);
+}
+//------------------------------------------------------------------------------
+// a name of 255 characters, seed k in its last characters
+static void longName(char* name, int k, char first)
+{
+  for (int i = 0; i < 255; i++)
+  {
+    name[i] = first + i % 26;
+  }
+
+  snprintf(name + 250, 6, "%02d.nm", k);
+}
+//------------------------------------------------------------------------------
+// 19 entry sets of 255 character names that start at each index of a
+// directory block, so sets from index 14 end in the second block after
+// the first.  One block clusters put the three blocks in three clusters,
+// not always next to each other since the directories grow in turn.
+HOST_CASE(exFatLongNames)
+{
+  std::string path = hostImage("exfat.img");
+  hostFormatExFat(path, 16, 0, false);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&dev, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile dir[16];
+
+  for (int k = 0; k < 16; k++)
+  {
+    char name[8];
+    snprintf(name, sizeof name, "d%02d", k);
+    CHECK(dir[k].makeDir(&root, name));
+  }
+
+  // three entry sets for names of up to 15 characters, four up to 30, so
+  // 3a + 4b entries before the long name start it at index k of a block
+  int fillers[16];
+
+  for (int k = 0; k < 16; k++)
+  {
+    int a = -1;
+    int b = 0;
+
+    for (int t = k; a < 0; t += 16)
+    {
+      for (int i = 0; 3 * i <= t && a < 0; i++)
+      {
+        if ((t - 3 * i) % 4 == 0)
+        {
+          a = i;
+          b = (t - 3 * i) / 4;
+        }
+      }
+    }
+
+    fillers[k] = a + b;
+
+    for (int i = 0; i < a + b; i++)
+    {
+      char name[32];
+      snprintf(name, sizeof name, i < a ? "s%d" : "a longer name %02d", i);
+
+      RP2040_SdFile f;
+      CHECK(f.open(&dir[k], name, O_CREAT | O_WRITE | O_EXCL));
+      CHECK(f.close());
+    }
+  }
+
+  char name[256];
+  uint8_t buf[600];
+
+  for (int k = 0; k < 16; k++)
+  {
+    longName(name, k, 'a');
+
+    RP2040_SdFile f;
+    CHECK(f.open(&dir[k], name, O_CREAT | O_RDWR | O_EXCL));
+
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(i, k);
+    }
+
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+    CHECK(f.close());
+  }
+
+  // open in upper case, grow so the set is written again, and list
+  for (int k = 0; k < 16; k++)
+  {
+    longName(name, k, 'A');
+
+    RP2040_SdFile f;
+    CHECK(f.open(&dir[k], name, O_RDWR | O_APPEND));
+    CHECK(f.fileSize() == sizeof buf);
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+    CHECK(f.close());
+
+    CHECK(f.open(&dir[k], name, O_READ));
+    CHECK(f.fileSize() == 2 * sizeof buf);
+    CHECK(f.read(buf, sizeof buf) == sizeof buf);
+
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      CHECK(buf[i] == hostPattern(i, k));
+    }
+
+    CHECK(f.close());
+
+    dir_t e;
+    int n = 0;
+    dir[k].rewind();
+
+    while (dir[k].readDir(&e) > 0)
+    {
+      n++;
+    }
+
+    CHECK(n == fillers[k] + 1);
+  }
+
+  // remove every other one, a new long name reuses the free run
+  for (int k = 0; k < 16; k += 2)
+  {
+    longName(name, k, 'a');
+    CHECK(RP2040_SdFile::remove(&dir[k], name));
+
+    RP2040_SdFile f;
+    CHECK(!f.open(&dir[k], name, O_READ));
+
+    longName(name, k + 50, 'b');
+    CHECK(f.open(&dir[k], name, O_CREAT | O_RDWR | O_EXCL));
+    CHECK(f.write(buf, 100) == 100);
+    CHECK(f.close());
+  }
+
+  for (int k = 0; k < 16; k++)
+  {
+    dir[k].close();
+  }
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  exFAT 255 character names ok at each block index\n");
+}
+
+#endif  // SD_EXFAT
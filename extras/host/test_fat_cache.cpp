@@ -0,0 +1,88 @@
+/****************************************************************************************************************************
+  test_fat_cache.cpp
+
+  The RP2040_SdVolume FAT window: cluster chain walks read each FAT block
+  once and do not evict file data from the block cache.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// a sequential read in small pieces reads each data block and FAT block once
+HOST_CASE(fatWindow)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  // one block clusters so every block boundary is a FAT lookup
+  const uint32_t total = 300000;
+  const uint32_t blocks = (total + 511) / 512;
+
+  {
+    RP2040_SdVolume vol;
+    CHECK(vol.init(&card, 0));
+
+    RP2040_SdFile root;
+    CHECK(root.openRoot(&vol));
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, "F4.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+    uint8_t buf[1000];
+
+    for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, 4);
+      }
+
+      CHECK(f.write(buf, sizeof buf) == sizeof buf);
+    }
+
+    CHECK(f.close());
+    CHECK(vol.sync());
+  }
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F4.BIN", O_READ));
+
+  SPI.clearStats();
+
+  uint8_t buf[100];
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    CHECK(f.read(buf, sizeof buf) == (int) sizeof buf);
+
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      CHECK(buf[i] == hostPattern(pos + i, 4));
+    }
+  }
+
+  // 128 FAT32 entries a block, the window fills with one command
+  uint32_t fatBlocks = (blocks + 127) / 128 + 1;
+  uint32_t windows = (fatBlocks + SD_FAT_CACHE_BLOCKS - 1) / SD_FAT_CACHE_BLOCKS + 1;
+  uint32_t reads = SPI.commandCount(17) + SPI.commandCount(18);
+
+  CHECK(reads <= blocks + windows);
+  CHECK(SPI.commandCount(18) <= windows);
+
+  CHECK(f.close());
+  dev.end();
+  hostFsck(path);
+
+  printf("  FAT window ok, %u data blocks in %u reads, %u blocks a window\n", (unsigned) blocks,
+         (unsigned) reads, (unsigned) SD_FAT_CACHE_BLOCKS);
+}
@@ -0,0 +1,88 @@
+/****************************************************************************************************************************
+  test_fat_mirror.cpp
+
+  Second FAT updates for each SD_FAT_MIRROR_MODE: when the second FAT
+  matches the first, and that it always does after RP2040_SdVolume::sync().
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// true if the two FATs on the device are the same
+static bool fatsMatch(RP2040_BlockDevice& dev, RP2040_SdVolume& vol)
+{
+  uint8_t a[512];
+  uint8_t b[512];
+
+  for (uint32_t i = 0; i < vol.blocksPerFat(); i++)
+  {
+    CHECK(dev.readBlock(vol.fatStartBlock() + i, a));
+    CHECK(dev.readBlock(vol.fatStartBlock() + vol.blocksPerFat() + i, b));
+
+    if (memcmp(a, b, 512))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// appends that change many FAT blocks, checked after close() and sync()
+HOST_CASE(fatMirror)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+  CHECK(vol.fatCount() == 2);
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // two files growing in turn so their clusters interleave
+  RP2040_SdFile f[2];
+  CHECK(f[0].open(&root, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(f[1].open(&root, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  const uint32_t total = 200000;
+  uint8_t buf[1000];
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (int k = 0; k < 2; k++)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, k);
+      }
+
+      CHECK(f[k].write(buf, sizeof buf) == sizeof buf);
+    }
+  }
+
+  CHECK(f[0].close());
+  CHECK(f[1].close());
+
+  // modes 0 and 1 write the mirrors by close(), mode 2 only at sync()
+  CHECK(fatsMatch(card, vol) == (SD_FAT_MIRROR_MODE != 2));
+
+  CHECK(vol.sync());
+  CHECK(fatsMatch(card, vol));
+
+  // free both chains
+  CHECK(RP2040_SdFile::remove(&root, "F0.BIN"));
+  CHECK(RP2040_SdFile::remove(&root, "F1.BIN"));
+  CHECK(vol.sync());
+  CHECK(fatsMatch(card, vol));
+
+  dev.end();
+  hostFsck(path);
+
+  printf("  second FAT ok, mode %d\n", SD_FAT_MIRROR_MODE);
+}
@@ -0,0 +1,132 @@
+/****************************************************************************************************************************
+  test_file_extents.cpp
+
+  Seeks, reads, writes and truncate on fragmented files, with the cluster
+  extents of SD_FILE_EXTENTS or with FAT walks.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+static void fill(uint8_t* buf, uint32_t pos, uint16_t n, int seed)
+{
+  for (uint16_t i = 0; i < n; i++)
+  {
+    buf[i] = hostPattern(pos + i, seed);
+  }
+}
+//------------------------------------------------------------------------------
+// two files grown in turn, each in runs of 80 one block clusters
+HOST_CASE(fileExtents)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  const uint32_t total = 400000;
+  const uint16_t chunk = 8000;
+  static uint8_t buf[chunk];
+
+  {
+    RP2040_SdFile f[2];
+    CHECK(f[0].open(&root, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+    CHECK(f[1].open(&root, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+    for (uint32_t pos = 0; pos < total; pos += 5 * chunk)
+    {
+      for (int k = 0; k < 2; k++)
+      {
+        for (uint32_t p = pos; p < pos + 5 * chunk; p += chunk)
+        {
+          fill(buf, p, chunk, k);
+          CHECK(f[k].write(buf, chunk) == chunk);
+        }
+      }
+    }
+
+    uint32_t first;
+    uint32_t last;
+    CHECK(!f[0].contiguousRange(&first, &last));
+    CHECK(f[0].close());
+    CHECK(f[1].close());
+  }
+
+  // random seeks and reads after one pass over the file
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F0.BIN", O_READ));
+
+  for (uint32_t pos = 0; pos < total; pos += chunk)
+  {
+    CHECK(f.read(buf, chunk) == chunk);
+  }
+
+  srand(13);
+  const int seeks = 500;
+  uint8_t rb[100];
+
+  SPI.clearStats();
+
+  for (int k = 0; k < seeks; k++)
+  {
+    uint32_t pos = rand() % (total - sizeof rb);
+    CHECK(f.seekSet(pos));
+    CHECK(f.read(rb, sizeof rb) == sizeof rb);
+
+    for (uint16_t i = 0; i < sizeof rb; i++)
+    {
+      CHECK(rb[i] == hostPattern(pos + i, 0));
+    }
+  }
+
+  uint32_t reads = SPI.commandCount(17) + SPI.commandCount(18);
+
+#if SD_FILE_EXTENTS >= 10
+  // every run is known, only data blocks are read
+  CHECK(reads <= 2 * seeks);
+#endif
+
+  CHECK(f.close());
+
+  // writes at random places of the other file, fsck.py checks both
+  CHECK(f.open(&root, "F1.BIN", O_RDWR));
+
+  for (int k = 0; k < seeks; k++)
+  {
+    uint32_t pos = rand() % (total - sizeof rb);
+    fill(rb, pos, sizeof rb, 1);
+    CHECK(f.seekSet(pos));
+    CHECK(f.write(rb, sizeof rb) == sizeof rb);
+  }
+
+  // cut inside a run, seek back into what remains and grow again
+  CHECK(f.truncate(total / 2 + 1234));
+  CHECK(f.seekSet(1000));
+  CHECK(f.read(rb, sizeof rb) == sizeof rb);
+  CHECK(rb[0] == hostPattern(1000, 1));
+  CHECK(f.seekEnd());
+
+  for (uint32_t pos = f.curPosition(); pos < total; )
+  {
+    uint16_t n = total - pos < chunk ? total - pos : chunk;
+    fill(buf, pos, n, 1);
+    CHECK(f.write(buf, n) == n);
+    pos += n;
+  }
+
+  CHECK(f.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  extents ok, %d seeks in %u reads, %u extents a file\n", seeks, (unsigned) reads,
+         (unsigned) SD_FILE_EXTENTS);
+}
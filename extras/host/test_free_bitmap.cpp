@@ -0,0 +1,140 @@
+/****************************************************************************************************************************
+  test_free_bitmap.cpp
+
+  Cluster allocation on a nearly full volume with holes, with and without
+  the free cluster bitmap of SD_FREE_BITMAP_BYTES.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+static void writeFile(RP2040_SdFile& root, const char* name, uint32_t total, int seed)
+{
+  static uint8_t buf[16384];
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+
+  for (uint32_t pos = 0; pos < total; )
+  {
+    uint16_t n = total - pos < sizeof buf ? total - pos : sizeof buf;
+
+    for (uint16_t i = 0; i < n; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(f.write(buf, n) == n);
+    pos += n;
+  }
+
+  CHECK(f.close());
+}
+//------------------------------------------------------------------------------
+// fill every free cluster, holes included, then free some and allocate again
+HOST_CASE(freeBitmap)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 16, 16, 4);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // most of the volume, then two cluster holes between small files
+  writeFile(root, "F0.BIN", 12000000, 0);
+
+  for (int k = 0; k < 30; k++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "P%d.BIN", k);
+    writeFile(root, name, 4096, k);
+  }
+
+  for (int k = 0; k < 30; k += 2)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "P%d.BIN", k);
+    CHECK(RP2040_SdFile::remove(&root, name));
+  }
+
+  CHECK(vol.sync());
+
+  // the bitmap is built at mount
+  CHECK(vol.init(&card, 0));
+  root.close();
+  CHECK(root.openRoot(&vol));
+
+  int32_t free = vol.freeClusterCount();
+  CHECK(free > 15 * 2);
+
+  // a cluster a write until the volume is full
+  const uint16_t clusterBytes = 512 * vol.blocksPerCluster();
+  static uint8_t buf[2048];
+  CHECK(clusterBytes == sizeof buf);
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  uint32_t written = 0;
+
+  for (;;)
+  {
+    for (uint16_t i = 0; i < clusterBytes; i++)
+    {
+      buf[i] = hostPattern(written + i, 1);
+    }
+
+    if (f.write(buf, clusterBytes) != clusterBytes)
+    {
+      break;
+    }
+
+    written += clusterBytes;
+  }
+
+  CHECK(written == (uint32_t) free * clusterBytes);
+  CHECK(vol.freeClusterCount() == 0);
+  f.clearWriteError();
+  CHECK(f.close());
+
+  CHECK(f.open(&root, "F1.BIN", O_READ));
+  CHECK(f.fileSize() == written);
+
+  for (uint32_t pos = 0; pos < written; pos += clusterBytes)
+  {
+    CHECK(f.read(buf, clusterBytes) == clusterBytes);
+
+    for (uint16_t i = 0; i < clusterBytes; i++)
+    {
+      CHECK(buf[i] == hostPattern(pos + i, 1));
+    }
+  }
+
+  CHECK(f.close());
+
+  // a freed cluster in the middle of the volume is found again
+  CHECK(RP2040_SdFile::remove(&root, "P15.BIN"));
+  CHECK(vol.freeClusterCount() == 2);
+  SPI.clearStats();
+  writeFile(root, "P16.BIN", 4096, 16);
+  CHECK(vol.freeClusterCount() == 0);
+
+#if SD_FREE_BITMAP_BYTES
+  // no scan of the FAT for it
+  CHECK(SPI.commandCount(17) + SPI.commandCount(18) < 8);
+#endif
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  allocation on a full volume ok, %u free clusters filled, bitmap %u bytes\n",
+         (unsigned) free, (unsigned) SD_FREE_BITMAP_BYTES);
+}
@@ -0,0 +1,133 @@
+/****************************************************************************************************************************
+  test_free_count.cpp
+
+  RP2040_SdVolume::freeClusterCount() against a count of the zero entries
+  of the FAT, on FAT16 and FAT32 volumes with holes.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// free clusters one FAT entry at a time
+static uint32_t countFree(RP2040_BlockDevice& dev, RP2040_SdVolume& vol)
+{
+  uint8_t block[512];
+  uint32_t cached = 0XFFFFFFFF;
+  uint32_t n = 0;
+  uint8_t shift = vol.fatType() == 16 ? 8 : 7;
+
+  for (uint32_t c = 2; c <= vol.clusterCount() + 1; c++)
+  {
+    uint32_t lba = vol.fatStartBlock() + (c >> shift);
+
+    if (lba != cached)
+    {
+      CHECK(dev.readBlock(lba, block));
+      cached = lba;
+    }
+
+    uint32_t e;
+
+    if (vol.fatType() == 16)
+    {
+      uint16_t e16;
+      memcpy(&e16, block + 2 * (c & 0XFF), 2);
+      e = e16;
+    }
+    else
+    {
+      memcpy(&e, block + 4 * (c & 0X7F), 4);
+      e &= 0X0FFFFFFF;
+    }
+
+    n += e == 0;
+  }
+
+  return n;
+}
+//------------------------------------------------------------------------------
+// files with holes between them, the count from a fresh mount
+static void freeCount(int fatType, int sizeMB, int blocksPerCluster)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, fatType, sizeMB, blocksPerCluster);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  uint8_t buf[1000];
+
+  for (int k = 0; k < 20; k++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "F%d.BIN", k);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+
+    for (uint32_t pos = 0; pos < 1000UL * (k + 1); pos += sizeof buf)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, k);
+      }
+
+      CHECK(f.write(buf, sizeof buf) == sizeof buf);
+    }
+
+    CHECK(f.close());
+  }
+
+  for (int k = 1; k < 20; k += 3)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "F%d.BIN", k);
+    CHECK(RP2040_SdFile::remove(&root, name));
+  }
+
+  CHECK(vol.sync());
+
+  // FSINFO without a count so the mount leaves the count unknown
+  if (fatType == 32)
+  {
+    uint8_t block[512];
+    CHECK(card.readBlock(1, block));
+    memset(block + 488, 0XFF, 4);
+    CHECK(card.writeBlock(1, block));
+  }
+
+  CHECK(vol.init(&card, 0));
+
+  uint32_t ref = countFree(card, vol);
+
+  // one multiple block read of the FAT, or none if the mount knows the count
+  SPI.clearStats();
+  CHECK(vol.freeClusterCount() == (int32_t) ref);
+  CHECK(SPI.commandCount(17) == 0 && SPI.commandCount(18) <= 1);
+
+  // kept up to date once known
+  root.close();
+  CHECK(root.openRoot(&vol));
+  CHECK(RP2040_SdFile::remove(&root, "F0.BIN"));
+  CHECK(vol.freeClusterCount() == (int32_t) countFree(card, vol));
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  free count ok, FAT%d %u clusters, %u free\n", fatType, (unsigned) vol.clusterCount(),
+         (unsigned) ref);
+}
+//------------------------------------------------------------------------------
+HOST_CASE(freeCount)
+{
+  freeCount(16, 16, 4);
+  freeCount(32, 40, 1);
+}
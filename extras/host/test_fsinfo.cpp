@@ -0,0 +1,98 @@
+/****************************************************************************************************************************
+  test_fsinfo.cpp
+
+  The FAT32 FSINFO sector: the free count and next free hint are written
+  back by sync() and used by the next mount instead of a FAT walk.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// the FSINFO sector of an unpartitioned FAT32 image
+static void readFsInfo(RP2040_BlockDevice& dev, uint32_t& freeCount, uint32_t& nextFree)
+{
+  uint8_t block[512];
+  CHECK(dev.readBlock(1, block));
+  memcpy(&freeCount, block + 488, 4);
+  memcpy(&nextFree, block + 492, 4);
+}
+//------------------------------------------------------------------------------
+static void writeFile(RP2040_SdFile& root, const char* name, uint32_t total, int seed)
+{
+  RP2040_SdFile f;
+  CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+
+  uint8_t buf[4096];
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+  }
+
+  CHECK(f.close());
+}
+//------------------------------------------------------------------------------
+// a count unknown at format, learned, kept through allocation and free
+HOST_CASE(fsInfo)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  uint32_t freeCount;
+  uint32_t nextFree;
+  readFsInfo(dev, freeCount, nextFree);
+  CHECK(freeCount == 0XFFFFFFFF);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // 128 FAT blocks of allocated clusters ahead of the first free one
+  const uint32_t total = 8 * 1024 * 1024;
+  writeFile(root, "F0.BIN", total, 0);
+
+  int32_t free = vol.freeClusterCount();
+  CHECK(free > 0);
+  CHECK(vol.sync());
+
+  readFsInfo(dev, freeCount, nextFree);
+  CHECK(freeCount == (uint32_t) free);
+  CHECK(nextFree > total / 512);
+
+  // neither the count nor the first allocation after a mount walk the FAT
+  CHECK(vol.init(&card, 0));
+  root.close();
+  CHECK(root.openRoot(&vol));
+
+  SPI.clearStats();
+  CHECK(vol.freeClusterCount() == free);
+  CHECK(SPI.commandCount(17) + SPI.commandCount(18) == 0);
+
+  writeFile(root, "F1.BIN", 4096, 1);
+  CHECK(SPI.commandCount(17) + SPI.commandCount(18) < 8);
+  CHECK(vol.freeClusterCount() == free - 8);
+
+  // a free moves the count and sync() writes it
+  CHECK(RP2040_SdFile::remove(&root, "F0.BIN"));
+  CHECK(vol.freeClusterCount() == free - 8 + (int32_t) (total / 512));
+  CHECK(vol.sync());
+
+  readFsInfo(dev, freeCount, nextFree);
+  CHECK(freeCount == (uint32_t) vol.freeClusterCount());
+
+  dev.end();
+  hostFsck(path);
+
+  printf("  FSINFO ok, %u free clusters, next free %u\n", (unsigned) freeCount, (unsigned) nextFree);
+}
@@ -0,0 +1,138 @@
+/****************************************************************************************************************************
+  test_multi_block_read.cpp
+
+  CMD18 multiple block reads in Sd2Card and RP2040_SdFile::read(), and the
+  card state after a read error in the middle of a stream.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// Sd2Card readStart(), readData() and readStop(), with and without an error
+HOST_CASE(cardMultiBlockRead)
+{
+  std::string path = hostImage("card.img");
+  hostBlank(path, 8192);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  uint8_t buf[512];
+  uint8_t in[512];
+
+  for (uint32_t b = 100; b < 120; b++)
+  {
+    for (int i = 0; i < 512; i++)
+    {
+      buf[i] = hostPattern(i, b);
+    }
+
+    CHECK(dev.writeBlock(b, buf));
+  }
+
+  CHECK(card.readStart(100));
+
+  for (uint32_t b = 100; b < 120; b++)
+  {
+    CHECK(card.readData(in));
+    CHECK(in[0] == hostPattern(0, b) && in[511] == hostPattern(511, b));
+  }
+
+  CHECK(card.readStop());
+  CHECK(SPI.commandCount(18) == 1 && SPI.commandCount(12) == 1 && SPI.commandCount(17) == 0);
+
+  // an error token for block 105 ends the stream, the card takes commands again
+  SPI.setReadError(105);
+  SPI.clearStats();
+
+  CHECK(card.readStart(100));
+
+  for (uint32_t b = 100; b < 105; b++)
+  {
+    CHECK(card.readData(in));
+  }
+
+  CHECK(!card.readData(in));
+  CHECK(card.errorCode() == SD_CARD_ERROR_READ);
+  CHECK(SPI.commandCount(12) == 1);
+
+  CHECK(card.readBlock(110, in));
+  CHECK(in[0] == hostPattern(0, 110) && in[511] == hostPattern(511, 110));
+
+  SPI.setReadError(0XFFFFFFFF);
+  dev.end();
+
+  printf("  CMD18 stream ok, stopped with CMD12 after a read error\n");
+}
+//------------------------------------------------------------------------------
+// RP2040_SdFile::read() of whole blocks uses CMD18, a failed read leaves the
+// volume usable
+HOST_CASE(fileMultiBlockRead)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  const uint16_t total = 30000;
+  static uint8_t buf[total];
+
+  for (uint32_t i = 0; i < total; i++)
+  {
+    buf[i] = hostPattern(i, 3);
+  }
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F3.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(f.write(buf, total) == total);
+  CHECK(f.sync());
+
+  // a large read of a contiguous file is a few streams
+  memset(buf, 0, total);
+  CHECK(f.seekSet(0));
+  SPI.clearStats();
+  CHECK(f.read(buf, total) == (int) total);
+
+  for (uint32_t i = 0; i < total; i++)
+  {
+    CHECK(buf[i] == hostPattern(i, 3));
+  }
+
+  uint32_t streams = SPI.commandCount(18);
+  uint32_t singles = SPI.commandCount(17);
+  CHECK(streams > 0 && streams == SPI.commandCount(12));
+  CHECK(singles < total / 512 / 4);
+
+  // fail a block in the middle of the file, then read it again
+  uint32_t middle = vol.dataStartBlock() + (f.firstCluster() - 2) * vol.blocksPerCluster() + 30;
+  SPI.setReadError(middle);
+  CHECK(f.seekSet(0));
+  CHECK(f.read(buf, total) < 0);
+
+  SPI.setReadError(0XFFFFFFFF);
+  memset(buf, 0, total);
+  CHECK(f.seekSet(0));
+  CHECK(f.read(buf, total) == (int) total);
+
+  for (uint32_t i = 0; i < total; i++)
+  {
+    CHECK(buf[i] == hostPattern(i, 3));
+  }
+
+  CHECK(f.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  file read ok, %u blocks in %u CMD18 streams and %u CMD17\n",
+         (unsigned)((total + 511) / 512), (unsigned) streams, (unsigned) singles);
+}
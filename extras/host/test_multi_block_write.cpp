@@ -0,0 +1,146 @@
+/****************************************************************************************************************************
+  test_multi_block_write.cpp
+
+  CMD25 multiple block writes in Sd2Card and RP2040_SdFile::write(), on
+  contiguous and fragmented free space.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// Sd2Card writeStart(), writeData() and writeStop()
+HOST_CASE(cardMultiBlockWrite)
+{
+  std::string path = hostImage("card.img");
+  hostBlank(path, 8192);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  uint8_t buf[512];
+
+  CHECK(card.writeStart(200, 16));
+
+  for (uint32_t b = 200; b < 216; b++)
+  {
+    for (int i = 0; i < 512; i++)
+    {
+      buf[i] = hostPattern(i, b);
+    }
+
+    CHECK(card.writeData(buf));
+  }
+
+  CHECK(card.writeStop());
+  CHECK(SPI.commandCount(25) == 1 && SPI.commandCount(0X40 | 23) == 1 && SPI.commandCount(24) == 0);
+
+  for (uint32_t b = 200; b < 216; b++)
+  {
+    CHECK(dev.readBlock(b, buf));
+    CHECK(buf[0] == hostPattern(0, b) && buf[511] == hostPattern(511, b));
+  }
+
+  dev.end();
+
+  printf("  CMD25 stream ok\n");
+}
+//------------------------------------------------------------------------------
+// write \a total bytes of pattern \a seed to \a name in 16 KB chunks
+static void writeFile(RP2040_SdFile& root, const char* name, uint32_t total, int seed)
+{
+  static uint8_t buf[16384];
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+
+  for (uint32_t pos = 0; pos < total; )
+  {
+    uint16_t n = total - pos < sizeof buf ? total - pos : sizeof buf;
+
+    for (uint16_t i = 0; i < n; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(f.write(buf, n) == n);
+    pos += n;
+  }
+
+  CHECK(f.close());
+}
+//------------------------------------------------------------------------------
+// RP2040_SdFile::write() of whole blocks uses CMD25 across clusters, and
+// splits the stream where the free space is fragmented
+HOST_CASE(fileMultiBlockWrite)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // contiguous free space, one cluster is one block
+  SPI.clearStats();
+  writeFile(root, "F0.BIN", 262144, 0);
+
+  uint32_t streams = SPI.commandCount(25);
+  uint32_t singles = SPI.commandCount(24);
+  CHECK(streams > 0 && streams == SPI.commandCount(0X40 | 23));
+  CHECK(singles < 262144 / 512 / 8);
+
+  // one cluster holes between small files
+  for (int k = 0; k < 40; k++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "P%d.BIN", k);
+    writeFile(root, name, 512, k);
+  }
+
+  for (int k = 0; k < 40; k += 2)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "P%d.BIN", k);
+    CHECK(RP2040_SdFile::remove(&root, name));
+  }
+
+  writeFile(root, "F1.BIN", 131072, 1);
+
+  // read back through the card
+  const char* names[] = {"F0.BIN", "F1.BIN"};
+  const uint32_t sizes[] = {262144, 131072};
+  static uint8_t in[16384];
+
+  for (int k = 0; k < 2; k++)
+  {
+    RP2040_SdFile f;
+    CHECK(f.open(&root, names[k], O_READ));
+    CHECK(f.fileSize() == sizes[k]);
+
+    for (uint32_t pos = 0; pos < sizes[k]; pos += sizeof in)
+    {
+      CHECK(f.read(in, sizeof in) == (int) sizeof in);
+
+      for (uint32_t i = 0; i < sizeof in; i++)
+      {
+        CHECK(in[i] == hostPattern(pos + i, k));
+      }
+    }
+
+    CHECK(f.close());
+  }
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  file write ok, %u blocks in %u CMD25 streams and %u CMD24\n",
+         (unsigned)(262144 / 512), (unsigned) streams, (unsigned) singles);
+}
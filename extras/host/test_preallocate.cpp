@@ -0,0 +1,115 @@
+/****************************************************************************************************************************
+  test_preallocate.cpp
+
+  RP2040_SdFile::preallocate(): appends use the reservation, it stays with
+  the file after close() and truncate() releases it.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+static void append(RP2040_SdFile& f, uint32_t total, int seed)
+{
+  uint8_t buf[1000];
+
+  for (uint32_t pos = f.fileSize(); pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+  }
+}
+//------------------------------------------------------------------------------
+// preallocate, close, open again and append
+HOST_CASE(preallocate)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  const uint32_t cs = 512UL * vol.blocksPerCluster();
+  const uint32_t reserve = 20 * cs;
+  uint32_t length;
+
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "P3.BIN", O_CREAT | O_RDWR | O_APPEND | O_TRUNC));
+  CHECK(f.preallocate(reserve));
+  CHECK(f.fileSize() == 0);
+
+  int32_t reserved = vol.freeClusterCount();
+  uint32_t first = f.firstCluster();
+
+  // appends inside the reservation take no cluster, nor does close()
+  // release the rest
+  append(f, 5000, 3);
+  CHECK(vol.freeClusterCount() == reserved);
+  CHECK(f.close());
+  CHECK(f.fileSize() == 5000);
+  CHECK(vol.freeClusterCount() == reserved);
+  CHECK(hostChainRuns(card, vol, first, &length) == 1 && length == 20);
+
+  // another file takes the clusters after the reservation
+  RP2040_SdFile g;
+  CHECK(g.open(&root, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  append(g, 2000, 0);
+  CHECK(g.close());
+  reserved = vol.freeClusterCount();
+
+  // opened again, appends fill the reservation then grow past it
+  CHECK(f.open(&root, "P3.BIN", O_RDWR | O_APPEND));
+  append(f, 10000, 3);
+  CHECK(vol.freeClusterCount() == reserved);
+  append(f, 14000, 3);
+  CHECK(vol.freeClusterCount() < reserved);
+  CHECK(f.close());
+
+  CHECK(hostChainRuns(card, vol, first, &length) == 2);
+  CHECK(length == (14000 + cs - 1) / cs);
+
+  // an empty file keeps its reserved first cluster
+  CHECK(f.open(&root, "P4.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(f.preallocate(4 * cs));
+  first = f.firstCluster();
+  CHECK(first != 0);
+  CHECK(f.close());
+
+  reserved = vol.freeClusterCount();
+  CHECK(f.open(&root, "P4.BIN", O_RDWR));
+  append(f, 1000, 4);
+  CHECK(f.firstCluster() == first);
+  CHECK(vol.freeClusterCount() == reserved);
+
+  // truncate() releases what was not written
+  CHECK(f.truncate(f.fileSize()));
+  CHECK(vol.freeClusterCount() == reserved + 2);
+  CHECK(f.close());
+
+  // an allocation batch is released and a reservation after it kept
+  CHECK(f.open(&root, "P5.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  append(f, 1000, 5);
+  CHECK(f.preallocate(3 * cs));
+  CHECK(f.close());
+  CHECK(hostChainRuns(card, vol, f.firstCluster(), &length) == 1 && length == 3);
+
+  CHECK(f.open(&root, "P5.BIN", O_RDWR));
+  CHECK(f.truncate(f.fileSize()));
+  CHECK(f.close());
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  preallocate ok, kept across close()\n");
+}
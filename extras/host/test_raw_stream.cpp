@@ -0,0 +1,122 @@
+/****************************************************************************************************************************
+  test_raw_stream.cpp
+
+  RP2040_RawStreamWriter: one CMD25 stream over a contiguous file, overruns
+  when the caller does not poll, and the size committed by finish().
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// stream \a total bytes of pattern \a seed in 100 byte records, \a polls calls
+// of poll() after each
+static void stream(RP2040_RawStreamWriter& w, uint32_t total, int seed, uint32_t polls)
+{
+  uint8_t buf[100];
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    uint32_t n = total - pos < sizeof buf ? total - pos : sizeof buf;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(w.write(buf, n) == n);
+
+    for (uint32_t k = 0; k < polls; k++)
+    {
+      CHECK(w.poll());
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// two streams on a card busy 400 bytes after each block, then a full file
+HOST_CASE(rawStream)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  int32_t free = vol.freeClusterCount();
+  SPI.setLatency(25, 400);
+
+  // no polls, write() waits for the card at most blocks
+  const uint32_t total = 300050;
+  RP2040_RawStreamWriter w;
+  CHECK(w.begin(&root, "P9.BIN", 1000000));
+  CHECK(w.isOpen());
+  CHECK(!w.begin(&root, "P8.BIN", 1000));
+
+  SPI.clearStats();
+  stream(w, total, 9, 0);
+  CHECK(w.bytesWritten() == total);
+  CHECK(w.overrunCount() > 0);
+
+  // neither the FAT nor the directory is written before finish()
+  CHECK(SPI.commandCount(24) == 0 && SPI.commandCount(25) == 0);
+  CHECK(w.finish());
+  CHECK(!w.isOpen());
+  CHECK(!w.finish());
+
+  uint32_t clusters = (total + 511) / 512;
+  CHECK(vol.freeClusterCount() == free - (int32_t) clusters);
+
+  // polled while idle, write() never waits
+  CHECK(!w.begin(&root, "P9.BIN", 1000));
+  CHECK(w.begin(&root, "P8.BIN", 1000000));
+  stream(w, total, 8, 100);
+  CHECK(w.overrunCount() == 0);
+  CHECK(w.finish());
+
+  // write() stops at the maximum size
+  CHECK(w.begin(&root, "P7.BIN", 1000));
+  stream(w, 1000, 7, 0);
+  CHECK(w.write((const uint8_t*) "x", 1) == 0);
+  CHECK(w.finish());
+
+  SPI.setLatency(25, 0);
+
+  RP2040_SdFile f;
+  uint32_t first;
+  uint32_t last;
+  uint8_t buf[1000];
+  CHECK(f.open(&root, "P9.BIN", O_READ));
+  CHECK(f.fileSize() == total);
+  CHECK(f.contiguousRange(&first, &last));
+  CHECK(last - first + 1 == clusters);
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    int n = f.read(buf, sizeof buf);
+    CHECK(n == (int)(total - pos < sizeof buf ? total - pos : sizeof buf));
+
+    for (int i = 0; i < n; i++)
+    {
+      CHECK(buf[i] == hostPattern(pos + i, 9));
+    }
+  }
+
+  CHECK(f.read(buf, sizeof buf) == 0);
+  f.close();
+
+  CHECK(f.open(&root, "P7.BIN", O_READ));
+  CHECK(f.fileSize() == 1000);
+  f.close();
+
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  raw stream ok, CMD25 busy 400 bytes\n");
+}
@@ -0,0 +1,176 @@
+/****************************************************************************************************************************
+  test_read_at.cpp
+
+  RP2040_SdFile::readAt() and writeAt() on fragmented files: results match
+  a model, the cursor does not move and reads near the last position need
+  no walk of the chain.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+// random appends, reads, positional reads and writes and seeks of a file
+// grown in turn with another, checked against a model
+HOST_CASE(readAtWriteAt)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&dev, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  static uint8_t buf[5000];
+
+  // two fragmented files the random steps leave alone
+  {
+    RP2040_SdFile a;
+    RP2040_SdFile b;
+    CHECK(a.open(&root, "A.TXT", O_CREAT | O_RDWR | O_TRUNC));
+    CHECK(b.open(&root, "B.TXT", O_CREAT | O_RDWR | O_TRUNC));
+
+    for (uint32_t pos = 0; pos < 100000; pos += sizeof buf)
+    {
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, 10);
+      }
+
+      CHECK(a.write(buf, sizeof buf) == sizeof buf);
+
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(pos + i, 11);
+      }
+
+      CHECK(b.write(buf, sizeof buf) == sizeof buf);
+    }
+
+    uint32_t first;
+    uint32_t last;
+    CHECK(!a.contiguousRange(&first, &last));
+    CHECK(a.close());
+    CHECK(b.close());
+  }
+
+  RP2040_SdFile f;
+  RP2040_SdFile g;
+  CHECK(f.open(&root, "IDX.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(g.open(&root, "OTHER.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  std::vector<uint8_t> model;
+  static uint8_t rb[3000];
+  srand(3);
+
+  for (int op = 0; op < 8000; op++)
+  {
+    int r = rand() % 6;
+    uint16_t n = rand() % 3000;
+    uint32_t cur = f.curPosition();
+
+    for (int i = 0; i < n; i++)
+    {
+      buf[i] = rand();
+    }
+
+    uint32_t pos = model.empty() ? 0 : rand() % (model.size() + 1);
+    uint32_t avail = model.size() - pos < n ? model.size() - pos : n;
+
+    if (r == 0)
+    {
+      // append through the cursor while the other file grows
+      CHECK(f.seekEnd());
+      CHECK(f.write(buf, n) == n);
+      model.insert(model.end(), buf, buf + n);
+      CHECK(g.write(buf, 700) == 700);
+      cur = f.curPosition();
+    }
+    else if (r == 1 || r == 2)
+    {
+      CHECK(f.readAt(pos, rb, n) == (int16_t) avail);
+      CHECK(!memcmp(rb, model.data() + pos, avail));
+    }
+    else if (r == 3)
+    {
+      CHECK(f.writeAt(pos, buf, n) == n);
+
+      if (pos + n > model.size())
+      {
+        model.resize(pos + n);
+      }
+
+      memcpy(model.data() + pos, buf, n);
+    }
+    else if (r == 4)
+    {
+      pos = f.curPosition();
+      avail = model.size() - pos < n ? model.size() - pos : n;
+      CHECK(f.read(rb, n) == (int16_t) avail);
+      CHECK(!memcmp(rb, model.data() + pos, avail));
+      cur = f.curPosition();
+    }
+    else
+    {
+      CHECK(f.seekSet(pos));
+      cur = pos;
+    }
+
+    // positional access leaves the cursor alone
+    CHECK(f.curPosition() == cur);
+    CHECK(f.fileSize() == model.size());
+  }
+
+  CHECK(f.readAt(model.size() + 1, rb, 1) == -1);
+  CHECK(f.writeAt(model.size() + 1, rb, 1) == 0);
+
+  // after one walk to the middle, reads near the last one and appends
+  // need no walk from the first cluster
+  CHECK(f.seekEnd());
+  CHECK(f.readAt(model.size() / 2, rb, 32) == 32);
+  uint32_t lookups = vol.fatCacheHitCount() + vol.fatCacheMissCount();
+
+  for (int i = 0; i < 100; i++)
+  {
+    CHECK(f.readAt(model.size() / 2, rb, 32) == 32);
+    CHECK(!memcmp(rb, model.data() + model.size() / 2, 32));
+    CHECK(f.write(buf, 10) == 10);
+    model.insert(model.end(), buf, buf + 10);
+  }
+
+  lookups = vol.fatCacheHitCount() + vol.fatCacheMissCount() - lookups;
+  CHECK(lookups < 100);
+
+  CHECK(f.close());
+  CHECK(g.close());
+
+  // O_APPEND does not apply to writeAt()
+  CHECK(f.open(&root, "IDX.BIN", O_RDWR | O_APPEND));
+  CHECK(f.writeAt(10, "HELLO", 5) == 5);
+  CHECK(f.fileSize() == model.size());
+  CHECK(f.readAt(10, rb, 5) == 5 && !memcmp(rb, "HELLO", 5));
+  memcpy(model.data() + 10, "HELLO", 5);
+  CHECK(f.close());
+
+  CHECK(f.open(&root, "IDX.BIN", O_READ));
+
+  for (uint32_t p = 0; p < model.size(); p += sizeof rb)
+  {
+    int16_t k = f.read(rb, sizeof rb);
+    CHECK(k > 0 && !memcmp(rb, model.data() + p, k));
+  }
+
+  CHECK(f.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  readAt() and writeAt() ok, %u byte fragmented file, %u FAT lookups for 100 reads between appends\n",
+         (unsigned) model.size(), (unsigned) lookups);
+}
@@ -0,0 +1,148 @@
+/****************************************************************************************************************************
+  test_remount.cpp
+
+  RP2040_SdVolume::init() on a volume that is already mounted, after sync()
+  and after a card change with changes not yet written.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+static std::vector<uint8_t> imageBytes(const std::string& path)
+{
+  std::vector<uint8_t> bytes;
+  FILE* f = fopen(path.c_str(), "rb");
+  CHECK(f);
+
+  uint8_t buf[4096];
+  size_t n;
+
+  while ((n = fread(buf, 1, sizeof buf, f)) > 0)
+  {
+    bytes.insert(bytes.end(), buf, buf + n);
+  }
+
+  fclose(f);
+
+  return bytes;
+}
+//------------------------------------------------------------------------------
+static void writeFile(RP2040_SdFile& f, uint32_t total, int seed)
+{
+  uint8_t buf[1000];
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, seed);
+    }
+
+    CHECK(f.write(buf, sizeof buf) == sizeof buf);
+  }
+}
+//------------------------------------------------------------------------------
+// init() after sync() on the same card sees everything written before
+HOST_CASE(remountAfterSync)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  for (int k = 0; k < 3; k++)
+  {
+    RP2040_SdFile root;
+    CHECK(root.openRoot(&vol));
+
+    char name[13];
+    snprintf(name, sizeof name, "F%d.BIN", k);
+
+    RP2040_SdFile f;
+    CHECK(f.open(&root, name, O_CREAT | O_RDWR | O_TRUNC));
+    writeFile(f, 20000, k);
+    CHECK(f.close());
+    CHECK(vol.sync());
+
+    CHECK(vol.init(&card, 0));
+    root.close();
+    CHECK(root.openRoot(&vol));
+
+    for (int j = 0; j <= k; j++)
+    {
+      snprintf(name, sizeof name, "F%d.BIN", j);
+      CHECK(f.open(&root, name, O_READ));
+      CHECK(f.fileSize() == 20000);
+      CHECK(f.close());
+    }
+  }
+
+  dev.end();
+  hostFsck(path);
+
+  printf("  remount after sync ok\n");
+}
+//------------------------------------------------------------------------------
+// init() after a card change writes nothing, neither to the new card nor
+// what the old volume left dirty
+HOST_CASE(remountWritesNothing)
+{
+  std::string pathA = hostImage("volume.img");
+  std::string pathB = hostImage("volume2.img");
+  hostFormat(pathA, 32, 40, 1);
+  hostFormat(pathB, 16, 16, 4);
+
+  std::vector<uint8_t> before = imageBytes(pathB);
+
+  RP2040_FileBlockDevice devA;
+  Sd2Card card;
+  hostCard(devA, card, pathA);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  // dirty data, directory and FAT blocks, never synced
+  RP2040_SdFile f;
+  CHECK(f.open(&root, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  writeFile(f, 3000, 0);
+
+  // the card changes
+  RP2040_FileBlockDevice devB;
+  CHECK(devB.begin(pathB.c_str()));
+  SPI.setDevice(&devB);
+  CHECK(card.init(SPI_FULL_SPEED, 17, SPI));
+  SPI.clearStats();
+
+  CHECK(vol.init(&card, 0));
+  CHECK(vol.fatType() == 16);
+  CHECK(SPI.commandCount(24) == 0 && SPI.commandCount(25) == 0);
+
+  CHECK(devB.syncBlocks());
+  CHECK(imageBytes(pathB) == before);
+
+  // the new volume starts clean
+  RP2040_SdFile g;
+  root.close();
+  CHECK(root.openRoot(&vol));
+  CHECK(!g.open(&root, "F0.BIN", O_READ));
+  CHECK(g.open(&root, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  writeFile(g, 30000, 1);
+  CHECK(g.close());
+  CHECK(vol.sync());
+
+  devA.end();
+  devB.end();
+  hostFsck(pathB);
+
+  printf("  remount after a card change ok, nothing written\n");
+}
@@ -0,0 +1,348 @@
+/****************************************************************************************************************************
+  test_sd.cpp
+
+  SDClass and File, the only file of host_test that includes RP2040_SD.h.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+#include "RP2040_SD.h"
+
+//------------------------------------------------------------------------------
+static void writeMarker(const char* name)
+{
+  File f = SD.open(name, FILE_WRITE);
+  CHECK(f);
+  CHECK(f.write((const uint8_t*) name, strlen(name)) == strlen(name));
+  f.close();
+}
+//------------------------------------------------------------------------------
+static void checkMarker(const char* name)
+{
+  File f = SD.open(name);
+  CHECK(f);
+
+  char buf[24] = {0};
+  CHECK(f.read(buf, sizeof buf - 1) == (int) strlen(name));
+  CHECK(!strcmp(buf, name));
+  f.close();
+}
+//------------------------------------------------------------------------------
+// SD.begin() twice writes back the first mount, SD.end() before a card change
+HOST_CASE(sdRemount)
+{
+  std::string pathA = hostImage("volume.img");
+  std::string pathB = hostImage("volume2.img");
+  hostFormat(pathA, 32, 40, 1);
+  hostFormat(pathB, 16, 16, 4);
+
+  RP2040_FileBlockDevice devA;
+  RP2040_FileBlockDevice devB;
+  CHECK(devA.begin(pathA.c_str()));
+  CHECK(devB.begin(pathB.c_str()));
+  SPI.setDevice(&devA);
+
+  CHECK(SD.begin(17));
+  writeMarker("/C0.TXT");
+
+  // again on the same card, what the first mount holds is written first
+  CHECK(SD.begin(17));
+  CHECK(devA.syncBlocks());
+  hostFsck(pathA);
+  checkMarker("/C0.TXT");
+
+  // and the blocks of a file still open
+  File open = SD.open("/C9.TXT", FILE_WRITE);
+  CHECK(open);
+  CHECK(open.write((const uint8_t*) "/C9.TXT", 7) == 7);
+
+  SPI.clearStats();
+  CHECK(SD.begin(17));
+  CHECK(SPI.commandCount(24) + SPI.commandCount(25) > 0);
+
+  open.close();
+  checkMarker("/C9.TXT");
+  CHECK(SD.remove("/C9.TXT"));
+  SD.end();
+  CHECK(devA.syncBlocks());
+  hostFsck(pathA);
+
+  // each card only shows its own marker
+  for (int round = 0; round < 2; round++)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      SPI.setDevice(i ? &devB : &devA);
+      CHECK(SD.begin(17));
+
+      char name[24];
+      snprintf(name, sizeof name, "/C%d.TXT", i);
+
+      if (round == 0 && i == 1)
+      {
+        writeMarker(name);
+      }
+
+      checkMarker(name);
+      CHECK(!SD.exists(i ? "/C0.TXT" : "/C1.TXT"));
+
+      // allocate on the card after the change
+      snprintf(name, sizeof name, "/R%d.TXT", round);
+      writeMarker(name);
+
+      SD.end();
+    }
+  }
+
+  devA.end();
+  devB.end();
+  hostFsck(pathA);
+  hostFsck(pathB);
+
+  printf("  SD remount ok\n");
+}
+//------------------------------------------------------------------------------
+// paths through SD_PATH_CACHE_ENTRIES, directories removed and made again
+HOST_CASE(sdPaths)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+
+  CHECK(SD.mkdir("/logs/2026/10/17"));
+  CHECK(SD.mkdir("/logs/2026/10/18"));
+
+  // more directories than the cache holds, in turn
+  for (int i = 0; i < 100; i++)
+  {
+    char name[40];
+    snprintf(name, sizeof name, "/logs/2026/10/%d/a.csv", 17 + (i & 1));
+
+    File f = SD.open(name, FILE_WRITE);
+    CHECK(f);
+    CHECK(f.write((const uint8_t*) "x", 1) == 1);
+    f.close();
+
+    CHECK(SD.exists("logs/2026/10/17/A.CSV"));
+    CHECK(SD.exists("/LOGS/2026/10/18/"));
+    CHECK(!SD.exists("/logs/2026/10/19"));
+    CHECK(!SD.exists("/logs/2026/10/17/a.csv/x"));
+  }
+
+  // a cached directory that is removed and made again as a file
+  CHECK(SD.remove("/logs/2026/10/18/a.csv"));
+  CHECK(SD.rmdir("/logs/2026/10/18"));
+  CHECK(!SD.exists("/logs/2026/10/18"));
+  CHECK(!SD.exists("/logs/2026/10/18/a.csv"));
+
+  {
+    File f = SD.open("/logs/2026/10/18", FILE_WRITE);
+    CHECK(f);
+    CHECK(!f.isDirectory());
+    f.close();
+  }
+
+  CHECK(SD.remove("/logs/2026/10/18"));
+  CHECK(SD.mkdir("/logs/2026/10/18/b"));
+  CHECK(SD.exists("/logs/2026/10/18/b"));
+
+  // a path too long to cache
+  const char* deep = "/abcdefgh/abcdefgh/abcdefgh/abcdefgh/abcdefgh/abcdefgh/abcdefgh/abcdefgh";
+  CHECK(SD.mkdir(deep));
+
+  for (int i = 0; i < 3; i++)
+  {
+    std::string name = std::string(deep) + "/F.TXT";
+    File f = SD.open(name.c_str(), FILE_WRITE);
+    CHECK(f);
+    CHECK(f.write((const uint8_t*) "x", 1) == 1);
+    f.close();
+    CHECK(SD.exists(name.c_str()));
+  }
+
+  File f = SD.open("/logs/2026/10/17/a.csv");
+  CHECK(f);
+  CHECK(f.size() == 50);
+  f.close();
+
+  SD.end();
+  dev.end();
+  hostFsck(path);
+
+  printf("  SD paths ok, %u cached paths\n", (unsigned) SD_PATH_CACHE_ENTRIES);
+}
+//------------------------------------------------------------------------------
+// File handles from the SD_FILE_POOL_SIZE pool, and the heap past it
+HOST_CASE(sdFilePool)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+  CHECK(SD.mkdir("/logs"));
+
+  // more handles than the pool holds
+  static File files[300];
+  uint32_t heap = SDFilePool.heapCount();
+  int opened = 0;
+
+#if !SD_FILE_POOL_HEAP
+  uint32_t fail = SDFilePool.failCount();
+#endif
+
+  for (int i = 0; i < 300; i++)
+  {
+    files[i] = SD.open("/logs", FILE_READ);
+    opened += (bool) files[i];
+  }
+
+#if SD_FILE_POOL_HEAP
+  CHECK(opened == 300);
+  CHECK(SDFilePool.heapCount() - heap == (uint32_t) 300 - SD_FILE_POOL_SIZE);
+#else
+  CHECK(opened == SD_FILE_POOL_SIZE);
+  CHECK(SDFilePool.failCount() - fail == (uint32_t) 300 - SD_FILE_POOL_SIZE);
+#endif
+
+  CHECK(SDFilePool.inUse() == opened);
+  CHECK(SDFilePool.maxInUse() >= opened);
+
+  for (int i = 0; i < 300; i++)
+  {
+    files[i].close();
+  }
+
+  CHECK(SDFilePool.inUse() == 0);
+
+  // a freed handle is reused, its file as it was opened
+  heap = SDFilePool.heapCount();
+
+  for (int i = 0; i < 10; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof name, "/logs/F%d.TXT", i);
+    writeMarker(name);
+    checkMarker(name);
+  }
+
+  File a = SD.open("/logs/F1.TXT");
+  File b = SD.open("/logs/F2.TXT");
+  CHECK(a && b);
+  CHECK(a.size() == 12 && b.size() == 12);
+  CHECK(a.read() == '/' && b.read() == '/');
+  a.close();
+  b.close();
+
+  CHECK(SDFilePool.inUse() == 0);
+  CHECK(SDFilePool.heapCount() == heap || SD_FILE_POOL_SIZE < 2);
+
+  SD.end();
+  dev.end();
+  hostFsck(path);
+
+  printf("  File pool ok, %u handles, %d open at once\n", (unsigned) SD_FILE_POOL_SIZE, opened);
+}
+//------------------------------------------------------------------------------
+// File::openNextFile() lists every file once, also with SD_DIR_INDEX_ENTRIES
+HOST_CASE(sdOpenNextFile)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+  CHECK(SD.mkdir("/logs/sub"));
+
+  for (int i = 0; i < 40; i++)
+  {
+    char name[16];
+    snprintf(name, sizeof name, "/logs/F%d.TXT", i);
+    writeMarker(name);
+  }
+
+  File dir = SD.open("/logs");
+  CHECK(dir);
+
+  for (int round = 0; round < 2; round++)
+  {
+    uint64_t seen = 0;
+    int dirs = 0;
+
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+      if (f.isDirectory())
+      {
+        CHECK(!strcmp(f.name(), "SUB"));
+        dirs++;
+      }
+      else
+      {
+        int i = atoi(f.name() + 1);
+        CHECK(!(seen & (1ULL << i)));
+        CHECK(f.size() == strlen("/logs/") + strlen(f.name()));
+        seen |= 1ULL << i;
+      }
+
+      f.close();
+    }
+
+    CHECK(seen == (1ULL << 40) - 1 && dirs == 1);
+    dir.rewindDirectory();
+  }
+
+  dir.close();
+  SD.end();
+  dev.end();
+  hostFsck(path);
+
+  printf("  openNextFile() ok\n");
+}
+//------------------------------------------------------------------------------
+// SD.stat() of one path and of many names in one directory
+HOST_CASE(sdStat)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+  SPI.setDevice(&dev);
+  CHECK(SD.begin(17));
+
+  CHECK(SD.mkdir("/logs/2026/10/17"));
+  CHECK(SD.mkdir("/logs/2026/10/18"));
+  writeMarker("/logs/2026/10/17/a.csv");
+
+  dirinfo_t info;
+  CHECK(SD.stat("/logs/2026/10/17/a.csv", &info));
+  CHECK(info.size == strlen("/logs/2026/10/17/a.csv"));
+  CHECK(!strcmp(info.name, "A.CSV"));
+  CHECK(!(info.attributes & DIR_ATT_DIRECTORY));
+  CHECK(SD.stat("/logs/2026", &info));
+  CHECK(info.attributes & DIR_ATT_DIRECTORY);
+  CHECK(!SD.stat("/logs/2026/nope.csv", &info));
+  CHECK(!SD.stat("/logs/nope/a.csv", &info));
+  CHECK(!SD.stat("/logs/2026/", &info));
+
+  // results in the order of the names, with and without a trailing '/'
+  const char* names[3] = { "17", "nope", "18" };
+  dirinfo_t list[3];
+  CHECK(SD.stat("/logs/2026/10", names, 3, list) == 2);
+  CHECK(!strcmp(list[0].name, "17") && list[1].name[0] == 0 && !strcmp(list[2].name, "18"));
+  CHECK(SD.stat("/logs/2026/10/", names, 3, list) == 2);
+  CHECK(SD.stat("/logs/2026/nope", names, 3, list) == -1);
+
+  SD.end();
+  dev.end();
+  hostFsck(path);
+
+  printf("  SD.stat() ok\n");
+}
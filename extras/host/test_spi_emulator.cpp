@@ -0,0 +1,117 @@
+/****************************************************************************************************************************
+  test_spi_emulator.cpp
+
+  Sd2Card talking to RP2040_SdSpiEmulator cards on SPI and SPI1.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// card start up, registers and single block commands on a SDHC and a SD2 card
+HOST_CASE(spiEmulator)
+{
+  const uint32_t blocks = 8192;
+  std::string path = hostImage("card.img");
+  hostBlank(path, blocks);
+
+  RP2040_FileBlockDevice dev;
+  CHECK(dev.begin(path.c_str()));
+
+  for (int k = 0; k < 2; k++)
+  {
+    RP2040_SdSpiEmulator& spi = k ? SPI1 : SPI;
+
+    spi.setDevice(&dev);
+    spi.setHighCapacity(k == 0);
+    spi.setInitPolls(20);
+    spi.clearStats();
+
+    Sd2Card card;
+    CHECK(card.init(SPI_FULL_SPEED, 17, spi));
+    CHECK(card.type() == (k ? SD_CARD_TYPE_SD2 : SD_CARD_TYPE_SDHC));
+    CHECK(card.cardSize() == blocks);
+    CHECK(spi.commandCount(0) == 1 && spi.commandCount(0X40 | 41) > 20);
+
+    cid_t cid;
+    CHECK(card.readCID(&cid));
+    CHECK(!memcmp(cid.pnm, "EMUSD", 5));
+
+    uint8_t buf[512];
+    uint8_t in[512];
+
+    for (uint32_t b = 0; b < 3; b++)
+    {
+      uint32_t at = b * 4000 + k + 1;
+
+      for (int i = 0; i < 512; i++)
+      {
+        buf[i] = hostPattern(i, b + k);
+      }
+
+      CHECK(card.writeBlock(at, buf));
+      CHECK(card.readBlock(at, in));
+      CHECK(!memcmp(in, buf, 512));
+      CHECK(dev.readBlock(at, in));
+      CHECK(!memcmp(in, buf, 512));
+    }
+
+    CHECK(card.readData(4001 + k, 100, 20, in));
+    CHECK(in[0] == hostPattern(100, 1 + k) && in[19] == hostPattern(119, 1 + k));
+
+    CHECK(card.erase(1, 2));
+    CHECK(dev.readBlock(k + 1, in) && in[0] == 0 && in[511] == 0);
+
+    CHECK(spi.commandCount(24) == 3 && spi.commandCount(38) == 1);
+    CHECK(spi.bytesClocked() > 3 * 514);
+  }
+
+  dev.end();
+
+  printf("  SPI emulator ok, SDHC on SPI and SD2 on SPI1\n");
+}
+//------------------------------------------------------------------------------
+// the data phase of a block is one transfer() call, not one per byte
+HOST_CASE(bulkTransfers)
+{
+  std::string path = hostImage("card.img");
+  hostBlank(path, 8192);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  uint8_t buf[512];
+
+  CHECK(card.readBlock(10, buf));
+  CHECK(SPI.transferCalls() < 32);
+
+  SPI.clearStats();
+  CHECK(card.writeBlock(10, buf));
+  CHECK(SPI.transferCalls() < 32);
+
+  SPI.clearStats();
+  CHECK(card.readStart(10));
+
+  for (int b = 0; b < 8; b++)
+  {
+    CHECK(card.readData(buf));
+  }
+
+  CHECK(card.readStop());
+  CHECK(SPI.transferCalls() < 8 * 16);
+
+  SPI.clearStats();
+  CHECK(card.writeStart(10, 8));
+
+  for (int b = 0; b < 8; b++)
+  {
+    CHECK(card.writeData(buf));
+  }
+
+  CHECK(card.writeStop());
+  CHECK(SPI.transferCalls() < 8 * 16);
+
+  dev.end();
+
+  printf("  bulk transfers ok\n");
+}
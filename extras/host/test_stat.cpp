@@ -0,0 +1,221 @@
+/****************************************************************************************************************************
+  test_stat.cpp
+
+  RP2040_SdFile::statEntries(): many names looked up in one pass over a
+  FAT32 or exFAT directory, in the order given.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// look up names in dir and compare each result with open()
+static void statCheck(RP2040_SdFile& dir, const std::vector<std::string>& names, uint32_t blocks)
+{
+  std::vector<const char*> p;
+  std::vector<dirinfo_t> list(names.size());
+  int want = 0;
+
+  for (uint32_t i = 0; i < names.size(); i++)
+  {
+    p.push_back(names[i].c_str());
+  }
+
+  SPI.clearStats();
+  int found = dir.statEntries(p.data(), p.size(), list.data());
+  uint32_t reads = SPI.commandCount(17) + SPI.commandCount(18);
+
+  for (uint32_t i = 0; i < names.size(); i++)
+  {
+    RP2040_SdFile f;
+    uint8_t opened = f.open(&dir, p[i], O_READ);
+    CHECK(opened == (list[i].name[0] != 0));
+    want += opened;
+
+    if (opened)
+    {
+      CHECK(f.isDir() == !!(list[i].attributes & DIR_ATT_DIRECTORY));
+      CHECK(f.isDir() || f.fileSize() == list[i].size);
+      CHECK(f.firstCluster() == list[i].firstCluster);
+      f.close();
+
+      // the index opens the same entry
+      CHECK(f.open(&dir, list[i].index, O_READ));
+      CHECK(f.firstCluster() == list[i].firstCluster);
+      f.close();
+    }
+    else
+    {
+      CHECK(list[i].attributes == 0);
+    }
+  }
+
+  CHECK(found == want);
+
+  // one read of each directory block, plus the FAT blocks of its chain
+  CHECK(reads <= blocks + 2);
+}
+//------------------------------------------------------------------------------
+// 8.3 names, half of them missing, some in lower case and some not valid
+HOST_CASE(statEntries)
+{
+  std::string path = hostImage("volume.img");
+  hostFormat(path, 32, 40, 1);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile dir;
+  CHECK(dir.makeDir(&root, "STAT"));
+
+  for (int i = 0; i < 100; i++)
+  {
+    char name[13];
+    snprintf(name, sizeof name, "F%d.CSV", i);
+
+    RP2040_SdFile f;
+
+    if (i % 10 == 5)
+    {
+      CHECK(f.makeDir(&dir, name));
+    }
+    else
+    {
+      CHECK(f.open(&dir, name, O_CREAT | O_WRITE | O_EXCL));
+      CHECK(f.write(name, i % 7) == (size_t)(i % 7));
+    }
+
+    CHECK(f.close());
+  }
+
+  std::vector<std::string> names;
+
+  for (int i = 0; i < 200; i++)
+  {
+    char name[24];
+
+    if (i % 10 == 9)
+    {
+      snprintf(name, sizeof name, "bad name too long.csv");
+    }
+    else
+    {
+      snprintf(name, sizeof name, i % 3 ? "F%d.CSV" : "f%d.csv", 199 - i);
+    }
+
+    names.push_back(name);
+  }
+
+  uint32_t blocks = (dir.fileSize() + 511) / 512;
+  statCheck(dir, names, blocks);
+
+  // a name twice, and none
+  names.assign(2, "F7.CSV");
+  statCheck(dir, names, blocks);
+  CHECK(dir.statEntries(NULL, 0, NULL) == 0);
+
+  RP2040_SdFile f;
+  CHECK(f.open(&dir, "F1.CSV", O_READ));
+  const char* one = "F1.CSV";
+  dirinfo_t info;
+  CHECK(f.statEntries(&one, 1, &info) == -1);
+  f.close();
+
+  CHECK(dir.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  statEntries() ok, %u names in %u blocks\n", 200, (unsigned) blocks);
+}
+
+#if SD_EXFAT
+//------------------------------------------------------------------------------
+// long names in any case, missing names with the hash of a name present
+HOST_CASE(statEntriesExFat)
+{
+  std::string path = hostImage("exfat.img");
+  hostFormatExFat(path, 16, 0, false);
+
+  RP2040_FileBlockDevice dev;
+  Sd2Card card;
+  hostCard(dev, card, path);
+
+  RP2040_SdVolume vol;
+  CHECK(vol.init(&card, 0));
+
+  RP2040_SdFile root;
+  CHECK(root.openRoot(&vol));
+
+  RP2040_SdFile dir;
+  CHECK(dir.makeDir(&root, "a directory to stat"));
+
+  for (int i = 0; i < 100; i++)
+  {
+    char name[40];
+    snprintf(name, sizeof name, "log file number %d.csv", i);
+
+    RP2040_SdFile f;
+
+    if (i % 10 == 5)
+    {
+      CHECK(f.makeDir(&dir, name));
+    }
+    else
+    {
+      CHECK(f.open(&dir, name, O_CREAT | O_WRITE | O_EXCL));
+      CHECK(f.write(name, i % 7) == (size_t)(i % 7));
+    }
+
+    CHECK(f.close());
+  }
+
+  std::vector<std::string> names;
+
+  for (int i = 0; i < 200; i++)
+  {
+    char name[40];
+
+    if (i % 10 == 9)
+    {
+      snprintf(name, sizeof name, "bad:name.csv");
+    }
+    else
+    {
+      snprintf(name, sizeof name, i % 3 ? "log file number %d.csv" : "LOG FILE NUMBER %d.CSV", 199 - i);
+    }
+
+    names.push_back(name);
+  }
+
+  uint32_t blocks = (dir.fileSize() + 511) / 512;
+  statCheck(dir, names, blocks);
+
+  // "ab" and "ea" have the same name hash and length
+  RP2040_SdFile f;
+  CHECK(f.open(&dir, "ab", O_CREAT | O_WRITE | O_EXCL));
+  CHECK(f.close());
+
+  names.clear();
+  names.push_back("ea");
+  names.push_back("AB");
+  names.push_back("ab");
+  statCheck(dir, names, blocks + 1);
+
+  CHECK(dir.close());
+  CHECK(vol.sync());
+  dev.end();
+  hostFsck(path);
+
+  printf("  exFAT statEntries() ok, %u names in %u blocks\n", 200, (unsigned) blocks);
+}
+#endif  // SD_EXFAT
@@ -0,0 +1,96 @@
+/****************************************************************************************************************************
+  test_two_cards.cpp
+
+  An Sd2Card on SPI and one on SPI1 in use at once, each with its own
+  volume and files.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// a logger appends to the card on SPI while the card on SPI1 serves reads
+HOST_CASE(twoCards)
+{
+  std::string pathA = hostImage("volume.img");
+  std::string pathB = hostImage("volume2.img");
+  hostFormat(pathA, 32, 40, 1);
+  hostFormat(pathB, 16, 16, 4);
+
+  RP2040_FileBlockDevice devA;
+  RP2040_FileBlockDevice devB;
+  Sd2Card cardA;
+  Sd2Card cardB;
+  hostCard(devA, cardA, pathA, SPI);
+  hostCard(devB, cardB, pathB, SPI1);
+
+  RP2040_SdVolume volA;
+  RP2040_SdVolume volB;
+  CHECK(volA.init(&cardA, 0));
+  CHECK(volB.init(&cardB, 0));
+
+  RP2040_SdFile rootA;
+  RP2040_SdFile rootB;
+  CHECK(rootA.openRoot(&volA));
+  CHECK(rootB.openRoot(&volB));
+
+  const uint32_t total = 200000;
+  uint8_t buf[1000];
+
+  // the file the second card serves
+  RP2040_SdFile src;
+  CHECK(src.open(&rootB, "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, 1);
+    }
+
+    CHECK(src.write(buf, sizeof buf) == sizeof buf);
+  }
+
+  CHECK(src.close());
+  CHECK(volB.sync());
+
+  RP2040_SdFile log;
+  CHECK(log.open(&rootA, "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  CHECK(src.open(&rootB, "F1.BIN", O_READ));
+
+  SPI.clearStats();
+  SPI1.clearStats();
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      buf[i] = hostPattern(pos + i, 0);
+    }
+
+    CHECK(log.write(buf, sizeof buf) == sizeof buf);
+
+    CHECK(src.read(buf, sizeof buf) == sizeof buf);
+
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      CHECK(buf[i] == hostPattern(pos + i, 1));
+    }
+  }
+
+  CHECK(log.close());
+  CHECK(src.close());
+  CHECK(volA.sync());
+
+  // each bus only carried the commands of its own card
+  CHECK(SPI.commandCount(24) + SPI.commandCount(25) > 0);
+  CHECK(SPI1.commandCount(24) + SPI1.commandCount(25) == 0);
+  CHECK(SPI1.commandCount(17) + SPI1.commandCount(18) > 0);
+
+  devA.end();
+  devB.end();
+  hostFsck(pathA);
+  hostFsck(pathB);
+
+  printf("  two cards ok, SPI %u transfer() calls, SPI1 %u\n", (unsigned) SPI.transferCalls(),
+         (unsigned) SPI1.transferCalls());
+}
@@ -0,0 +1,104 @@
+/****************************************************************************************************************************
+  test_two_volumes.cpp
+
+  Two RP2040_SdVolume instances mounted at once, each with its own block
+  cache, FAT window and device.
+ *****************************************************************************************************************************/
+
+#include "host.h"
+
+//------------------------------------------------------------------------------
+// files on a FAT32 and a FAT16 volume written and read in turn
+HOST_CASE(twoVolumes)
+{
+  std::string path[2] = { hostImage("volume.img"), hostImage("volume2.img") };
+  hostFormat(path[0], 32, 40, 1);
+  hostFormat(path[1], 16, 16, 4);
+
+  RP2040_FileBlockDevice dev[2];
+  RP2040_SdVolume vol[2];
+  RP2040_SdFile root[2];
+
+  for (int v = 0; v < 2; v++)
+  {
+    CHECK(dev[v].begin(path[v].c_str()));
+    CHECK(vol[v].init(&dev[v], 0));
+    CHECK(root[v].openRoot(&vol[v]));
+  }
+
+  CHECK(vol[0].fatType() == 32 && vol[1].fatType() == 16);
+
+  // the same names on both, each file grows while the other volume writes
+  const uint32_t total = 150000;
+  uint8_t buf[1000];
+  RP2040_SdFile f[2][2];
+
+  for (int v = 0; v < 2; v++)
+  {
+    CHECK(f[v][0].open(&root[v], "F0.BIN", O_CREAT | O_RDWR | O_TRUNC));
+    CHECK(f[v][1].open(&root[v], "F1.BIN", O_CREAT | O_RDWR | O_TRUNC));
+  }
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    for (int v = 0; v < 2; v++)
+    {
+      for (int k = 0; k < 2; k++)
+      {
+        for (uint32_t i = 0; i < sizeof buf; i++)
+        {
+          buf[i] = hostPattern(pos + i, k);
+        }
+
+        CHECK(f[v][k].write(buf, sizeof buf) == sizeof buf);
+      }
+    }
+  }
+
+  CHECK(f[0][0].close() && f[0][1].close());
+
+  // read back on one volume while the other still has open files
+  RP2040_SdFile g;
+  CHECK(g.open(&root[0], "F0.BIN", O_READ));
+
+  for (uint32_t pos = 0; pos < total; pos += sizeof buf)
+  {
+    CHECK(g.read(buf, sizeof buf) == sizeof buf);
+
+    for (uint32_t i = 0; i < sizeof buf; i++)
+    {
+      CHECK(buf[i] == hostPattern(pos + i, 0));
+    }
+
+    // a new file on the other volume between reads
+    if (pos == total / 2)
+    {
+      RP2040_SdFile h;
+      CHECK(h.open(&root[1], "F2.BIN", O_CREAT | O_RDWR | O_TRUNC));
+
+      for (uint32_t i = 0; i < sizeof buf; i++)
+      {
+        buf[i] = hostPattern(i, 2);
+      }
+
+      CHECK(h.write(buf, sizeof buf) == sizeof buf);
+      CHECK(h.close());
+    }
+  }
+
+  CHECK(g.close());
+  CHECK(f[1][0].close() && f[1][1].close());
+
+  // each volume only lists its own files
+  CHECK(!g.open(&root[0], "F2.BIN", O_READ));
+
+  for (int v = 0; v < 2; v++)
+  {
+    CHECK(vol[v].freeClusterCount() > 0);
+    CHECK(vol[v].sync());
+    dev[v].end();
+    hostFsck(path[v]);
+  }
+
+  printf("  two volumes ok\n");
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# minimal exFAT checker: exfsck.py img [dump path]
+import struct, sys, os
+img = open(sys.argv[1], 'rb').read()
+err = []
+def rot16(c, b): return ((c >> 1) | ((c & 1) << 15)) + b & 0xFFFF
+assert img[3:11] == b'EXFAT   '
+(poff, vlen, fatoff, fatlen, heap, clus, rootc, serial, rev, vflags, bpss, spcs, nf) = struct.unpack_from('<QQLLLLLLHHBBB', img, 64)
+spc = 1 << spcs; cs = spc * 512
+activefat = vflags & 1
+fatbase = (fatoff + activefat * fatlen) * 512
+def fatent(c): return struct.unpack_from('<L', img, fatbase + 4 * c)[0]
+def coff(c): return (heap + (c - 2) * spc) * 512
+used = {}
+def claim(c, owner):
+    if not 2 <= c < clus + 2: err.append("%s: bad cluster %d" % (owner, c)); return False
+    if c in used: err.append("%s: crosslink %d with %s" % (owner, c, used[c])); return False
+    used[c] = owner; return True
+def chain(c, owner, nofat, length):
+    out = []
+    if nofat:
+        n = (length + cs - 1) // cs
+        for k in range(c, c + n):
+            if not claim(k, owner): break
+            out.append(k)
+        return out
+    while 2 <= c < 0xFFFFFFF7:
+        if not claim(c, owner): break
+        out.append(c); c = fatent(c)
+    if c != 0xFFFFFFFF: err.append("%s: chain ends with %x" % (owner, c))
+    return out
+def read(ch, n=None):
+    d = b''.join(img[coff(c):coff(c) + cs] for c in ch)
+    return d if n is None else d[:n]
+files = {}
+bitmap = None; upmap = None
+def walk(data, path, isroot):
+    global bitmap, upmap
+    i = 0
+    while i < len(data):
+        t = data[i]
+        if t == 0: break
+        if t == 0x81 and isroot:
+            fc, ln = struct.unpack_from('<LQ', data, i + 20)
+            bitmap = read(chain(fc, '$bitmap', False, ln), ln)
+        elif t == 0x82 and isroot:
+            fc, ln = struct.unpack_from('<LQ', data, i + 20)
+            tb = read(chain(fc, '$upcase', False, ln), ln)
+            w = struct.unpack('<%dH' % (ln // 2), tb)
+            upmap = []; k = 0
+            while k < len(w):
+                if w[k] == 0xFFFF and k + 1 < len(w):
+                    upmap += range(len(upmap), len(upmap) + w[k + 1]); k += 2
+                else: upmap.append(w[k]); k += 1
+            upmap += range(len(upmap), 0x10000)
+        elif t == 0x85:
+            sc = data[i + 1]
+            ents = data[i:i + 32 * (sc + 1)]
+            if len(ents) < 32 * (sc + 1) or sc < 2: err.append("%s: truncated set at %d" % (path, i)); break
+            c = 0
+            for j, b in enumerate(ents):
+                if j in (2, 3): continue
+                c = rot16(c, b)
+            if c != struct.unpack_from('<H', ents, 2)[0]: err.append("%s: set checksum at %d" % (path, i))
+            attr = struct.unpack_from('<H', ents, 4)[0]
+            s = ents[32:64]
+            if s[0] != 0xC0: err.append("%s: no stream at %d" % (path, i))
+            flags, nlen, nh = s[1], s[3], struct.unpack_from('<H', s, 4)[0]
+            valid, fc, dlen = struct.unpack_from('<Q', s, 8)[0], struct.unpack_from('<L', s, 20)[0], struct.unpack_from('<Q', s, 24)[0]
+            nm = b''
+            for k in range(2, sc + 1):
+                if ents[32 * k] != 0xC1: err.append("%s: bad name entry at %d" % (path, i))
+                nm += ents[32 * k + 2:32 * k + 32]
+            if (nlen + 14) // 15 != sc - 1: err.append("%s: secondary count %d for name length %d" % (path, sc, nlen))
+            name = nm[:2 * nlen].decode('utf-16-le')
+            p = path + '/' + name
+            h = 0
+            for ch in name:
+                u = upmap[ord(ch)]; h = rot16(h, u & 0xFF); h = rot16(h, u >> 8)
+            if h != nh: err.append("%s: name hash %04x != %04x" % (p, nh, h))
+            if valid > dlen: err.append("%s: valid %d > data %d" % (p, valid, dlen))
+            ch = chain(fc, p, flags & 2, dlen) if fc else []
+            if fc == 0 and dlen: err.append("%s: length %d with no cluster" % (p, dlen))
+            need = (dlen + cs - 1) // cs
+            if len(ch) != need: err.append("%s: %d clusters for length %d" % (p, len(ch), dlen))
+            if attr & 0x10:
+                walk(read(ch), p, False)
+            else:
+                files[p] = (read(ch, valid) + bytes(dlen - valid), fc, len(ch), flags)
+            i += 32 * sc
+        i += 32
+rch = chain(rootc, '/', False, 0)
+walk(read(rch), '', True)
+if bitmap is None or upmap is None: err.append("missing bitmap or upcase entry"); bitmap = bytes(clus)
+free = 0; leaked = []; missing = []
+for c in range(2, clus + 2):
+    b = bitmap[(c - 2) // 8] >> ((c - 2) % 8) & 1
+    if not b: free += 1
+    if b and c not in used: leaked.append(c)
+    if not b and c in used: missing.append((c, used[c]))
+if leaked: err.append("leaked clusters: %d e.g. %s" % (len(leaked), leaked[:5]))
+if missing: err.append("in use but free in bitmap: %d e.g. %s" % (len(missing), missing[:5]))
+print("exFAT clusters %d spc %d free %d files %d" % (clus, spc, free, len(files)))
+if os.environ.get('V'):
+    for p, (d, fc, n, fl) in sorted(files.items()): print("  %s size %d first %d clusters %d%s" % (p, len(d), fc, n, " nofat" if fl & 2 else ""))
+seeds = {'/A.TXT': 10, '/B.TXT': 11, '/Pre Long Name.bin': 20, '/frag.dat': 21}
+for k in range(7): seeds['/F%d.BIN' % k] = k
+for p in files:
+    if p.startswith('/P') and p.endswith('.BIN'): seeds[p] = int(p[2:-4])
+for p, sd in seeds.items():
+    if p in files:
+        d = files[p][0]
+        bad = [i for i in range(len(d)) if d[i] != ((i*7+sd+(i>>9)) & 0xFF)]
+        if bad: err.append("%s: content mismatch at %d" % (p, bad[0]))
+for e in err: print("ERR", e)
+if len(sys.argv) > 2: sys.stdout.buffer.write(files[sys.argv[2]][0])
+sys.exit(1 if err else 0)
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# minimal FAT16/32 checker: fsck.py img [dump path]
+import struct, sys
+img = open(sys.argv[1], 'rb').read()
+bps, spc, rsvd, nf, rootents, t16, media, fs16 = struct.unpack_from('<HBHBHHBH', img, 11)
+t32, = struct.unpack_from('<L', img, 32)
+fs32, = struct.unpack_from('<L', img, 36)
+fatsz = fs16 or fs32
+total = t16 or t32
+rootsecs = (rootents * 32 + 511) // 512
+fatstart = rsvd
+rootstart = rsvd + nf * fatsz
+datastart = rootstart + rootsecs
+clus = (total - datastart) // spc
+fat = 32 if clus >= 65525 else 16
+err = []
+def fatent(i, n=0):
+    off = (fatstart + n * fatsz) * 512
+    if fat == 32: return struct.unpack_from('<L', img, off + 4 * i)[0] & 0x0FFFFFFF
+    return struct.unpack_from('<H', img, off + 2 * i)[0]
+eoc = 0x0FFFFFF8 if fat == 32 else 0xFFF8
+for n in range(1, nf):
+    a = img[fatstart*512:(fatstart+fatsz)*512]; b = img[(fatstart+n*fatsz)*512:(fatstart+(n+1)*fatsz)*512]
+    if a != b:
+        diffs = [i for i in range(0, len(a), 512) if a[i:i+512] != b[i:i+512]]
+        err.append("FAT%d differs in sectors %s" % (n+1, diffs[:10]))
+used = {}
+def chain(c, owner):
+    out = []
+    while 2 <= c < eoc:
+        if c > clus + 1: err.append("%s: bad cluster %d" % (owner, c)); break
+        if c in used: err.append("%s: crosslink %d with %s" % (owner, c, used[c])); break
+        used[c] = owner; out.append(c); c = fatent(c)
+    return out
+def csec(c): return datastart + (c - 2) * spc
+def readchain(ch): return b''.join(img[csec(c)*512:(csec(c)+spc)*512] for c in ch)
+files = {}
+def walk(data, path):
+    for i in range(0, len(data), 32):
+        e = data[i:i+32]
+        if e[0] == 0: break
+        if e[0] == 0xE5 or e[0] == ord('.') or e[11] & 0x08 or (e[11] & 0x0F) == 0x0F: continue
+        name = e[0:8].decode().rstrip() + ('.' + e[8:11].decode().rstrip() if e[8:11].strip() else '')
+        fc = struct.unpack_from('<H', e, 26)[0] | (struct.unpack_from('<H', e, 20)[0] << 16)
+        size = struct.unpack_from('<L', e, 28)[0]
+        p = path + '/' + name
+        ch = chain(fc, p) if fc else []
+        if e[11] & 0x10:
+            walk(readchain(ch), p)
+        else:
+            need = (size + spc*512 - 1) // (spc*512)
+            if len(ch) < need: err.append("%s: chain %d < needed %d" % (p, len(ch), need))
+            if len(ch) > need: err.append("%s: chain %d > needed %d (ok if preallocated)" % (p, len(ch), need))
+            files[p] = (readchain(ch)[:size], fc, len(ch))
+if fat == 32:
+    rc = struct.unpack_from('<L', img, 44)[0]
+    walk(readchain(chain(rc, '/')), '')
+else:
+    walk(img[rootstart*512:datastart*512], '')
+lost = [c for c in range(2, clus + 2) if fatent(c) != 0 and c not in used]
+if lost: err.append("lost clusters: %d e.g. %s" % (len(lost), lost[:5]))
+free = sum(1 for c in range(2, clus + 2) if fatent(c) == 0)
+if fat == 32:
+    fsinfo = struct.unpack_from('<LL', img, 512 + 488)
+    print("fsinfo free", fsinfo[0], "next", fsinfo[1], "actual free", free)
+    if fsinfo[0] != 0xFFFFFFFF and fsinfo[0] != free: err.append("FSINFO free %d != %d" % (fsinfo[0], free))
+print("FAT%d clusters %d free %d files %d" % (fat, clus, free, len(files)))
+import os
+if os.environ.get('V'):
+    for p, (d, fc, n) in sorted(files.items()): print("  %s size %d first %d clusters %d" % (p, len(d), fc, n))
+seeds = {'/A.TXT': 10, '/B.TXT': 11}
+for k in range(7): seeds['/F%d.BIN' % k] = k
+for p in files:
+    if p.startswith('/P') and p.endswith('.BIN'): seeds[p] = int(p[2:-4])
+for p, sd in seeds.items():
+    if p in files:
+        d = files[p][0]
+        bad = [i for i in range(len(d)) if d[i] != ((i*7+sd+(i>>9)) & 0xFF)]
+        if bad: err.append("%s: content mismatch at %d" % (p, bad[0]))
+for e in err: print("ERR", e)
+if len(sys.argv) > 2: sys.stdout.buffer.write(files[sys.argv[2]][0])
+sys.exit(1 if [e for e in err if 'ok if' not in e] else 0)
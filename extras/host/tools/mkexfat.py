@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# minimal exFAT formatter for host tests: mkexfat.py img sizeMB spcShift [pre]
+import struct, sys
+def rot16(c, b): return ((c >> 1) | ((c & 1) << 15)) + b & 0xFFFF
+def rot32(c, b): return ((c >> 1) | ((c & 1) << 31)) + b & 0xFFFFFFFF
+def upcase_table():
+    m = []
+    for c in range(0x10000):
+        u = c
+        if not 0xD800 <= c < 0xE000:
+            s = chr(c).upper()
+            if len(s) == 1 and ord(s) < 0x10000: u = ord(s)
+        m.append(u)
+    out = []; c = 0
+    while c < 0x10000:
+        if m[c] == c:
+            n = c
+            while n < 0x10000 and m[n] == n: n += 1
+            if n - c > 2:
+                out += [0xFFFF, n - c]; c = n; continue
+        out.append(m[c]); c += 1
+    return b''.join(struct.pack('<H', x) for x in out), m
+def name_hash(name, m):
+    h = 0
+    for ch in name:
+        u = m[ord(ch)]
+        h = rot16(h, u & 0xFF); h = rot16(h, u >> 8)
+    return h
+def entry_set(name, attr, first, length, nofat, m):
+    u = name.encode('utf-16-le'); n = len(name)
+    ents = []
+    f = bytearray(32); f[0] = 0x85; f[1] = 1 + (n + 14) // 15
+    struct.pack_into('<H', f, 4, attr)
+    ts = (((2024 - 1980) << 25) | (5 << 21) | (6 << 16) | (12 << 11))
+    struct.pack_into('<LLL', f, 8, ts, ts, ts)
+    ents.append(f)
+    s = bytearray(32); s[0] = 0xC0; s[1] = 1 | (2 if nofat else 0); s[3] = n
+    struct.pack_into('<H', s, 4, name_hash(name, m))
+    struct.pack_into('<Q', s, 8, length); struct.pack_into('<L', s, 20, first); struct.pack_into('<Q', s, 24, length)
+    ents.append(s)
+    for i in range(0, n, 15):
+        e = bytearray(32); e[0] = 0xC1
+        chunk = u[2 * i:2 * i + 30]; e[2:2 + len(chunk)] = chunk
+        ents.append(e)
+    raw = b''.join(ents); c = 0
+    for i, b in enumerate(raw):
+        if i in (2, 3): continue
+        c = rot16(c, b)
+    struct.pack_into('<H', ents[0], 2, c)
+    return b''.join(ents)
+def pat(i, seed): return (i * 7 + seed + (i >> 9)) & 0xFF
+def mk(path, size_mb, shift, pre):
+    total = size_mb * 2048; spc = 1 << shift; cs = spc * 512
+    fatoff = 24
+    clus = (total - fatoff) // spc
+    while True:
+        fatlen = ((clus + 2) * 4 + 511) // 512
+        heap = (fatoff + fatlen + spc - 1) // spc * spc
+        c2 = (total - heap) // spc
+        if c2 >= clus: break
+        clus = c2
+    img = bytearray(total * 512)
+    fat = [0] * (clus + 2); fat[0] = 0xFFFFFFF8; fat[1] = 0xFFFFFFFF
+    bitmap = bytearray((clus + 7) // 8)
+    nxt = [2]
+    def alloc(nbytes, chain=True):
+        n = max(1, (nbytes + cs - 1) // cs); first = nxt[0]; nxt[0] += n
+        for k in range(first, first + n):
+            bitmap[(k - 2) // 8] |= 1 << ((k - 2) % 8)
+            if chain: fat[k] = k + 1 if k + 1 < first + n else 0xFFFFFFFF
+        return first, n
+    def coff(c): return (heap + (c - 2) * spc) * 512
+    bmc, _ = alloc(len(bitmap))
+    table, m = upcase_table()
+    upc, _ = alloc(len(table))
+    img[coff(upc):coff(upc) + len(table)] = table
+    tcs = 0
+    for b in table: tcs = rot32(tcs, b)
+    root, _ = alloc(cs)
+    ents = bytearray()
+    e = bytearray(32); e[0] = 0x81; struct.pack_into('<LQ', e, 20, bmc, len(bitmap)); ents += e
+    e = bytearray(32); e[0] = 0x82; struct.pack_into('<L', e, 4, tcs); struct.pack_into('<LQ', e, 20, upc, len(table)); ents += e
+    if pre:
+        # files written by another implementation
+        data = bytes(pat(i, 20) for i in range(3 * cs + 100))
+        c, n = alloc(len(data), False); img[coff(c):coff(c) + len(data)] = data
+        ents += entry_set('Pre Long Name.bin', 0x20, c, len(data), True, m)
+        # fragmented FAT-chained file
+        data = bytes(pat(i, 21) for i in range(2 * cs + 7))
+        a1, _ = alloc(cs, False); gap, _ = alloc(cs, False); a2, _ = alloc(cs, False); a3, _ = alloc(cs, False)
+        bitmap[(gap - 2) // 8] &= ~(1 << ((gap - 2) % 8))
+        fat[a1] = a2; fat[a2] = a3; fat[a3] = 0xFFFFFFFF
+        for k, c in enumerate((a1, a2, a3)): img[coff(c):coff(c) + cs] = data[k * cs:(k + 1) * cs].ljust(cs, b'\0')
+        ents += entry_set('frag.dat', 0x20, a1, len(data), False, m)
+        d, _ = alloc(cs)
+        ents += entry_set('SubDir', 0x10, d, cs, False, m)
+        data = b'hello exfat\n'
+        c, _ = alloc(1, False); img[coff(c):coff(c) + len(data)] = data
+        sub = entry_set('readme.txt', 0x20, c, len(data), True, m)
+        img[coff(d):coff(d) + len(sub)] = sub
+    img[coff(root):coff(root) + len(ents)] = ents
+    img[coff(bmc):coff(bmc) + len(bitmap)] = bitmap
+    img[fatoff * 512:fatoff * 512 + 4 * len(fat)] = b''.join(struct.pack('<L', x) for x in fat)
+    bs = bytearray(512)
+    bs[0:3] = b'\xEB\x76\x90'; bs[3:11] = b'EXFAT   '
+    struct.pack_into('<QQLLLLLLHHBBBBB', bs, 64, 0, total, fatoff, fatlen, heap, clus, root,
+                     0x1234ABCD, 0x100, 0, 9, shift, 1, 0x80, 0)
+    bs[510] = 0x55; bs[511] = 0xAA
+    img[0:512] = bs
+    for s in range(1, 9): img[s * 512 + 510:s * 512 + 512] = b'\x55\xAA'
+    c = 0
+    for i in range(11 * 512):
+        if i in (106, 107, 112): continue
+        c = rot32(c, img[i])
+    img[11 * 512:12 * 512] = struct.pack('<L', c) * 128
+    img[12 * 512:24 * 512] = img[0:12 * 512]
+    open(path, 'wb').write(img)
+    print("clusters", clus, "spc", spc, "heap", heap)
+if __name__ == '__main__':
+    mk(sys.argv[1], int(sys.argv[2]), int(sys.argv[3]), len(sys.argv) > 4)
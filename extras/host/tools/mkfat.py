@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# minimal super-floppy FAT16/FAT32 formatter for host tests
+# mkfat.py img fatType sizeMB blocksPerCluster, FSI=1 fills in the FSINFO hints
+import struct, sys, os
+def mk(path, fat, size_mb, spc):
+    total = size_mb * 2048
+    rsvd = 32 if fat == 32 else 1
+    nfats = 2
+    rootents = 0 if fat == 32 else 512
+    rootsecs = (rootents * 32 + 511) // 512
+    # compute fat size
+    epb = 128 if fat == 32 else 256
+    fatsz = 1
+    while True:
+        data = total - rsvd - nfats * fatsz - rootsecs
+        clus = data // spc
+        need = (clus + 2 + epb - 1) // epb
+        if need <= fatsz: break
+        fatsz = need
+    print("clusters", clus, "fatsz", fatsz)
+    bs = bytearray(512)
+    bs[0:3] = b'\xEB\x58\x90'; bs[3:11] = b'MSWIN4.1'
+    struct.pack_into('<HBHBHHBHHHLL', bs, 11, 512, spc, rsvd, nfats, rootents,
+                     total if total < 65536 else 0, 0xF8, 0 if fat == 32 else fatsz, 63, 255, 0,
+                     total if total >= 65536 else 0)
+    if fat == 32:
+        struct.pack_into('<LHHLHH', bs, 36, fatsz, 0, 0, 2, 1, 6)
+        bs[66] = 0x29; bs[82:90] = b'FAT32   '
+    else:
+        bs[38] = 0x29; bs[54:62] = b'FAT16   '
+    bs[510] = 0x55; bs[511] = 0xAA
+    f = open(path, 'wb'); f.truncate(total * 512)
+    f.seek(0); f.write(bs)
+    if fat == 32:
+        fsi = bytearray(512)
+        struct.pack_into('<L', fsi, 0, 0x41615252); struct.pack_into('<L', fsi, 484, 0x61417272)
+        struct.pack_into('<LL', fsi, 488, *((clus - 1, 3) if os.environ.get('FSI') else (0xFFFFFFFF, 0xFFFFFFFF))); struct.pack_into('<L', fsi, 508, 0xAA550000)
+        f.seek(512); f.write(fsi)
+        f.seek(6 * 512); f.write(bs)
+    for i in range(nfats):
+        f.seek((rsvd + i * fatsz) * 512)
+        if fat == 32: f.write(struct.pack('<LLL', 0x0FFFFFF8, 0x0FFFFFFF, 0x0FFFFFFF))
+        else: f.write(struct.pack('<HH', 0xFFF8, 0xFFFF))
+    f.close()
+if __name__ == '__main__':
+    mk(sys.argv[1], int(sys.argv[2]), int(sys.argv[3]), int(sys.argv[4]))
@@ -41,18 +41,91 @@
 
 namespace RP2040_SDLib
 {
+  FilePool::FilePool()
+  {
+    _free = NULL;
+    _inUse = 0;
+    _maxInUse = 0;
+    _heapCount = 0;
+    _failCount = 0;
+
+#if SD_FILE_POOL_SIZE
+    for (uint16_t i = SD_FILE_POOL_SIZE; i > 0; i--)
+    {
+      _slots[i - 1].next = _free;
+      _free = &_slots[i - 1];
+    }
+#endif
+  }
+
+  void *FilePool::alloc()
+  {
+    void *f = NULL;
+
+    if (_free)
+    {
+      f = _free->file;
+      _free = _free->next;
+    }
+#if SD_FILE_POOL_HEAP
+    else
+    {
+      f = malloc(sizeof(RP2040_SdFile));
+
+      if (f)
+      {
+        _heapCount++;
+      }
+    }
+#endif
+
+    if (!f)
+    {
+      _failCount++;
+      return NULL;
+    }
+
+    if (++_inUse > _maxInUse)
+    {
+      _maxInUse = _inUse;
+    }
+
+    return f;
+  }
+
+  void FilePool::release(RP2040_SdFile *f)
+  {
+    f->~RP2040_SdFile();
+    _inUse--;
+
+#if SD_FILE_POOL_SIZE
+    Slot *s = (Slot *) f;
+
+    if (s >= _slots && s < _slots + SD_FILE_POOL_SIZE)
+    {
+      s->next = _free;
+      _free = s;
+      return;
+    }
+#endif
+
+    free(f);
+  }
+
+  FilePool SDFilePool;
+
   File::File(RP2040_SdFile f, const char *n)
   {
-    _file = (RP2040_SdFile *) malloc(sizeof(RP2040_SdFile));
+    void *p = SDFilePool.alloc();
 
-    if (_file)
+    _file = NULL;
+
+    if (p)
     {
-      memcpy(_file, &f, sizeof(RP2040_SdFile));
+      _file = new (p) RP2040_SdFile(f);
 
       strncpy(_name, n, 12);
       _name[12] = 0;
-
-       nfilecount++;
     }
   }
 
@@ -150,6 +223,40 @@ namespace RP2040_SDLib
     return 0;
   }
 
+  // read at pos without moving the position, see RP2040_SdFile::readAt()
+  int File::readAt(uint32_t pos, void *buf, uint16_t nbyte)
+  {
+    if (_file)
+    {
+      return _file->readAt(pos, buf, nbyte);
+    }
+
+    return -1;
+  }
+
+  // write at pos without moving the position, see RP2040_SdFile::writeAt()
+  size_t File::writeAt(uint32_t pos, const uint8_t *buf, size_t size)
+  {
+    size_t t;
+
+    if (!_file)
+    {
+      setWriteError();
+      return 0;
+    }
+
+    _file->clearWriteError();
+    t = _file->writeAt(pos, buf, size);
+
+    if (_file->getWriteError())
+    {
+      setWriteError();
+      return 0;
+    }
+
+    return t;
+  }
+
   int File::available() 
   {
     if (! _file) 
@@ -200,19 +307,27 @@ namespace RP2040_SDLib
     return _file->fileSize();
   }
 
+  bool File::preallocate(uint32_t bytes)
+  {
+    if (! _file)
+    {
+      return false;
+    }
+
+    return _file->preallocate(bytes);
+  }
+
   void File::close() 
   {
     if (_file) 
     {
       _file->close();
       
-      free(_file);
+      SDFilePool.release(_file);
       _file = 0;
       
       // for debugging file open/close leaks
-      nfilecount--;
-      
-      RP2040_SD_LOGINFO3("Closed \"", _name,"\", nfilecount = ", nfilecount);
+      RP2040_SD_LOGINFO3("Closed \"", _name,"\", handles in use = ", SDFilePool.inUse());
     }
   }
 
@@ -267,8 +382,19 @@ namespace RP2040_SDLib
       _file->dirName(p, name);
       
       RP2040_SD_LOGINFO1("try to open file ", name);
-  
-      if (f.open(_file, name, mode)) 
+
+      // open() searches the directory from its start, and with the name
+      // index may leave it anywhere, so come back to the next entry
+      uint32_t pos = _file->curPosition();
+      uint8_t opened = f.open(_file, name, mode);
+
+      if (!_file->seekSet(pos))
+      {
+        f.close();
+        return File();
+      }
+
+      if (opened) 
       {
         RP2040_SD_LOGINFO("OK!");
         
@@ -287,6 +413,19 @@ namespace RP2040_SDLib
     return File();
   }
   
+  // fill list with the next entries of a directory without opening them,
+  // see RP2040_SdFile::readDirEntries()
+  int File::readDirEntries(dirinfo_t *list, uint16_t count, uint8_t attrMask,
+                           uint8_t attrValue, const char *ext)
+  {
+    if (! isDirectory())
+    {
+      return -1;
+    }
+
+    return _file->readDirEntries(list, count, attrMask, attrValue, ext);
+  }
+
   void File::rewindDirectory()
   {
     if (isDirectory()) 
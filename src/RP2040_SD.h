@@ -47,26 +47,86 @@
 #endif
 
 #include <Arduino.h>
+#include <new>
 
 #include "utility/RP2040_SD_Debug.h"
 
 #include "utility/SdFat.h"
 #include "utility/SdFatUtil.h"
+#include "utility/RawStreamWriter.h"
 
 #define FILE_READ     O_READ
 #define FILE_WRITE    (O_READ | O_WRITE | O_CREAT | O_APPEND)
 
 namespace RP2040_SDLib
 {
+// Handles for File objects, SD_FILE_POOL_SIZE slots reused through a free
+// list with optional fallback to the heap.
+class FilePool
+{
+  private:
+
+    // A free slot holds the next free slot, a used one a RP2040_SdFile
+    union Slot
+    {
+      Slot    *next;
+      alignas(RP2040_SdFile) uint8_t file[sizeof(RP2040_SdFile)];
+    };
+
+#if SD_FILE_POOL_SIZE
+    Slot _slots[SD_FILE_POOL_SIZE];
+#endif
+
+    Slot     *_free;        // first free slot
+    uint16_t _inUse;        // handles held by open File objects
+    uint16_t _maxInUse;     // most handles held at one time
+    uint32_t _heapCount;    // handles taken from the heap
+    uint32_t _failCount;    // handles refused
+
+  public:
+
+    FilePool();
+
+    // Take storage for a handle, or NULL if none is available.  The caller
+    // constructs the RP2040_SdFile in it with placement new.
+    void *alloc();
+
+    // Destroy a handle built in storage from alloc() and return the storage.
+    void release(RP2040_SdFile *f);
+
+    // Number of handles held by open File objects, pool and heap.
+    uint16_t inUse()
+    {
+      return _inUse;
+    }
+
+    // Most handles held at one time.
+    uint16_t maxInUse()
+    {
+      return _maxInUse;
+    }
+
+    // Number of handles taken from the heap because the pool was empty.
+    uint32_t heapCount()
+    {
+      return _heapCount;
+    }
+
+    // Number of opens that failed for want of a handle.
+    uint32_t failCount()
+    {
+      return _failCount;
+    }
+};
+
+extern FilePool SDFilePool;
+
 class File : public Stream
 {
   private:
 
     char _name[13];         // our name
-    RP2040_SdFile *_file;   // underlying file pointer
-
-    //for debugging file open/close leaks
-    uint8_t nfilecount = 0;
+    RP2040_SdFile *_file;   // underlying file pointer, from SDFilePool
 
   public:
 
@@ -81,15 +141,20 @@ class File : public Stream
     virtual int     available();
     virtual void    flush();
     int             read(void *buf, uint16_t nbyte);
+    int             readAt(uint32_t pos, void *buf, uint16_t nbyte);
+    size_t          writeAt(uint32_t pos, const uint8_t *buf, size_t size);
     bool            seek(uint32_t pos);
     uint32_t        position();
     uint32_t        size();
+    bool            preallocate(uint32_t bytes);
     void            close();
     operator        bool();
     char *          name();
 
     bool            isDirectory(void);
     File            openNextFile(uint8_t mode = O_RDONLY);
+    int             readDirEntries(dirinfo_t *list, uint16_t count, uint8_t attrMask = 0,
+                                   uint8_t attrValue = 0, const char *ext = NULL);
     void            rewindDirectory(void);
 
     using Print::write;
@@ -107,6 +172,34 @@ class SDClass
     // my quick&dirty iterator, should be replaced
     RP2040_SdFile   getParentDir(const char *filepath, int *indx);
 
+#if SD_PATH_CACHE_ENTRIES
+    // A directory path and the location of its directory entry
+    struct PathCacheEntry
+    {
+      char      path[SD_PATH_CACHE_LEN];  // upper case names joined by '/', empty if unused
+      uint32_t  block;                    // block holding the directory entry
+      uint32_t  cluster;                  // first cluster of the directory
+      uint16_t  lastUse;                  // for least recently used replacement
+      uint8_t   index;                    // index of the entry in block
+    };
+
+    PathCacheEntry  pathCache[SD_PATH_CACHE_ENTRIES];
+    uint16_t        pathCacheUse;
+
+    // Remember dir, found as `name` in the directory `dirpath`, and make
+    // `dirpath` its path.
+    void            pathCacheAdd(char *dirpath, const char *name, RP2040_SdFile& dir);
+    void            pathCacheClear();
+
+    // Forget `filepath` and every directory below it.
+    void            pathCacheInvalidate(const char *filepath);
+
+    // Open the deepest remembered directory of `filepath` as `dir`, copy its
+    // path to `dirpath` and return the offset of the rest of `filepath`.
+    // Returns zero, with `dirpath` empty, if no directory is known.
+    unsigned int    pathCacheOpen(const char *filepath, RP2040_SdFile& dir, char *dirpath);
+#endif
+
   public:
 
     // This needs to be called to set up the connection to the SD card
@@ -114,6 +207,14 @@ class SDClass
     bool begin(uint8_t csPin = SD_CHIP_SELECT_PIN);
     bool begin(uint32_t clock, uint8_t csPin);
 
+#if ! (RP2040_SOFT_SPI) && defined(USE_SPI_LIB)
+    // Same as above for a card on another SPI controller, for example SPI1.
+    // Each SDClass object owns its card, volume and cache, so one card may
+    // be written while another is read.
+    bool begin(uint8_t csPin, RP2040_SdSpiClass& spi);
+    bool begin(uint32_t clock, uint8_t csPin, RP2040_SdSpiClass& spi);
+#endif
+
     //call this when a card is removed. It will allow you to insert and initialise a new card.
     void end();
 
@@ -159,6 +260,21 @@ class SDClass
       return rmdir(filepath.c_str());
     }
 
+    // Get the size, attributes, timestamps and first cluster of a file or
+    // directory from its directory entry without opening it.
+    bool stat(const char *filepath, dirinfo_t *info);
+
+    bool stat(const String &filepath, dirinfo_t *info)
+    {
+      return stat(filepath.c_str(), info);
+    }
+
+    // Same as above for `count` names in the directory `dirpath`, found with
+    // one pass over the directory.  `list` receives the results in the order
+    // of `names`, with an empty name for each name not found.  Returns the
+    // number of names found or -1 if `dirpath` can't be opened.
+    int stat(const char *dirpath, const char * const *names, uint16_t count, dirinfo_t *list);
+
   private:
 
     // This is used to determine the mode used to open a file
@@ -170,10 +286,11 @@ class SDClass
 
     friend class File;
     friend bool callback_openPath(RP2040_SdFile&, const char *, bool, void *);
+    friend bool walkPath(const char *, RP2040_SdFile&,
+                         bool (*)(RP2040_SdFile&, const char *, bool, void *), void *, SDClass *);
 };
 
-//extern SDClass SD;
-static SDClass SD;
+extern SDClass SD;
 };
 
 // We enclose File and SD classes in namespace RP2040_SDLib to avoid conflicts
@@ -116,6 +116,50 @@ namespace RP2040_SDLib
   
     return (path[offset] != '\0');
   }
+
+#if SD_PATH_CACHE_ENTRIES
+  /*
+
+      Append a path component to a path cache key.  Keys are upper case
+      8.3 names joined by '/' without a leading '/', so "/logs/2026" and
+      "LOGS/2026/" have the same key.
+
+      A key that does not fit or names '.' or '..' is set to "/", which
+      matches no directory and stays unusable until reset.
+
+      Returns `true` if `dirpath` is still a usable key.
+
+  */
+
+  bool pathCacheAppend(char *dirpath, const char *name)
+  {
+    if (dirpath[0] == '/')
+    {
+      return false;
+    }
+
+    size_t length = strlen(dirpath);
+    size_t nameLength = strlen(name);
+
+    if (nameLength == 0 || name[0] == '.' || length + nameLength + 2 > SD_PATH_CACHE_LEN)
+    {
+      strcpy(dirpath, "/");
+      return false;
+    }
+
+    if (length)
+    {
+      dirpath[length++] = '/';
+    }
+
+    for (size_t i = 0; i <= nameLength; i++)
+    {
+      dirpath[length + i] = toupper(name[i]);
+    }
+
+    return true;
+  }
+#endif
   
    /*
   
@@ -147,7 +191,7 @@ namespace RP2040_SDLib
   
   bool walkPath(const char *filepath, RP2040_SdFile& parentDir,
                 bool (*callback) (RP2040_SdFile& parentDir, const char *filePathComponent, bool isLastComponent, void *object),
-                void *object = NULL)
+                void *object = NULL, SDClass *sd = NULL)
   {
     RP2040_SdFile subfile1;
     RP2040_SdFile subfile2;
@@ -164,6 +208,27 @@ namespace RP2040_SDLib
     p_child = &subfile1;
   
     p_parent = &parentDir;
+
+#if SD_PATH_CACHE_ENTRIES
+    // path of the parent directory below `parentDir`, which must be root
+    char dirpath[SD_PATH_CACHE_LEN];
+    dirpath[0] = '\0';
+
+    // Start at the deepest directory of the path already known.  The
+    // callbacks of the levels above it would only find existing directories.
+    if (sd)
+    {
+      offset = sd->pathCacheOpen(filepath, subfile2, dirpath);
+
+      if (offset)
+      {
+        p_parent = &subfile2;
+      }
+    }
+#else
+    // only used to look up the path cache
+    (void)sd;
+#endif
   
     while (true)
     {
@@ -202,6 +267,13 @@ namespace RP2040_SDLib
       // Handle case when it doesn't exist and we can't continue...
       if (exists)
       {
+#if SD_PATH_CACHE_ENTRIES
+        if (sd)
+        {
+          sd->pathCacheAdd(dirpath, buffer, *p_child);
+        }
+#endif
+
         // We alternate between two file handles as we go down
         // the path.
         if (p_parent == &parentDir)
@@ -322,28 +394,61 @@ namespace RP2040_SDLib
   */
   bool SDClass::begin(uint8_t csPin) 
   {
+    // write back the previous volume before the card may change
     if (root.isOpen()) 
     {
-      root.close();
-    }   
-     
+      end();
+    }
+
     return card.init(SPI_HALF_SPEED, csPin) && volume.init(card) && root.openRoot(volume);
   }
   
   bool SDClass::begin(uint32_t clock, uint8_t csPin) 
   {
+    // write back the previous volume before the card may change
     if (root.isOpen()) 
     {
-      root.close();
+      end();
     }
-  
+
     return card.init(SPI_HALF_SPEED, csPin) && card.setSpiClock(clock) && volume.init(card) && root.openRoot(volume);
   }
+
+#if ! (RP2040_SOFT_SPI) && defined(USE_SPI_LIB)
+  bool SDClass::begin(uint8_t csPin, RP2040_SdSpiClass& spi) 
+  {
+    // write back the previous volume before the card may change
+    if (root.isOpen()) 
+    {
+      end();
+    }
+
+    return card.init(SPI_HALF_SPEED, csPin, spi) && volume.init(card) && root.openRoot(volume);
+  }
+  
+  bool SDClass::begin(uint32_t clock, uint8_t csPin, RP2040_SdSpiClass& spi) 
+  {
+    // write back the previous volume before the card may change
+    if (root.isOpen()) 
+    {
+      end();
+    }
+
+    return card.init(SPI_HALF_SPEED, csPin, spi) && card.setSpiClock(clock) && volume.init(card) && root.openRoot(volume);
+  }
+#endif
   
   //call this when a card is removed. It will allow you to insert and initialise a new card.
   void SDClass::end() 
   {
     root.close();
+
+#if SD_PATH_CACHE_ENTRIES
+    pathCacheClear();
+#endif
+    
+    // write what the volume still holds, a later init() discards it
+    volume.sync();
   }
   
   // this little helper is used to traverse paths
@@ -360,6 +465,21 @@ namespace RP2040_SDLib
     RP2040_SdFile *subdir = &d2;
   
     const char *origpath = filepath;
+
+#if SD_PATH_CACHE_ENTRIES
+    char dirpath[SD_PATH_CACHE_LEN];
+
+    // skip the directories of the path already known
+    unsigned int offset = pathCacheOpen(filepath, d2, dirpath);
+
+    if (offset)
+    {
+      d1.close();
+      parent = &d2;
+      subdir = &d1;
+      filepath += offset;
+    }
+#endif
   
     while (strchr(filepath, '/')) 
     {
@@ -396,6 +516,10 @@ namespace RP2040_SDLib
         // failed to open one of the subdirectories
         return RP2040_SdFile();
       }
+
+#if SD_PATH_CACHE_ENTRIES
+      pathCacheAdd(dirpath, subdirname, *subdir);
+#endif
       
       // move forward to the next subdirectory
       filepath += idx;
@@ -415,6 +539,126 @@ namespace RP2040_SDLib
     return *parent;
   }
   
+#if SD_PATH_CACHE_ENTRIES
+  void SDClass::pathCacheAdd(char *dirpath, const char *name, RP2040_SdFile& dir)
+  {
+    // exFAT directories are not reopened from their entry
+    if (!pathCacheAppend(dirpath, name) || !dir.isSubDir() || volume.fatType() == 64)
+    {
+      return;
+    }
+
+    PathCacheEntry *e = &pathCache[0];
+
+    for (uint8_t i = 0; i < SD_PATH_CACHE_ENTRIES; i++)
+    {
+      PathCacheEntry *p = &pathCache[i];
+
+      // already known, or the least recently used entry
+      if (!strcmp(p->path, dirpath))
+      {
+        e = p;
+        break;
+      }
+
+      if (!p->path[0] || (e->path[0] && (uint16_t)(pathCacheUse - p->lastUse) > (uint16_t)(pathCacheUse - e->lastUse)))
+      {
+        e = p;
+      }
+    }
+
+    strcpy(e->path, dirpath);
+    e->block = dir.dirBlock();
+    e->index = dir.dirIndex();
+    e->cluster = dir.firstCluster();
+    e->lastUse = ++pathCacheUse;
+  }
+
+  void SDClass::pathCacheClear()
+  {
+    for (uint8_t i = 0; i < SD_PATH_CACHE_ENTRIES; i++)
+    {
+      pathCache[i].path[0] = '\0';
+    }
+  }
+
+  void SDClass::pathCacheInvalidate(const char *filepath)
+  {
+    char key[SD_PATH_CACHE_LEN];
+    char buffer[PATH_COMPONENT_BUFFER_LEN];
+    unsigned int offset = 0;
+    bool more = true;
+
+    key[0] = '\0';
+
+    while (more)
+    {
+      more = getNextPathComponent(filepath, &offset, buffer);
+
+      if (buffer[0] && !pathCacheAppend(key, buffer))
+      {
+        break;
+      }
+    }
+
+    size_t length = strlen(key);
+
+    for (uint8_t i = 0; i < SD_PATH_CACHE_ENTRIES; i++)
+    {
+      char *path = pathCache[i].path;
+
+      // an unusable key, such as root, forgets everything
+      if (length == 0 || key[0] == '/' || (!strncmp(path, key, length) && (path[length] == '\0' || path[length] == '/')))
+      {
+        path[0] = '\0';
+      }
+    }
+  }
+
+  unsigned int SDClass::pathCacheOpen(const char *filepath, RP2040_SdFile& dir, char *dirpath)
+  {
+    char key[SD_PATH_CACHE_LEN];
+    char buffer[PATH_COMPONENT_BUFFER_LEN];
+    unsigned int offset = 0;
+    unsigned int found = 0;
+    PathCacheEntry *e = NULL;
+
+    key[0] = '\0';
+    dirpath[0] = '\0';
+
+    // only the components followed by more of the path are directories
+    while (getNextPathComponent(filepath, &offset, buffer) && pathCacheAppend(key, buffer))
+    {
+      for (uint8_t i = 0; i < SD_PATH_CACHE_ENTRIES; i++)
+      {
+        if (pathCache[i].path[0] && !strcmp(pathCache[i].path, key))
+        {
+          e = &pathCache[i];
+          found = offset;
+          break;
+        }
+      }
+    }
+
+    if (!e)
+    {
+      return 0;
+    }
+
+    if (!dir.openDirEntry(&volume, e->block, e->index, e->cluster))
+    {
+      // removed or changed by RP2040_SdFile calls
+      e->path[0] = '\0';
+      return 0;
+    }
+
+    strcpy(dirpath, e->path);
+    e->lastUse = ++pathCacheUse;
+
+    return found;
+  }
+#endif
+  
   /*
      Open the supplied file path for reading or writing.
 
@@ -483,7 +727,7 @@ namespace RP2040_SDLib
     
   bool SDClass::exists(const char *filepath) 
   {
-    return walkPath(filepath, root, callback_pathExists);
+    return walkPath(filepath, root, callback_pathExists, NULL, this);
   }
 
   /*  
@@ -494,7 +738,11 @@ namespace RP2040_SDLib
     
   bool SDClass::mkdir(const char *filepath) 
   {
-    return walkPath(filepath, root, callback_makeDirPath);
+#if SD_PATH_CACHE_ENTRIES
+    pathCacheInvalidate(filepath);
+#endif
+
+    return walkPath(filepath, root, callback_makeDirPath, NULL, this);
   }
 
   /*  
@@ -505,16 +753,87 @@ namespace RP2040_SDLib
     
   bool SDClass::rmdir(const char *filepath) 
   {
-    
-    return walkPath(filepath, root, callback_rmdir);
+#if SD_PATH_CACHE_ENTRIES
+    pathCacheInvalidate(filepath);
+#endif
+
+    return walkPath(filepath, root, callback_rmdir, NULL, this);
   }
   
   bool SDClass::remove(const char *filepath) 
   {
-    return walkPath(filepath, root, callback_remove);
+#if SD_PATH_CACHE_ENTRIES
+    pathCacheInvalidate(filepath);
+#endif
+
+    return walkPath(filepath, root, callback_remove, NULL, this);
+  }
+
+  /*
+    Returns the directory entry fields of a file or directory.
+  */
+
+  bool SDClass::stat(const char *filepath, dirinfo_t *info)
+  {
+    int pathidx;
+
+    RP2040_SdFile parentdir = getParentDir(filepath, &pathidx);
+
+    filepath += pathidx;
+
+    // failed to open a subdir, or the path ends with '/'
+    if (!parentdir.isOpen() || ! filepath[0])
+    {
+      return false;
+    }
+
+    bool found = parentdir.statEntries(&filepath, 1, info) == 1;
+
+    parentdir.close();
+
+    return found;
+  }
+
+  int SDClass::stat(const char *dirpath, const char * const *names, uint16_t count, dirinfo_t *list)
+  {
+    int pathidx;
+
+    RP2040_SdFile parentdir = getParentDir(dirpath, &pathidx);
+
+    dirpath += pathidx;
+
+    if (!parentdir.isOpen())
+    {
+      return -1;
+    }
+
+    // the last component of dirpath, if it has no trailing '/'
+    RP2040_SdFile dir;
+
+    if (dirpath[0])
+    {
+      bool opened = dir.open(parentdir, dirpath, O_READ);
+
+      parentdir.close();
+
+      if (!opened)
+      {
+        return -1;
+      }
+    }
+    else
+    {
+      dir = parentdir;
+    }
+
+    int found = dir.statEntries(names, count, list);
+
+    dir.close();
+
+    return found;
   }
  
-  //SDClass SD;
+  SDClass SD;
 };
 
 
@@ -0,0 +1,101 @@
+/****************************************************************************************************************************
+  BlockDevice.h
+
+  For all RP2040 boads using Arduimo-mbed or arduino-pico core
+
+  RP2040_SD is a library enable the usage of SD on RP2040-based boards
+
+  This Library is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+  This Library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with the Arduino SdFat Library.
+  If not, see <http://www.gnu.org/licenses/>.
+
+  Based on and modified from  Arduino SdFat Library (https://github.com/arduino/Arduino)
+
+  (C) Copyright 2009 by William Greiman
+  (C) Copyright 2010 SparkFun Electronics
+  (C) Copyright 2021 by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/RP2040_SD
+  Licensed under GPL-3.0 license
+
+  Version: 1.0.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0  K Hoang       18/06/2021 Port to RP2040-based boards using Arduimo-mbed or arduino-pico core
+  1.0.1  K Hoang       22/10/2021 Fix platform in library.json for PIO
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef BlockDevice_h
+#define BlockDevice_h
+
+/**
+   \file
+   RP2040_BlockDevice class
+*/
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+/**
+   \class RP2040_BlockDevice
+   \brief Abstract 512 byte block storage used by RP2040_SdVolume.
+
+   Sd2Card implements this for SD cards on SPI.  Other storage, such as a
+   disk image on a host, can be used by the FAT layer by implementing
+   the same functions.
+
+   All functions return the value one, true, for success and
+   the value zero, false, for failure.
+*/
+class RP2040_BlockDevice
+{
+  public:
+    virtual ~RP2040_BlockDevice() {}
+
+    /** \return The number of 512 byte blocks or zero if an error occurs. */
+    virtual uint32_t cardSize() = 0;
+
+    /** Erase the blocks \a firstBlock through \a lastBlock inclusive. */
+    virtual uint8_t erase(uint32_t firstBlock, uint32_t lastBlock) = 0;
+
+    /** \return true if the device is busy with a previous write. */
+    virtual uint8_t isBusy() = 0;
+
+    /** Read a 512 byte block. */
+    virtual uint8_t readBlock(uint32_t block, uint8_t* dst) = 0;
+
+    /** Read \a count bytes starting at \a offset in a block. */
+    virtual uint8_t readData(uint32_t block, uint16_t offset, uint16_t count, uint8_t* dst) = 0;
+
+    /** Read the next block in a multiple block read sequence, a failure ends the sequence. */
+    virtual uint8_t readData(uint8_t* dst) = 0;
+
+    /** Start a multiple block read sequence at \a block. */
+    virtual uint8_t readStart(uint32_t block) = 0;
+
+    /** End a multiple block read sequence. */
+    virtual uint8_t readStop() = 0;
+
+    /** Wait until all previous writes are complete. */
+    virtual uint8_t syncBlocks() = 0;
+
+    /** Write a 512 byte block. */
+    virtual uint8_t writeBlock(uint32_t block, const uint8_t* src, uint8_t blocking = 1) = 0;
+
+    /** Write the next block in a multiple block write sequence. */
+    virtual uint8_t writeData(const uint8_t* src) = 0;
+
+    /** Start a multiple block write sequence at \a block, pre-erase \a eraseCount blocks. */
+    virtual uint8_t writeStart(uint32_t block, uint32_t eraseCount) = 0;
+
+    /** End a multiple block write sequence. */
+    virtual uint8_t writeStop() = 0;
+};
+#endif  // BlockDevice_h
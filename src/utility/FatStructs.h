@@ -320,6 +320,279 @@ struct fat32BootSector
 /** Type name for fat32BootSector */
 typedef struct fat32BootSector fbs_t;
 
+//------------------------------------------------------------------------------
+/** Lead signature for a FSINFO sector */
+#define FSINFO_LEAD_SIG         0X41615252
+
+/** Struct signature for a FSINFO sector */
+#define FSINFO_STRUCT_SIG       0X61417272
+
+/**
+   \struct fat32FsInfo
+   \brief FSINFO sector for a FAT32 volume
+
+   Holds a hint of the free cluster count and the next free cluster.
+   Either value is 0XFFFFFFFF if unknown.
+*/
+struct fat32FsInfo
+{
+  /** must be 0X52, 0X52, 0X61, 0X41 */
+  uint32_t leadSignature;
+  /** must be zero */
+  uint8_t  reserved1[480];
+  /** must be 0X72, 0X72, 0X41, 0X61 */
+  uint32_t structSignature;
+  /**
+     Contains the last known free cluster count on the volume.
+     Must be checked against the cluster count before use.
+  */
+  uint32_t freeCount;
+  /**
+     Cluster number where the search for a free cluster should start.
+  */
+  uint32_t nextFree;
+  /** must be zero */
+  uint8_t  reserved2[12];
+  /** must be 0X00, 0X00, 0X55, 0XAA */
+  uint8_t  tailSignature[4];
+} __attribute__((packed));
+
+/** Type name for fat32FsInfo */
+typedef struct fat32FsInfo fsinfo_t;
+
+//------------------------------------------------------------------------------
+/*
+   exFAT structures are from the Microsoft exFAT file system specification
+   https://docs.microsoft.com/en-us/windows/win32/fileio/exfat-specification
+*/
+/**
+   \struct exFatBootSector
+
+   \brief Boot sector for an exFAT volume.
+
+   Sector sizes other than 512 bytes are not supported.
+*/
+struct exFatBootSector
+{
+  /** X86 jmp to boot program */
+  uint8_t  jmpToBootCode[3];
+  /** must be "EXFAT   " */
+  char     fileSystemName[8];
+  /** must be zero, overlaps a FAT BIOS parameter block */
+  uint8_t  mustBeZero[53];
+  /** media relative sector offset of the partition */
+  uint64_t partitionOffset;
+  /** size of the volume in sectors */
+  uint64_t volumeLength;
+  /** volume relative sector offset of the first FAT */
+  uint32_t fatOffset;
+  /** length of each FAT in sectors */
+  uint32_t fatLength;
+  /** volume relative sector offset of cluster two */
+  uint32_t clusterHeapOffset;
+  /** number of clusters in the cluster heap */
+  uint32_t clusterCount;
+  /** first cluster of the root directory */
+  uint32_t rootDirectoryCluster;
+  /** volume serial number */
+  uint32_t volumeSerialNumber;
+  /** major revision in the high byte, minor revision in the low byte */
+  uint16_t fileSystemRevision;
+  /** bit 0 ActiveFat, bit 1 VolumeDirty, bit 2 MediaFailure */
+  uint16_t volumeFlags;
+  /** log2 of bytes per sector, must be 9 */
+  uint8_t  bytesPerSectorShift;
+  /** log2 of sectors per cluster */
+  uint8_t  sectorsPerClusterShift;
+  /** one, or two for TexFAT */
+  uint8_t  numberOfFats;
+  /** for int0x13 */
+  uint8_t  driveSelect;
+  /** percentage of clusters in use or 0XFF if not known */
+  uint8_t  percentInUse;
+  /** reserved */
+  uint8_t  reserved[7];
+  /** X86 boot code */
+  uint8_t  bootCode[390];
+  /** must be 0X55 */
+  uint8_t  bootSectorSig0;
+  /** must be 0XAA */
+  uint8_t  bootSectorSig1;
+} __attribute__((packed));
+
+/** Type name for exFatBootSector */
+typedef struct exFatBootSector exfbs_t;
+
+/** exFAT end of chain value */
+#define EXFAT_EOC                       (uint32_t) 0XFFFFFFFF
+
+/** ActiveFat bit of exFatBootSector::volumeFlags */
+#define EXFAT_VOLUME_FLAG_ACTIVE_FAT    0X01
+
+// exFAT directory entry types
+/** End of directory, this and all following entries are free */
+#define EXFAT_TYPE_END_OF_DIR           0X00
+/** Bit set in the type of an entry that is in use */
+#define EXFAT_TYPE_IN_USE               0X80
+/** Allocation bitmap entry */
+#define EXFAT_TYPE_BITMAP               0X81
+/** Up-case table entry */
+#define EXFAT_TYPE_UPCASE               0X82
+/** Volume label entry */
+#define EXFAT_TYPE_LABEL                0X83
+/** File entry, the first entry of a file or directory entry set */
+#define EXFAT_TYPE_FILE                 0X85
+/** Stream extension entry, follows the file entry */
+#define EXFAT_TYPE_STREAM               0XC0
+/** File name entry, follows the stream extension entry */
+#define EXFAT_TYPE_NAME                 0XC1
+
+/** Stream extension flag, the file may have clusters */
+#define EXFAT_FLAG_ALLOCATION_POSSIBLE  0X01
+/** Stream extension flag, clusters are contiguous and the FAT is not used */
+#define EXFAT_FLAG_NO_FAT_CHAIN         0X02
+
+/** UTF-16 characters in one file name entry */
+#define EXFAT_NAME_CHARS                15
+/** Maximum UTF-16 characters in a file name */
+#define EXFAT_NAME_MAX                  255
+
+/**
+   \struct exFatFileEntry
+   \brief exFAT file directory entry
+
+   Timestamps hold a FAT date in the high 16 bits and a FAT time
+   in the low 16 bits.
+*/
+struct exFatFileEntry
+{
+  /** EXFAT_TYPE_FILE */
+  uint8_t  type;
+  /** number of entries following this one in the set */
+  uint8_t  secondaryCount;
+  /** checksum of the entry set, see RP2040_SdFile */
+  uint16_t setChecksum;
+  /** DIR_ATT_ attribute bits */
+  uint16_t attributes;
+  /** reserved */
+  uint16_t reserved1;
+  /** creation date and time */
+  uint32_t createTimestamp;
+  /** last write date and time */
+  uint32_t modifyTimestamp;
+  /** last access date and time */
+  uint32_t accessTimestamp;
+  /** creation time hundredths of a second, 0 - 199 */
+  uint8_t  create10ms;
+  /** last write time hundredths of a second, 0 - 199 */
+  uint8_t  modify10ms;
+  /** creation time offset from UTC */
+  uint8_t  createUtcOffset;
+  /** last write time offset from UTC */
+  uint8_t  modifyUtcOffset;
+  /** last access time offset from UTC */
+  uint8_t  accessUtcOffset;
+  /** reserved */
+  uint8_t  reserved2[7];
+} __attribute__((packed));
+
+/** Type name for exFatFileEntry */
+typedef struct exFatFileEntry exfile_t;
+
+/**
+   \struct exFatStreamEntry
+   \brief exFAT stream extension directory entry
+*/
+struct exFatStreamEntry
+{
+  /** EXFAT_TYPE_STREAM */
+  uint8_t  type;
+  /** EXFAT_FLAG_ALLOCATION_POSSIBLE and EXFAT_FLAG_NO_FAT_CHAIN */
+  uint8_t  flags;
+  /** reserved */
+  uint8_t  reserved1;
+  /** length of the name in UTF-16 characters */
+  uint8_t  nameLength;
+  /** hash of the up-cased name */
+  uint16_t nameHash;
+  /** reserved */
+  uint16_t reserved2;
+  /** bytes written, data past this point reads as zero */
+  uint64_t validDataLength;
+  /** reserved */
+  uint32_t reserved3;
+  /** first cluster of the data */
+  uint32_t firstCluster;
+  /** size of the file in bytes */
+  uint64_t dataLength;
+} __attribute__((packed));
+
+/** Type name for exFatStreamEntry */
+typedef struct exFatStreamEntry exstream_t;
+
+/**
+   \struct exFatNameEntry
+   \brief exFAT file name directory entry
+*/
+struct exFatNameEntry
+{
+  /** EXFAT_TYPE_NAME */
+  uint8_t  type;
+  /** must be zero */
+  uint8_t  flags;
+  /** up to 15 UTF-16 characters of the name */
+  uint16_t name[EXFAT_NAME_CHARS];
+} __attribute__((packed));
+
+/** Type name for exFatNameEntry */
+typedef struct exFatNameEntry exname_t;
+
+/**
+   \struct exFatSystemEntry
+   \brief exFAT allocation bitmap or up-case table directory entry
+*/
+struct exFatSystemEntry
+{
+  /** EXFAT_TYPE_BITMAP or EXFAT_TYPE_UPCASE */
+  uint8_t  type;
+  /** bitmap: bit 0 selects the FAT the bitmap belongs to */
+  uint8_t  flags;
+  /** reserved */
+  uint8_t  reserved1[2];
+  /** up-case table: checksum of the table */
+  uint32_t tableChecksum;
+  /** reserved */
+  uint8_t  reserved2[12];
+  /** first cluster of the bitmap or table */
+  uint32_t firstCluster;
+  /** size of the bitmap or table in bytes */
+  uint64_t dataLength;
+} __attribute__((packed));
+
+/** Type name for exFatSystemEntry */
+typedef struct exFatSystemEntry exsystem_t;
+
+/**
+   \union exFatDirEntry
+   \brief Any 32 byte exFAT directory entry
+*/
+union exFatDirEntry
+{
+  /** entry type, EXFAT_TYPE_ values */
+  uint8_t    type;
+  /** file entry */
+  exfile_t   file;
+  /** stream extension entry */
+  exstream_t stream;
+  /** file name entry */
+  exname_t   name;
+  /** allocation bitmap or up-case table entry */
+  exsystem_t system;
+};
+
+/** Type name for exFatDirEntry */
+typedef union exFatDirEntry exdir_t;
+
 //------------------------------------------------------------------------------
 /**
    \struct directoryEntry
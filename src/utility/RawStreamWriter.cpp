@@ -0,0 +1,255 @@
+/****************************************************************************************************************************
+  RawStreamWriter.cpp
+
+  For all RP2040 boads using Arduimo-mbed or arduino-pico core
+
+  RP2040_SD is a library enable the usage of SD on RP2040-based boards
+
+  This Library is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+  This Library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with the Arduino SdFat Library.
+  If not, see <http://www.gnu.org/licenses/>.
+
+  Based on and modified from  Arduino SdFat Library (https://github.com/arduino/Arduino)
+
+  (C) Copyright 2009 by William Greiman
+  (C) Copyright 2010 SparkFun Electronics
+  (C) Copyright 2021 by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/RP2040_SD
+  Licensed under GPL-3.0 license
+
+  Version: 1.0.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0  K Hoang       18/06/2021 Port to RP2040-based boards using Arduimo-mbed or arduino-pico core
+  1.0.1  K Hoang       22/10/2021 Fix platform in library.json for PIO
+ *****************************************************************************************************************************/
+
+#include "RawStreamWriter.h"
+
+//------------------------------------------------------------------------------
+/**
+   Create a contiguous file and start a multiple block write over it.
+
+   \param[in] dirFile The directory where the file will be created.
+   \param[in] fileName A valid DOS 8.3 file name, or a long name on exFAT.
+   \param[in] maxSize The most bytes that will be written.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+   Reasons for failure include the writer is already open, the file
+   exists, there is no contiguous free space of \a maxSize bytes
+   or an I/O error occurs.
+*/
+uint8_t RP2040_RawStreamWriter::begin(RP2040_SdFile* dirFile, const char* fileName, uint32_t maxSize)
+{
+  uint32_t bgnBlock;
+  uint32_t endBlock;
+
+  if (open_ || maxSize == 0)
+  {
+    return false;
+  }
+
+  // the directory entry, FAT and cache are written here
+  if (!file_.createContiguous(dirFile, fileName, maxSize))
+  {
+    return false;
+  }
+
+  if (!file_.contiguousRange(&bgnBlock, &endBlock))
+  {
+    goto fail;
+  }
+
+  vol_ = file_.volume();
+
+  // data blocks bypass the cache until finish()
+  vol_->cacheInvalidate(bgnBlock, endBlock - bgnBlock + 1);
+
+  if (!vol_->writeStart(bgnBlock, endBlock - bgnBlock + 1))
+  {
+    goto fail;
+  }
+
+  bytes_ = 0;
+  maxSize_ = maxSize;
+  maxWrite_ = 0;
+  overruns_ = 0;
+  fill_ = 0;
+  cur_ = 0;
+  pending_ = false;
+  open_ = true;
+
+  return true;
+
+fail:
+  file_.remove();
+
+  return false;
+}
+//------------------------------------------------------------------------------
+/**
+   Send any buffered data, end the multiple block write and set the file
+   size to the bytes written.  Clusters past the data are released.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t RP2040_RawStreamWriter::finish()
+{
+  if (!open_)
+  {
+    return false;
+  }
+
+  open_ = false;
+
+  if (pending_ && !sendPending())
+  {
+    return false;
+  }
+
+  if (fill_)
+  {
+    // zero fill the partial last block
+    memset(buf_[cur_] + fill_, 0, 512 - fill_);
+
+    if (!vol_->writeData(buf_[cur_]))
+    {
+      return false;
+    }
+  }
+
+  if (!vol_->writeStop())
+  {
+    return false;
+  }
+
+  // commit the size
+  if (!file_.truncate(bytes_))
+  {
+    return false;
+  }
+
+  return file_.close();
+}
+//------------------------------------------------------------------------------
+/**
+   Send the full buffer if the card is ready for it.  Call this while idle
+   so a buffer is free when write() next needs one.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for an I/O error or if the
+   writer is not open.
+*/
+uint8_t RP2040_RawStreamWriter::poll()
+{
+  if (!open_)
+  {
+    return false;
+  }
+
+  if (pending_ && !vol_->isBusy())
+  {
+    return sendPending();
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// send the full buffer, waits if the card is busy
+uint8_t RP2040_RawStreamWriter::sendPending()
+{
+  if (!vol_->writeData(buf_[cur_ ^ 1]))
+  {
+    open_ = false;
+    return false;
+  }
+
+  pending_ = false;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/**
+   Write data to the stream.
+
+   \param[in] buf Pointer to the data to be written.
+   \param[in] nbyte Number of bytes to write.
+
+   \return The number of bytes written.  This is less than \a nbyte if
+   the file reached its maximum size and zero for an I/O error.
+*/
+size_t RP2040_RawStreamWriter::write(const void* buf, size_t nbyte)
+{
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
+  uint32_t t0 = micros();
+
+  if (!open_)
+  {
+    return 0;
+  }
+
+  // stop at the maximum size
+  if (nbyte > (maxSize_ - bytes_))
+  {
+    nbyte = maxSize_ - bytes_;
+  }
+
+  for (size_t n = nbyte; n;)
+  {
+    uint16_t m = 512 - fill_;
+
+    if (m > n)
+    {
+      m = n;
+    }
+
+    memcpy(buf_[cur_] + fill_, src, m);
+    fill_ += m;
+    src += m;
+    n -= m;
+
+    if (fill_ == 512)
+    {
+      if (pending_)
+      {
+        // both buffers full - wait for the card
+        overruns_++;
+
+        if (!sendPending())
+        {
+          return 0;
+        }
+      }
+
+      // fill the other buffer while this one waits
+      pending_ = true;
+      cur_ ^= 1;
+      fill_ = 0;
+    }
+  }
+
+  bytes_ += nbyte;
+
+  if (!poll())
+  {
+    return 0;
+  }
+
+  uint32_t t = micros() - t0;
+
+  if (t > maxWrite_)
+  {
+    maxWrite_ = t;
+  }
+
+  return nbyte;
+}
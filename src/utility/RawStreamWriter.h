@@ -0,0 +1,119 @@
+/****************************************************************************************************************************
+  RawStreamWriter.h
+
+  For all RP2040 boads using Arduimo-mbed or arduino-pico core
+
+  RP2040_SD is a library enable the usage of SD on RP2040-based boards
+
+  This Library is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+
+  This Library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along with the Arduino SdFat Library.
+  If not, see <http://www.gnu.org/licenses/>.
+
+  Based on and modified from  Arduino SdFat Library (https://github.com/arduino/Arduino)
+
+  (C) Copyright 2009 by William Greiman
+  (C) Copyright 2010 SparkFun Electronics
+  (C) Copyright 2021 by Khoi Hoang
+
+  Built by Khoi Hoang https://github.com/khoih-prog/RP2040_SD
+  Licensed under GPL-3.0 license
+
+  Version: 1.0.1
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0  K Hoang       18/06/2021 Port to RP2040-based boards using Arduimo-mbed or arduino-pico core
+  1.0.1  K Hoang       22/10/2021 Fix platform in library.json for PIO
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef RawStreamWriter_h
+#define RawStreamWriter_h
+
+/**
+   \file
+   RP2040_RawStreamWriter class
+*/
+#include "SdFat.h"
+
+//------------------------------------------------------------------------------
+/**
+   \class RP2040_RawStreamWriter
+   \brief Stream data to a contiguous file with one multiple block write.
+
+   begin() creates a contiguous file of the maximum size and starts a
+   multiple block write over its blocks.  write() fills one of two 512 byte
+   buffers while the other waits for the card, so a caller only waits when
+   both buffers are full.  Neither the FAT nor the directory is written until
+   finish() sets the file size to the bytes written and releases the unused
+   clusters.
+
+   No other file on the volume may be accessed between begin() and finish().
+   If finish() is not called the file keeps its maximum size.
+*/
+class RP2040_RawStreamWriter
+{
+  public:
+    RP2040_RawStreamWriter() : vol_(NULL), open_(false) {}
+
+    uint8_t begin(RP2040_SdFile* dirFile, const char* fileName, uint32_t maxSize);
+    uint8_t finish();
+    uint8_t poll();
+    size_t  write(const void* buf, size_t nbyte);
+
+    /** Write a byte.  \return One for success or zero for failure. */
+    size_t write(uint8_t b)
+    {
+      return write(&b, 1);
+    }
+
+    /** \return The number of bytes accepted by write(). */
+    uint32_t bytesWritten() const
+    {
+      return bytes_;
+    }
+
+    /** \return True if begin() succeeded and finish() has not been called. */
+    uint8_t isOpen() const
+    {
+      return open_;
+    }
+
+    /** \return The longest time in microseconds spent in one write() call. */
+    uint32_t maxWriteMicros() const
+    {
+      return maxWrite_;
+    }
+
+    /**
+       \return The number of times write() had to wait for the card because
+       both buffers were full.  A nonzero count means data arrived faster than
+       the card accepted it.
+    */
+    uint32_t overrunCount() const
+    {
+      return overruns_;
+    }
+
+  private:
+    RP2040_SdFile     file_;        // the contiguous file
+    RP2040_SdVolume*  vol_;         // volume of file_
+    uint8_t   buf_[2][512];         // buffer being filled and buffer waiting for the card
+    uint32_t  bytes_;               // bytes accepted by write()
+    uint32_t  maxSize_;             // file size from begin()
+    uint32_t  maxWrite_;            // longest write() call in micros
+    uint32_t  overruns_;            // writes that waited with both buffers full
+    uint16_t  fill_;                // bytes in buf_[cur_]
+    uint8_t   cur_;                 // index of the buffer being filled
+    uint8_t   open_;                // multiple block write in progress
+    uint8_t   pending_;             // buf_[cur_ ^ 1] is full and not sent
+
+    uint8_t   sendPending();
+};
+#endif  // RawStreamWriter_h
@@ -35,24 +35,16 @@
 #include <Arduino.h>
 #include "Sd2Card.h"
 
+// the only definitions of the option symbols, see SD_CONFIG_CHECK
+SD_CONFIG_DEFINE(CardStats, SD_CARD_STATS);
+
 //------------------------------------------------------------------------------
 
 #if ! (RP2040_SOFT_SPI)
 
-#ifdef USE_SPI_LIB
-
-  #ifndef SDCARD_SPI
-    #define SDCARD_SPI SPI
-  #endif
-
-  #include <SPI.h>
-  static SPISettings settings;
-
-#endif
-
-// functions for hardware SPI
+// functions for hardware SPI, each card uses its own SPI controller
 /** Send a byte to the card */
-static void spiSend(uint8_t b)
+void Sd2Card::spiSend(uint8_t b)
 {
 #ifndef USE_SPI_LIB
   SPDR = b;
@@ -60,18 +52,69 @@ static void spiSend(uint8_t b)
   while (!(SPSR & (1 << SPIF)));
 
 #else
-  SDCARD_SPI.transfer(b);
+  spi_->transfer(b);
 #endif
 }
 
 /** Receive a byte from the card */
-static  uint8_t spiRec()
+uint8_t Sd2Card::spiRec()
 {
 #ifndef USE_SPI_LIB
   spiSend(0XFF);
   return SPDR;
 #else
-  return SDCARD_SPI.transfer(0xFF);
+  return spi_->transfer(0xFF);
+#endif
+}
+
+/** Receive a buffer from the card */
+void Sd2Card::spiRec(uint8_t* buf, size_t n)
+{
+#ifndef USE_SPI_LIB
+
+  for (size_t i = 0; i < n; i++)
+  {
+    buf[i] = spiRec();
+  }
+
+#elif defined(ARDUINO_ARCH_MBED)
+  // mbed SPI transfers in place, send 0XFF while receiving
+  memset(buf, 0XFF, n);
+  spi_->transfer(buf, n);
+#else
+  // receive only, core clocks out 0XFF
+  spi_->transfer(NULL, buf, n);
+#endif
+}
+
+/** Send a buffer to the card */
+void Sd2Card::spiSend(const uint8_t* buf, size_t n)
+{
+#ifndef USE_SPI_LIB
+
+  for (size_t i = 0; i < n; i++)
+  {
+    spiSend(buf[i]);
+  }
+
+#elif defined(ARDUINO_ARCH_MBED)
+  // mbed SPI transfers in place so send a copy in chunks
+  uint8_t tmp[64];
+
+  while (n)
+  {
+    size_t k = n < sizeof(tmp) ? n : sizeof(tmp);
+
+    memcpy(tmp, buf, k);
+    spi_->transfer(tmp, k);
+
+    buf += k;
+    n -= k;
+  }
+
+#else
+  // transmit only, received data is discarded
+  spi_->transfer(buf, NULL, n);
 #endif
 }
 
@@ -143,8 +186,68 @@ void spiSend(uint8_t data)
   sei();
 }
 
+//------------------------------------------------------------------------------
+/** Soft SPI receive buffer */
+void spiRec(uint8_t* buf, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    buf[i] = spiRec();
+  }
+}
+
+//------------------------------------------------------------------------------
+/** Soft SPI send buffer */
+void spiSend(const uint8_t* buf, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    spiSend(buf[i]);
+  }
+}
+
 #endif  // SOFTWARE_SPI
 
+//------------------------------------------------------------------------------
+#if SD_CARD_STATS
+
+// start a latency sample
+#define SD_STATS_START()          uint32_t statsT0 = micros()
+
+// record a latency sample started by SD_STATS_START()
+#define SD_STATS_RECORD(index)    statsRecord(index, micros() - statsT0)
+
+//------------------------------------------------------------------------------
+// add a latency sample to count, total, max and log2 histogram
+void Sd2Card::statsRecord(uint8_t index, uint32_t us)
+{
+  sd_latency_t* p = &stats_.latency[index];
+
+  p->count++;
+  p->totalMicros += us;
+
+  if (us > p->maxMicros)
+  {
+    p->maxMicros = us;
+  }
+
+  uint8_t b = 0;
+
+  while ((us >>= 1) && b < (SD_STATS_BUCKETS - 1))
+  {
+    b++;
+  }
+
+  p->histogram[b]++;
+}
+
+#else  // SD_CARD_STATS
+
+#define SD_STATS_START()
+#define SD_STATS_RECORD(index)
+
+#endif  // SD_CARD_STATS
+
 //------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
 uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg)
@@ -155,8 +258,13 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg)
   // select card
   chipSelectLow();
 
-  // wait up to 300 ms if busy
-  waitNotBusy(300);
+  // wait up to 300 ms if busy, card is streaming data if stopping a read
+  if (cmd != CMD12)
+  {
+    waitNotBusy(300);
+  }
+
+  SD_STATS_START();
 
   // send command
   spiSend(cmd | 0x40);
@@ -182,9 +290,38 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg)
 
   spiSend(crc);
 
+  // skip stuff byte for stop read
+  if (cmd == CMD12)
+  {
+    spiRec();
+  }
+
   // wait for response
   for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++);
 
+#if SD_CARD_STATS
+
+  switch (cmd)
+  {
+    case CMD17:
+      SD_STATS_RECORD(SD_STATS_CMD17);
+      break;
+
+    case CMD24:
+      SD_STATS_RECORD(SD_STATS_CMD24);
+      break;
+
+    case CMD25:
+      SD_STATS_RECORD(SD_STATS_CMD25);
+      break;
+
+    case CMD13:
+      SD_STATS_RECORD(SD_STATS_CMD13);
+      break;
+  }
+
+#endif  // SD_CARD_STATS
+
   return status_;
 }
 
@@ -226,18 +363,16 @@ uint32_t Sd2Card::cardSize()
   }
 }
 //------------------------------------------------------------------------------
-static uint8_t chip_select_asserted = 0;
-
 void Sd2Card::chipSelectHigh()
 {
   digitalWrite(chipSelectPin_, HIGH);
 
 #ifdef USE_SPI_LIB
 
-  if (chip_select_asserted)
+  if (chipSelectAsserted_)
   {
-    chip_select_asserted = 0;
-    SDCARD_SPI.endTransaction();
+    chipSelectAsserted_ = 0;
+    spi_->endTransaction();
   }
 
 #endif
@@ -247,10 +382,10 @@ void Sd2Card::chipSelectLow()
 {
 #ifdef USE_SPI_LIB
 
-  if (!chip_select_asserted)
+  if (!chipSelectAsserted_)
   {
-    chip_select_asserted = 1;
-    SDCARD_SPI.beginTransaction(settings);
+    chipSelectAsserted_ = 1;
+    spi_->beginTransaction(settings_);
   }
 
 #endif
@@ -333,6 +468,10 @@ uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin)
   errorCode_ = inBlock_ = partialBlockRead_ = type_ = 0;
   chipSelectPin_ = chipSelectPin;
 
+#if SD_CARD_STATS
+  clearStats();
+#endif
+
   // 16-bit init start time allows over a minute
   unsigned int t0 = millis();
   uint32_t arg;
@@ -357,14 +496,14 @@ uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin)
   // clear double speed
   SPSR &= ~(1 << SPI2X);
 #else // USE_SPI_LIB
-  SDCARD_SPI.begin();
-  settings = SPISettings(250000, MSBFIRST, SPI_MODE0);
+  spi_->begin();
+  settings_ = SPISettings(250000, MSBFIRST, SPI_MODE0);
 #endif // USE_SPI_LIB
 #endif // SOFTWARE_SPI
 
   // must supply min of 74 clock cycles with CS high.
 #ifdef USE_SPI_LIB
-  SDCARD_SPI.beginTransaction(settings);
+  spi_->beginTransaction(settings_);
 #endif
 
   for (uint8_t i = 0; i < 10; i++)
@@ -373,7 +512,7 @@ uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin)
   }
 
 #ifdef USE_SPI_LIB
-  SDCARD_SPI.endTransaction();
+  spi_->endTransaction();
 #endif
 
   chipSelectLow();
@@ -578,10 +717,7 @@ uint8_t Sd2Card::readData(uint32_t block, uint16_t offset, uint16_t count, uint8
   }
 
   // transfer data
-  for (uint16_t i = 0; i < count; i++)
-  {
-    dst[i] = spiRec();
-  }
+  spiRec(dst, count);
 
 #endif  // OPTIMIZE_HARDWARE_SPI
 
@@ -634,6 +770,95 @@ void Sd2Card::readEnd()
   }
 }
 //------------------------------------------------------------------------------
+/** Read one data block in a multiple block read sequence
+
+   \param[out] dst Pointer to the location for the 512 byte data block.
+
+   \note On failure the sequence is ended with CMD12, so the card takes
+   commands again and readStop() is not needed.  errorCode() is the
+   error of the failed block.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readData(uint8_t* dst)
+{
+  // wait for start of next block
+  if (!waitStartBlock())
+  {
+    // the card is still streaming blocks, stop it but keep the error
+    uint8_t code = errorCode_;
+
+    readStop();
+    errorCode_ = code;
+
+    return false;
+  }
+
+  // transfer data
+  spiRec(dst, 512);
+
+  spiRec();  // get first crc byte
+  spiRec();  // get second crc byte
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Start a read multiple blocks sequence.
+
+   \param[in] blockNumber Address of first block in sequence.
+
+   \note This function is used with readData() and readStop()
+   for optimized multiple block reads.  SPI chip select is low
+   on success.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readStart(uint32_t blockNumber)
+{
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC)
+  {
+    blockNumber <<= 9;
+  }
+
+  if (cardCommand(CMD18, blockNumber))
+  {
+    error(SD_CARD_ERROR_CMD18);
+    goto fail;
+  }
+
+  return true;
+
+fail:
+  chipSelectHigh();
+
+  return false;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+
+  \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readStop()
+{
+  if (cardCommand(CMD12, 0))
+  {
+    error(SD_CARD_ERROR_CMD12);
+    goto fail;
+  }
+
+  chipSelectHigh();
+  return true;
+
+fail:
+  chipSelectHigh();
+
+  return false;
+}
+//------------------------------------------------------------------------------
 /** read CID or CSR register */
 uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf)
 {
@@ -651,10 +876,7 @@ uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf)
   }
 
   // transfer data
-  for (uint16_t i = 0; i < 16; i++)
-  {
-    dst[i] = spiRec();
-  }
+  spiRec(dst, 16);
 
   spiRec();  // get first crc byte
   spiRec();  // get second crc byte
@@ -708,31 +930,31 @@ uint8_t Sd2Card::setSckRate(uint8_t sckRateID)
   switch (sckRateID)
   {
     case 0:
-      settings = SPISettings(25000000, MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(25000000, MSBFIRST, SPI_MODE0);
       break;
 
     case 1:
-      settings = SPISettings(4000000,  MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(4000000,  MSBFIRST, SPI_MODE0);
       break;
 
     case 2:
-      settings = SPISettings(2000000,  MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(2000000,  MSBFIRST, SPI_MODE0);
       break;
 
     case 3:
-      settings = SPISettings(1000000,  MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(1000000,  MSBFIRST, SPI_MODE0);
       break;
 
     case 4:
-      settings = SPISettings(500000,   MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(500000,   MSBFIRST, SPI_MODE0);
       break;
 
     case 5:
-      settings = SPISettings(250000,   MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(250000,   MSBFIRST, SPI_MODE0);
       break;
 
     default:
-      settings = SPISettings(125000,   MSBFIRST, SPI_MODE0);
+      settings_ = SPISettings(125000,   MSBFIRST, SPI_MODE0);
   }
 
 #endif // USE_SPI_LIB
@@ -745,12 +967,26 @@ uint8_t Sd2Card::setSckRate(uint8_t sckRateID)
 // set the SPI clock frequency
 uint8_t Sd2Card::setSpiClock(uint32_t clock)
 {
-  settings = SPISettings(clock, MSBFIRST, SPI_MODE0);
+  settings_ = SPISettings(clock, MSBFIRST, SPI_MODE0);
 
   return true;
 }
 #endif
 
+//------------------------------------------------------------------------------
+/** Wait for any previous write to complete.
+
+  \return The value one, true, is returned for success and
+   the value zero, false, is returned for a timeout.
+*/
+uint8_t Sd2Card::syncBlocks()
+{
+  chipSelectLow();
+  uint8_t rtn = waitWriteDone(SD_WRITE_TIMEOUT);
+  chipSelectHigh();
+
+  return rtn;
+}
 //------------------------------------------------------------------------------
 // wait for card to go not busy
 uint8_t Sd2Card::waitNotBusy(unsigned int timeoutMillis)
@@ -771,22 +1007,39 @@ uint8_t Sd2Card::waitNotBusy(unsigned int timeoutMillis)
   return false;
 }
 //------------------------------------------------------------------------------
+// wait for the card to program written data, recorded as SD_STATS_BUSY
+uint8_t Sd2Card::waitWriteDone(unsigned int timeoutMillis)
+{
+  SD_STATS_START();
+
+  uint8_t rtn = waitNotBusy(timeoutMillis);
+
+  SD_STATS_RECORD(SD_STATS_BUSY);
+
+  return rtn;
+}
+//------------------------------------------------------------------------------
 /** Wait for start block token */
 uint8_t Sd2Card::waitStartBlock()
 {
   unsigned int t0 = millis();
 
+  SD_STATS_START();
+
   while ((status_ = spiRec()) == 0XFF)
   {
     unsigned int d = millis() - t0;
 
     if (d > SD_READ_TIMEOUT)
     {
+      SD_STATS_RECORD(SD_STATS_TOKEN);
       error(SD_CARD_ERROR_READ_TIMEOUT);
       goto fail;
     }
   }
 
+  SD_STATS_RECORD(SD_STATS_TOKEN);
+
   if (status_ != DATA_START_BLOCK)
   {
     error(SD_CARD_ERROR_READ);
@@ -843,7 +1096,7 @@ uint8_t Sd2Card::writeBlock(uint32_t blockNumber, const uint8_t* src, uint8_t bl
   if (blocking)
   {
     // wait for flash programming to complete
-    if (!waitNotBusy(SD_WRITE_TIMEOUT))
+    if (!waitWriteDone(SD_WRITE_TIMEOUT))
     {
       error(SD_CARD_ERROR_WRITE_TIMEOUT);
       goto fail;
@@ -869,8 +1122,11 @@ fail:
 /** Write one data block in a multiple block write sequence */
 uint8_t Sd2Card::writeData(const uint8_t* src)
 {
+  // isBusy() may have released chip select since the last block
+  chipSelectLow();
+
   // wait for previous write to finish
-  if (!waitNotBusy(SD_WRITE_TIMEOUT))
+  if (!waitWriteDone(SD_WRITE_TIMEOUT))
   {
     error(SD_CARD_ERROR_WRITE_MULTIPLE);
     chipSelectHigh();
@@ -907,11 +1163,7 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src)
 #else  // OPTIMIZE_HARDWARE_SPI
 
   spiSend(token);
-
-  for (uint16_t i = 0; i < 512; i++)
-  {
-    spiSend(src[i]);
-  }
+  spiSend(src, 512);
 
 #endif  // OPTIMIZE_HARDWARE_SPI
 
@@ -988,14 +1240,16 @@ fail:
 */
 uint8_t Sd2Card::writeStop()
 {
-  if (!waitNotBusy(SD_WRITE_TIMEOUT))
+  chipSelectLow();
+
+  if (!waitWriteDone(SD_WRITE_TIMEOUT))
   {
     goto fail;
   }
 
   spiSend(STOP_TRAN_TOKEN);
 
-  if (!waitNotBusy(SD_WRITE_TIMEOUT))
+  if (!waitWriteDone(SD_WRITE_TIMEOUT))
   {
     goto fail;
   }
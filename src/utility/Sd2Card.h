@@ -42,6 +42,7 @@
 */
 #include "Sd2PinMap.h"
 #include "SdInfo.h"
+#include "BlockDevice.h"
 
 #include "RP2040_SD_Debug.h"
 
@@ -100,6 +101,20 @@
     #define OPTIMIZE_HARDWARE_SPI
   #endif
 
+  #ifdef USE_SPI_LIB
+
+    #include <SPI.h>
+
+    #ifndef SDCARD_SPI
+      /** SPI controller used by a Sd2Card unless another is given to init() */
+      #define SDCARD_SPI SPI
+    #endif
+
+    /** Class of the SPI controllers, SPI and SPI1 on RP2040 */
+    typedef decltype(SDCARD_SPI) RP2040_SdSpiClass;
+
+  #endif  // USE_SPI_LIB
+
 #else
 
   // SOFTWARE_SPI
@@ -131,6 +146,37 @@
 /** write time out ms */
 #define SD_WRITE_TIMEOUT          600
 
+/**
+   Set SD_CARD_STATS nonzero to record command counts, latency histograms
+   and error counts.  See Sd2Card::stats().  No code or RAM is used if zero.
+*/
+#ifndef SD_CARD_STATS
+  #define SD_CARD_STATS           0
+#endif
+
+/**
+   Options that change the size of a class must be the same in every file of
+   a program, so set them as build flags, for example build_flags in
+   platformio.ini, or edit the header that documents them.  A #define in a
+   sketch reaches the sketch only, not the library sources.  For each such
+   option every file refers to a symbol named after the option's value and
+   only the library defines it, so a mismatch fails to link with an
+   undefined RP2040_SdConfig_<name>_<value> symbol.  These options must be
+   plain decimal numbers.
+*/
+#define SD_CONFIG_SYMBOL_(name, value)  RP2040_SdConfig_##name##_##value
+#define SD_CONFIG_SYMBOL(name, value)   SD_CONFIG_SYMBOL_(name, value)
+
+/** Refer to the symbol for the option \a name, set to \a value */
+#define SD_CONFIG_CHECK(name, value) \
+  extern const uint8_t SD_CONFIG_SYMBOL(name, value); \
+  static const uint8_t* const sdConfig##name __attribute__((used)) = &SD_CONFIG_SYMBOL(name, value)
+
+/** Define the symbol for the option \a name, once in the library */
+#define SD_CONFIG_DEFINE(name, value)   const uint8_t SD_CONFIG_SYMBOL(name, value) = 0
+
+SD_CONFIG_CHECK(CardStats, SD_CARD_STATS);
+
 //------------------------------------------------------------------------------
 // SD card errors
 
@@ -158,6 +204,8 @@ enum
   SD_CARD_ERROR_WRITE_PROGRAMMING   = 0x14,
   SD_CARD_ERROR_WRITE_TIMEOUT       = 0x15,
   SD_CARD_ERROR_SCK_RATE            = 0X16,
+  SD_CARD_ERROR_CMD12               = 0X17,
+  SD_CARD_ERROR_CMD18               = 0X18,
 };
 
 
@@ -171,12 +219,57 @@ enum
 };
 
 //------------------------------------------------------------------------------
+#if SD_CARD_STATS
+
+/** Number of log2 histogram buckets. Bucket i counts latencies of 2^i to 2^(i+1) - 1 us. */
+#define SD_STATS_BUCKETS          20
+
+/** Number of error codes counted, see SD card errors above */
+#define SD_STATS_ERRORS           0X20
 
-class Sd2Card
+// latency records in sd_stats_t
+enum
+{
+  SD_STATS_CMD17  = 0,    // CMD17 command and R1 response
+  SD_STATS_CMD24  = 1,    // CMD24 command and R1 response
+  SD_STATS_CMD25  = 2,    // CMD25 command and R1 response
+  SD_STATS_CMD13  = 3,    // CMD13 command and R1 response
+  SD_STATS_BUSY   = 4,    // busy time after a write
+  SD_STATS_TOKEN  = 5,    // waitStartBlock() wait for data token
+  SD_STATS_COUNT  = 6
+};
+
+/** Latency record for one command or wait */
+typedef struct
+{
+  uint32_t count;                         // number of samples
+  uint32_t maxMicros;                     // largest sample
+  uint64_t totalMicros;                   // sum of samples
+  uint32_t histogram[SD_STATS_BUCKETS];   // log2 histogram of samples
+} sd_latency_t;
+
+/** Statistics recorded by a Sd2Card */
+typedef struct
+{
+  sd_latency_t  latency[SD_STATS_COUNT];  // indexed by SD_STATS_CMD17 ... SD_STATS_TOKEN
+  uint32_t      errors[SD_STATS_ERRORS];  // count of each error code raised
+} sd_stats_t;
+
+#endif  // SD_CARD_STATS
+
+//------------------------------------------------------------------------------
+
+class Sd2Card : public RP2040_BlockDevice
 {
   public:
 
-    Sd2Card() : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0) {}
+    Sd2Card() : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0)
+    {
+#if ! (RP2040_SOFT_SPI) && defined(USE_SPI_LIB)
+      spi_ = &SDCARD_SPI;
+      chipSelectAsserted_ = 0;
+#endif
+    }
 
     uint32_t cardSize();
     uint8_t erase(uint32_t firstBlock, uint32_t lastBlock);
@@ -217,6 +310,20 @@ class Sd2Card
 
     uint8_t init(uint8_t sckRateID, uint8_t chipSelectPin);
 
+#if ! (RP2040_SOFT_SPI) && defined(USE_SPI_LIB)
+    /**
+       Initialize an SD flash memory card on the SPI controller \a spi, for
+       example SPI1.  The card keeps using \a spi and its own clock setting
+       so cards on SPI0 and SPI1 may be used at the same time.
+       See sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin).
+    */
+    uint8_t init(uint8_t sckRateID, uint8_t chipSelectPin, RP2040_SdSpiClass& spi)
+    {
+      spi_ = &spi;
+      return init(sckRateID, chipSelectPin);
+    }
+#endif
+
     void partialBlockRead(uint8_t value);
 
     /** Returns the current value, true or false, for partial block read. */
@@ -246,7 +353,11 @@ class Sd2Card
     }
 
     void readEnd();
+    uint8_t readData(uint8_t* dst);
+    uint8_t readStart(uint32_t blockNumber);
+    uint8_t readStop();
     uint8_t setSckRate(uint8_t sckRateID);
+    uint8_t syncBlocks();
 
 #ifdef USE_SPI_LIB
     uint8_t setSpiClock(uint32_t clock);
@@ -264,6 +375,20 @@ class Sd2Card
     uint8_t writeStop();
     uint8_t isBusy();
 
+#if SD_CARD_STATS
+    /** Clear all statistics. */
+    void clearStats()
+    {
+      memset(&stats_, 0, sizeof(stats_));
+    }
+
+    /** \return Statistics recorded since init() or clearStats(). */
+    const sd_stats_t& stats() const
+    {
+      return stats_;
+    }
+#endif  // SD_CARD_STATS
+
   private:
 
     uint32_t block_;
@@ -275,6 +400,24 @@ class Sd2Card
     uint8_t status_;
     uint8_t type_;
 
+#if SD_CARD_STATS
+    sd_stats_t stats_;
+    void statsRecord(uint8_t index, uint32_t micros);
+#endif  // SD_CARD_STATS
+
+#if ! (RP2040_SOFT_SPI)
+#ifdef USE_SPI_LIB
+    RP2040_SdSpiClass* spi_;
+    SPISettings settings_;
+    uint8_t chipSelectAsserted_;
+#endif  // USE_SPI_LIB
+
+    void spiSend(uint8_t b);
+    void spiSend(const uint8_t* buf, size_t n);
+    uint8_t spiRec();
+    void spiRec(uint8_t* buf, size_t n);
+#endif  // RP2040_SOFT_SPI
+
     // private functions
     uint8_t cardAcmd(uint8_t cmd, uint32_t arg)
     {
@@ -287,6 +430,15 @@ class Sd2Card
     void error(uint8_t code)
     {
       errorCode_ = code;
+
+#if SD_CARD_STATS
+
+      if (code < SD_STATS_ERRORS)
+      {
+        stats_.errors[code]++;
+      }
+
+#endif  // SD_CARD_STATS
     }
 
     uint8_t readRegister(uint8_t cmd, void* buf);
@@ -300,6 +452,7 @@ class Sd2Card
     }
 
     uint8_t waitNotBusy(unsigned int timeoutMillis);
+    uint8_t waitWriteDone(unsigned int timeoutMillis);
     uint8_t writeData(uint8_t token, const uint8_t* src);
     uint8_t waitStartBlock();
 };
@@ -53,10 +53,228 @@
 */
 #define ALLOW_DEPRECATED_FUNCTIONS      1
 
+/**
+   Number of 512 byte blocks in the RP2040_SdVolume block cache.  Must be at
+   least one.  Each extra block costs 524 bytes of RAM and lets FAT, directory
+   and partial data blocks stay cached together.
+*/
+#ifndef SD_CACHE_BLOCKS
+  #define SD_CACHE_BLOCKS               4
+#endif
+
+SD_CONFIG_CHECK(CacheBlocks, SD_CACHE_BLOCKS);
+
+/**
+   Number of consecutive FAT blocks held in the RP2040_SdVolume FAT window.
+   FAT lookups use this window instead of the block cache so cluster
+   chain walks do not evict file data or directory blocks.  Range is 1 to 32.
+*/
+#ifndef SD_FAT_CACHE_BLOCKS
+  #define SD_FAT_CACHE_BLOCKS           4
+#endif
+
+#if SD_FAT_CACHE_BLOCKS < 1 || SD_FAT_CACHE_BLOCKS > 32
+  #error SD_FAT_CACHE_BLOCKS must be 1 to 32
+#endif
+
+SD_CONFIG_CHECK(FatCacheBlocks, SD_FAT_CACHE_BLOCKS);
+
+/**
+   Second FAT update policy.
+
+   0 - write each mirror FAT block right after its first FAT block.
+
+   1 - record changed FAT blocks and write their mirrors in one sorted,
+       coalesced pass at RP2040_SdFile::sync() or close().
+
+   2 - as 1 but only write mirrors at RP2040_SdVolume::sync(), called by
+       SDClass::end().  The second FAT is stale until then.
+*/
+#ifndef SD_FAT_MIRROR_MODE
+  #define SD_FAT_MIRROR_MODE            0
+#endif
+
+/** Number of block ranges recorded for deferred mirror writes. */
+#define SD_FAT_MIRROR_RANGES            8
+
+/**
+   Bytes of RAM for the free cluster bitmap, zero to disable it.  The bitmap
+   is built at mount with one pass over the FAT and lets cluster allocation
+   skip groups of clusters known to be in use.  Each bit covers the smallest
+   power of two group of clusters that fits the bitmap in this many bytes.
+*/
+#ifndef SD_FREE_BITMAP_BYTES
+  #define SD_FREE_BITMAP_BYTES          0
+#endif
+
+SD_CONFIG_CHECK(FreeBitmapBytes, SD_FREE_BITMAP_BYTES);
+
+/**
+   Number of cluster extents cached in each open RP2040_SdFile, zero to
+   disable.  Extents are recorded as the cluster chain is followed so seeks,
+   reads and writes inside the known part of a file need no FAT access.
+   Each extent costs 12 bytes of RAM per file.
+*/
+#ifndef SD_FILE_EXTENTS
+  #define SD_FILE_EXTENTS               0
+#endif
+
+#if SD_FILE_EXTENTS > 255
+  #error SD_FILE_EXTENTS must be 0 to 255
+#endif
+
+SD_CONFIG_CHECK(FileExtents, SD_FILE_EXTENTS);
+
+/**
+   Minimum number of clusters RP2040_SdFile::write() allocates when a file
+   grows past its last cluster.  A larger write allocates all the clusters it
+   needs with one search of the FAT.  Unused clusters past the end of file
+   are released by RP2040_SdFile::close() or truncate().
+*/
+#ifndef SD_ALLOC_CLUSTERS
+  #define SD_ALLOC_CLUSTERS             1
+#endif
+
+/**
+   Number of 8.3 names held in the RP2040_SdVolume directory name index, zero
+   to disable.  The index covers the FAT16 or FAT32 directory last scanned by
+   RP2040_SdFile::open() and remembers its first free entry so opens and
+   creates in that directory read one block instead of the whole directory.
+   Each name costs 8 bytes of RAM.  Larger directories are scanned as before.
+*/
+#ifndef SD_DIR_INDEX_ENTRIES
+  #define SD_DIR_INDEX_ENTRIES          0
+#endif
+
+#if SD_DIR_INDEX_ENTRIES > 65535
+  #error SD_DIR_INDEX_ENTRIES must be 0 to 65535
+#endif
+
+SD_CONFIG_CHECK(DirIndexEntries, SD_DIR_INDEX_ENTRIES);
+
+/**
+   Number of directory paths SDClass remembers, zero to disable.  Each entry
+   maps a FAT16 or FAT32 directory path to the location of its directory
+   entry, so SD.open(), exists(), mkdir(), remove() and rmdir() start at the
+   deepest known directory of a path instead of searching each level from
+   root.  Each entry costs SD_PATH_CACHE_LEN + 12 bytes of RAM.  Only
+   RP2040_SD.h uses this option, so a #define before it is included is
+   enough and no link check is needed.
+*/
+#ifndef SD_PATH_CACHE_ENTRIES
+  #define SD_PATH_CACHE_ENTRIES         0
+#endif
+
+/** Longest directory path, including the terminating zero, SDClass remembers. */
+#ifndef SD_PATH_CACHE_LEN
+  #define SD_PATH_CACHE_LEN             64
+#endif
+
+/**
+   Number of RP2040_SdFile handles in the pool File objects open from.  A
+   pool handle costs sizeof(RP2040_SdFile) bytes of static RAM and is reused
+   without heap allocation.  Zero takes every handle from the heap.  The
+   pool is built by RP2040_SD.h in the sketch, so like SD_PATH_CACHE_ENTRIES
+   it may be set with a #define before that header.
+*/
+#ifndef SD_FILE_POOL_SIZE
+  #define SD_FILE_POOL_SIZE             0
+#endif
+
+#if SD_FILE_POOL_SIZE > 255
+  #error SD_FILE_POOL_SIZE must be 0 to 255
+#endif
+
+/**
+   Set SD_FILE_POOL_HEAP nonzero to take a handle from the heap when the
+   File handle pool is empty.  If zero, opens fail once all pool handles are
+   in use.
+*/
+#ifndef SD_FILE_POOL_HEAP
+  #define SD_FILE_POOL_HEAP             1
+#endif
+
+/**
+   Set SD_EXFAT nonzero to mount exFAT volumes, normally SDXC cards, as well
+   as FAT16 and FAT32.  exFAT files are limited to 4 GB less one byte and
+   files larger than this are not opened.
+*/
+#ifndef SD_EXFAT
+  #define SD_EXFAT                      0
+#endif
+
+SD_CONFIG_CHECK(ExFat, SD_EXFAT);
+
 //------------------------------------------------------------------------------
 // forward declaration since RP2040_SdVolume is used in RP2040_SdFile
 class RP2040_SdVolume;
 
+//==============================================================================
+/**
+   \struct fileExtent
+   \brief A run of contiguous clusters in a file
+*/
+struct fileExtent
+{
+  /** index in the file of the first cluster of the run */
+  uint32_t index;
+  /** first cluster of the run */
+  uint32_t cluster;
+  /** number of clusters in the run */
+  uint32_t count;
+};
+
+/** Type name for fileExtent */
+typedef struct fileExtent extent_t;
+
+//==============================================================================
+/**
+   \struct dirIndexEntry
+   \brief Location of a named entry in the directory name index
+*/
+struct dirIndexEntry
+{
+  /** block that holds the directory entry */
+  uint32_t block;
+  /** hash of the 8.3 name */
+  uint16_t hash;
+  /** index of the entry in its block */
+  uint8_t index;
+};
+
+/** Type name for dirIndexEntry */
+typedef struct dirIndexEntry dirindex_t;
+
+//==============================================================================
+/**
+   \struct dirInfo
+   \brief Compact directory entry filled by RP2040_SdFile::readDirEntries()
+*/
+struct dirInfo
+{
+  /** 8.3 name with a dot before any extension, zero terminated */
+  char name[13];
+  /** FAT attribute bits, DIR_ATT_DIRECTORY is set for a subdirectory */
+  uint8_t attributes;
+  /** index of the entry in its directory, see RP2040_SdFile::open() */
+  uint16_t index;
+  /** file size in bytes */
+  uint32_t size;
+  /** first cluster, zero for an empty file */
+  uint32_t firstCluster;
+  /** creation date in FAT format */
+  uint16_t creationDate;
+  /** creation time in FAT format */
+  uint16_t creationTime;
+  /** last write date in FAT format */
+  uint16_t lastWriteDate;
+  /** last write time in FAT format */
+  uint16_t lastWriteTime;
+};
+
+/** Type name for dirInfo */
+typedef struct dirInfo dirinfo_t;
+
 //==============================================================================
 // RP2040_SdFile class
 
@@ -175,7 +393,7 @@ static inline uint8_t FAT_SECOND(uint16_t fatTime)
 //------------------------------------------------------------------------------
 /**
    \class RP2040_SdFile
-   \brief Access FAT16 and FAT32 files on SD and SDHC cards.
+   \brief Access FAT16, FAT32 and exFAT files on SD, SDHC and SDXC cards.
 */
 class RP2040_SdFile : public Print
 {
@@ -316,8 +534,10 @@ class RP2040_SdFile : public Print
     uint8_t makeDir(RP2040_SdFile* dir, const char* dirName);
     uint8_t open(RP2040_SdFile* dirFile, uint16_t index, uint8_t oflag);
     uint8_t open(RP2040_SdFile* dirFile, const char* fileName, uint8_t oflag);
+    uint8_t openDirEntry(RP2040_SdVolume* vol, uint32_t block, uint8_t index, uint32_t cluster);
 
     uint8_t     openRoot(RP2040_SdVolume* vol);
+    uint8_t     preallocate(uint32_t bytes);
     static void printDirName(const dir_t& dir, uint8_t width);
     static void printFatDate(uint16_t fatDate);
     static void printFatTime(uint16_t fatTime);
@@ -336,7 +556,10 @@ class RP2040_SdFile : public Print
     }
 
     int16_t         read(void* buf, uint16_t nbyte);
+    int16_t         readAt(uint32_t pos, void* buf, uint16_t nbyte);
     int8_t          readDir(dir_t* dir);
+    int16_t         readDirEntries(dirinfo_t* list, uint16_t count, uint8_t attrMask = 0,
+                                   uint8_t attrValue = 0, const char* ext = NULL);
     static uint8_t  remove(RP2040_SdFile* dirFile, const char* fileName);
     uint8_t         remove();
 
@@ -380,6 +603,8 @@ class RP2040_SdFile : public Print
       }
     }
 
+    int16_t statEntries(const char* const* names, uint16_t count, dirinfo_t* list);
+
     uint8_t timestamp(uint8_t flag, uint16_t year, uint8_t month, uint8_t day,
                       uint8_t hour, uint8_t minute, uint8_t second);
 
@@ -412,6 +637,7 @@ class RP2040_SdFile : public Print
     size_t write(uint8_t b);
     size_t write(const void* buf, uint16_t nbyte);
     size_t write(const char* str);
+    size_t writeAt(uint32_t pos, const void* buf, uint16_t nbyte);
 
     int availableForWrite();
 
@@ -549,14 +775,47 @@ class RP2040_SdFile : public Print
     uint32_t  fileSize_;      // file size in bytes
     uint32_t  firstCluster_;  // first cluster of file
     RP2040_SdVolume* vol_;           // volume where file is located
+#if SD_FILE_EXTENTS
+    extent_t  extent_[SD_FILE_EXTENTS];  // known runs of the chain, in file order from cluster zero
+    uint8_t   extentCount_;   // number of extents in use
+#endif  // SD_FILE_EXTENTS
+#if SD_EXFAT
+    uint32_t  dirBlock2_;     // exFAT block holding entries 16 to 31 past the start of dirBlock_
+    uint32_t  dirBlock3_;     // exFAT block holding entries 32 and 33, a long name set at index 15
+    uint32_t  exClusters_;    // clusters allocated to an exFAT NoFatChain file
+    uint8_t   exFlags_;       // exFAT stream extension flags, zero for FAT16 and FAT32
+#endif  // SD_EXFAT
+    uint8_t   allocTail_;     // an allocation batch may reach past end of file, released by close()
+    uint32_t  atCluster_;     // cluster for atPosition_
+    uint32_t  atPosition_;    // cluster start of the last readAt() or writeAt(), zero if none
 
     // private functions
-    uint8_t         addCluster();
+    uint8_t         addCluster(uint32_t count = 1);
     uint8_t         addDirCluster();
     dir_t*          cacheDirEntry(uint8_t action);
+    uint8_t         nextCluster(uint32_t index, uint32_t* next);
+    uint8_t         seekAt(uint32_t pos);
+#if SD_EXFAT
+    uint8_t         exFatAddCluster(uint32_t count);
+    exdir_t*        exFatCacheEntry(uint8_t i, uint8_t action);
+    uint8_t         exFatDirEntry(dir_t* dir);
+    static uint16_t exFatNameHash(RP2040_SdVolume* vol, const uint16_t* name, uint8_t length);
+    uint8_t         exFatOpen(RP2040_SdFile* dirFile, const char* fileName, uint8_t oflag);
+    int8_t          exFatOpenSet(RP2040_SdFile* dirFile, const uint16_t* name, uint8_t length,
+                                 uint16_t hash, uint8_t oflag);
+    int8_t          exFatReadDir(dir_t* dir, uint16_t* index);
+    uint8_t         exFatSync();
+#endif  // SD_EXFAT
+#if SD_FILE_EXTENTS
+    void            extentAdd(uint32_t index, uint32_t cluster);
+    uint8_t         extentFind(uint32_t* index, uint32_t* cluster) const;
+    void            extentReset();
+    void            extentTrim(uint32_t count);
+#endif  // SD_FILE_EXTENTS
     static void     (*dateTime_)(uint16_t* date, uint16_t* time);
     static uint8_t  make83Name(const char* str, uint8_t* name);
     uint8_t         openCachedEntry(uint8_t cacheIndex, uint8_t oflags);
+    int8_t          readDir(dir_t* dir, uint16_t* index);
     dir_t*          readDirCache();
 };
 //==============================================================================
@@ -578,50 +837,112 @@ union cache_t
   mbr_t    mbr;
   /** Used to access to a cached FAT boot sector. */
   fbs_t    fbs;
+  /** Used to access a cached FAT32 FSINFO sector. */
+  fsinfo_t fsinfo;
+#if SD_EXFAT
+  /** Used to access a cached exFAT boot sector. */
+  exfbs_t  exfbs;
+  /** Used to access cached exFAT directory entries. */
+  exdir_t  exdir[16];
+#endif  // SD_EXFAT
 };
 
 //------------------------------------------------------------------------------
 /**
    \class RP2040_SdVolume
-   \brief Access FAT16 and FAT32 volumes on SD and SDHC cards.
+   \brief Access FAT16, FAT32 and exFAT volumes on SD, SDHC and SDXC cards.
+
+   Each volume owns its block cache and FAT window so several volumes, on
+   one card or on different cards, may be mounted at the same time.
 */
 class RP2040_SdVolume
 {
   public:
     /** Create an instance of RP2040_SdVolume */
-    RP2040_SdVolume(): allocSearchStart_(2), fatType_(0) {}
+    RP2040_SdVolume(): cacheIndex_(0), cacheUseCount_(0), cacheHits_(0), cacheMisses_(0),
+      fatCacheBlock_(0), fatCacheCount_(0), fatCacheDirty_(0), fatCacheMirror_(0),
+      fatCacheMirrorOffset_(0), fatCacheHits_(0), fatCacheMisses_(0), fatMirrorCount_(0), sdCard_(0),
+      allocSearchStart_(2), fatType_(0), freeClusters_(0XFFFFFFFF), fsInfoBlock_(0), fsInfoDirty_(false),
+      fsInfoNextFree_(2)
+    {
+      for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++)
+      {
+        cacheBlockNumber_[i] = 0XFFFFFFFF;
+        cacheLastUse_[i] = 0;
+        cacheDirty_[i] = 0;
+      }
+
+#if SD_FREE_BITMAP_BYTES
+      freeBitmapValid_ = false;
+#endif
+
+#if SD_DIR_INDEX_ENTRIES
+      dirIndexKey_ = 0;
+#endif
+    }
 
     /** Clear the cache and returns a pointer to the cache.  Used by the WaveRP
         recorder to do raw write to the SD card.  Not for normal apps.
     */
-    static uint8_t* cacheClear()
+    uint8_t* cacheClear()
     {
       cacheFlush();
-      cacheBlockNumber_ = 0XFFFFFFFF;
-      return cacheBuffer_.data;
+      cacheInvalidate(0, 0XFFFFFFFF);
+      return cacheBuffer_[cacheIndex_].data;
+    }
+
+    /** \return The number of cache lookups satisfied without a device read. */
+    uint32_t cacheHitCount() const
+    {
+      return cacheHits_;
+    }
+
+    /** \return The number of cache lookups that required a device read. */
+    uint32_t cacheMissCount() const
+    {
+      return cacheMisses_;
+    }
+
+    /** \return The number of FAT lookups satisfied by the FAT window. */
+    uint32_t fatCacheHitCount() const
+    {
+      return fatCacheHits_;
+    }
+
+    /** \return The number of FAT lookups that reloaded the FAT window. */
+    uint32_t fatCacheMissCount() const
+    {
+      return fatCacheMisses_;
+    }
+
+    /** Reset the cache and FAT window hit and miss counters. */
+    void cacheClearStats()
+    {
+      cacheHits_ = cacheMisses_ = 0;
+      fatCacheHits_ = fatCacheMisses_ = 0;
     }
 
     /**
        Initialize a FAT volume.  Try partition one first then try super
        floppy format.
 
-       \param[in] dev The Sd2Card where the volume is located.
+       \param[in] dev The block device, normally a Sd2Card, where the volume is located.
 
        \return The value one, true, is returned for success and
        the value zero, false, is returned for failure.  Reasons for
        failure include not finding a valid partition, not finding a valid
        FAT file system or an I/O error.
     */
-    uint8_t init(Sd2Card* dev)
+    uint8_t init(RP2040_BlockDevice* dev)
     {
       return init(dev, 1) ? true : init(dev, 0);
     }
 
-    uint8_t init(Sd2Card* dev, uint8_t part);
+    uint8_t init(RP2040_BlockDevice* dev, uint8_t part);
 
     // inline functions that return volume info
     /** \return The volume's cluster size in blocks. */
-    uint8_t blocksPerCluster()const
+    uint16_t blocksPerCluster()const
     {
       return blocksPerCluster_;
     }
@@ -650,6 +971,8 @@ class RP2040_SdVolume
       return dataStartBlock_;
     }
 
+    int32_t freeClusterCount();
+
     /** \return The number of FAT structures on the volume. */
     uint8_t fatCount()const
     {
@@ -662,7 +985,7 @@ class RP2040_SdVolume
       return fatStartBlock_;
     }
 
-    /** \return The FAT type of the volume. Values are 12, 16 or 32. */
+    /** \return The FAT type of the volume. Values are 12, 16, 32 or 64 for exFAT. */
     uint8_t fatType()const
     {
       return fatType_;
@@ -675,29 +998,31 @@ class RP2040_SdVolume
     }
 
     /** \return The logical block number for the start of the root directory
-         on FAT16 volumes or the first cluster number on FAT32 volumes. */
+         on FAT16 volumes or the first cluster number on FAT32 and exFAT volumes. */
     uint32_t rootDirStart()const
     {
       return rootDirStart_;
     }
 
-    /** return a pointer to the Sd2Card object for this volume */
-    static Sd2Card* sdCard()
+    /** return a pointer to the block device, normally a Sd2Card, for this volume */
+    RP2040_BlockDevice* sdCard() const
     {
       return sdCard_;
     }
 
+    uint8_t sync();
+
     //------------------------------------------------------------------------------
 #if ALLOW_DEPRECATED_FUNCTIONS
     // Deprecated functions  - suppress cpplint warnings with NOLINT comment
-    /** \deprecated Use: uint8_t RP2040_SdVolume::init(Sd2Card* dev); */
-    uint8_t init(Sd2Card& dev)
+    /** \deprecated Use: uint8_t RP2040_SdVolume::init(RP2040_BlockDevice* dev); */
+    uint8_t init(RP2040_BlockDevice& dev)
     {
       return init(&dev);
     }
 
-    /** \deprecated Use: uint8_t RP2040_SdVolume::init(Sd2Card* dev, uint8_t vol); */
-    uint8_t init(Sd2Card& dev, uint8_t part)
+    /** \deprecated Use: uint8_t RP2040_SdVolume::init(RP2040_BlockDevice* dev, uint8_t vol); */
+    uint8_t init(RP2040_BlockDevice& dev, uint8_t part)
     {
       return init(&dev, part);
     }
@@ -708,33 +1033,82 @@ class RP2040_SdVolume
     // Allow RP2040_SdFile access to RP2040_SdVolume private data.
     friend class RP2040_SdFile;
 
+    // RP2040_RawStreamWriter writes file data to the device directly.
+    friend class RP2040_RawStreamWriter;
+
     // value for action argument in cacheRawBlock to indicate read from cache
     static uint8_t const CACHE_FOR_READ = 0;
     // value for action argument in cacheRawBlock to indicate cache dirty
     static uint8_t const CACHE_FOR_WRITE = 1;
-
-    static cache_t    cacheBuffer_;         // 512 byte cache for device blocks
-    static uint32_t   cacheBlockNumber_;    // Logical number of block in the cache
-    static Sd2Card*   sdCard_;              // Sd2Card object for cache
-    static uint8_t    cacheDirty_;          // cacheFlush() will write block if true
-    static uint32_t   cacheMirrorBlock_;    // block number for mirror FAT
+    // option for action argument in cacheRawBlock to skip the device read
+    static uint8_t const CACHE_OPTION_NO_READ = 2;
+    // value for action argument in cacheRawBlock to claim a block that will be overwritten
+    static uint8_t const CACHE_RESERVE_FOR_WRITE = CACHE_OPTION_NO_READ | CACHE_FOR_WRITE;
+
+    // block cache, entries are owned by this volume
+    cache_t   cacheBuffer_[SD_CACHE_BLOCKS];       // 512 byte caches for device blocks
+    uint32_t  cacheBlockNumber_[SD_CACHE_BLOCKS];  // Logical number of block in each cache entry
+    uint32_t  cacheLastUse_[SD_CACHE_BLOCKS];      // LRU time stamp, zero if entry is free
+    uint8_t   cacheDirty_[SD_CACHE_BLOCKS];        // cacheFlush() will write entry if true
+    uint8_t   cacheIndex_;                  // entry of most recent cacheRawBlock()
+    uint32_t  cacheUseCount_;               // LRU clock
+    uint32_t  cacheHits_;                   // lookups found in cache
+    uint32_t  cacheMisses_;                 // lookups read from device
+    // FAT window, fatCacheCount_ is zero when the window is empty
+    cache_t   fatCache_[SD_FAT_CACHE_BLOCKS];      // window of consecutive FAT blocks
+    uint32_t  fatCacheBlock_;               // first block in window
+    uint8_t   fatCacheCount_;               // number of valid blocks in window
+    uint32_t  fatCacheDirty_;               // bit i set if window block i must be written
+    uint32_t  fatCacheMirror_;              // bit i set if mirror of window block i must be written
+    uint32_t  fatCacheMirrorOffset_;        // offset to mirror FAT, zero if only one FAT
+    uint32_t  fatCacheHits_;                // FAT lookups found in window
+    uint32_t  fatCacheMisses_;              // FAT lookups that reloaded window
+    // first FAT block ranges with deferred mirror writes, sorted by block
+    uint32_t  fatMirrorBegin_[SD_FAT_MIRROR_RANGES + 1];  // first FAT block of deferred range
+    uint32_t  fatMirrorEnd_[SD_FAT_MIRROR_RANGES + 1];    // end FAT block of deferred range
+    uint8_t   fatMirrorCount_;              // number of deferred ranges
+    RP2040_BlockDevice* sdCard_;            // block device for cache
     //
     uint32_t  allocSearchStart_;            // start cluster for alloc search
-    uint8_t   blocksPerCluster_;            // cluster size in blocks
+    uint16_t  blocksPerCluster_;            // cluster size in blocks
     uint32_t  blocksPerFat_;                // FAT size in blocks
     uint32_t  clusterCount_;                // clusters in one FAT
     uint8_t   clusterSizeShift_;            // shift to convert cluster count to block count
     uint32_t  dataStartBlock_;              // first data block number
     uint8_t   fatCount_;                    // number of FATs on volume
     uint32_t  fatStartBlock_;               // start block for first FAT
-    uint8_t   fatType_;                     // volume type (12, 16, OR 32)
+    uint8_t   fatType_;                     // volume type (12, 16, 32 OR 64 for exFAT)
     uint16_t  rootDirEntryCount_;           // number of entries in FAT16 root dir
     uint32_t  rootDirStart_;                // root start block for FAT16, cluster for FAT32
+    uint32_t  freeClusters_;                // free cluster count, 0XFFFFFFFF if unknown
+    uint32_t  fsInfoBlock_;                 // FAT32 FSINFO block, zero if none
+    uint8_t   fsInfoDirty_;                 // FSINFO must be written
+    uint32_t  fsInfoNextFree_;              // next free hint last read from or written to FSINFO
+#if SD_FREE_BITMAP_BYTES
+    uint8_t   freeBitmap_[SD_FREE_BITMAP_BYTES];  // bit set if cluster group has no free cluster
+    uint8_t   freeBitmapShift_;             // shift to convert cluster to group
+    uint8_t   freeBitmapValid_;             // bitmap matches the FAT
+#endif  // SD_FREE_BITMAP_BYTES
+#if SD_EXFAT
+    uint32_t  exBitmapStartBlock_;          // first block of the exFAT allocation bitmap
+    uint32_t  exUpcaseStartBlock_;          // first block of the exFAT up-case table
+    uint32_t  exUpcaseLength_;              // size of the up-case table in bytes
+    uint8_t   exUpcase_[128];               // up-case map for code points below 0X80
+#endif  // SD_EXFAT
+#if SD_DIR_INDEX_ENTRIES
+    dirindex_t dirIndexTable_[SD_DIR_INDEX_ENTRIES];  // named entries of the indexed directory
+    uint32_t  dirIndexKey_;                 // first cluster of indexed directory, 1 for FAT16 root
+    uint16_t  dirIndexCount_;               // number of entries in dirIndexTable_
+    uint32_t  dirIndexFreeBlock_;           // block of first free entry, zero if not known
+    uint8_t   dirIndexFreeIndex_;           // index of first free entry in its block
+    uint8_t   dirIndexFreeTail_;            // entries after the free entry are never used
+#endif  // SD_DIR_INDEX_ENTRIES
     //----------------------------------------------------------------------------
 
-    uint8_t allocContiguous(uint32_t count, uint32_t* curCluster);
+    uint8_t allocContiguous(uint32_t count, uint32_t* curCluster, uint8_t link = true,
+                            uint32_t* allocated = NULL);
 
-    uint8_t blockOfCluster(uint32_t position) const
+    uint16_t blockOfCluster(uint32_t position) const
     {
       return (position >> 9) & (blocksPerCluster_ - 1);
     }
@@ -749,26 +1123,104 @@ class RP2040_SdVolume
       return clusterStartBlock(cluster) + blockOfCluster(position);
     }
 
-    static uint8_t cacheFlush(uint8_t blocking = 1);
-    static uint8_t cacheMirrorBlockFlush(uint8_t blocking);
-    static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
+    // pointer to the entry of the most recent cacheRawBlock()
+    cache_t* cacheAddress()
+    {
+      return &cacheBuffer_[cacheIndex_];
+    }
+
+    // block number of the entry of the most recent cacheRawBlock()
+    uint32_t cacheBlockNumber()
+    {
+      return cacheBlockNumber_[cacheIndex_];
+    }
+
+    int8_t  cacheFind(uint32_t blockNumber);
+    uint8_t cacheFlush(uint8_t blocking = 1);
+    uint8_t cacheFlushEntry(uint8_t i, uint8_t blocking = 1);
+    void    cacheInvalidate(uint32_t firstBlock, uint32_t count = 1);
+    uint8_t cacheMirrorBlockFlush(uint8_t blocking);
+    uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
 
-    static void cacheSetDirty()
+    void cacheSetDirty()
     {
-      cacheDirty_ |= CACHE_FOR_WRITE;
+      cacheDirty_[cacheIndex_] |= CACHE_FOR_WRITE;
     }
 
-    static uint8_t cacheZeroBlock(uint32_t blockNumber);
-    uint8_t chainSize(uint32_t beginCluster, uint32_t* size) const;
-    uint8_t fatGet(uint32_t cluster, uint32_t* value) const;
+    uint8_t cacheZeroBlock(uint32_t blockNumber);
+    uint8_t chainSize(uint32_t beginCluster, uint32_t* size);
+    uint8_t clusterUsed(uint32_t cluster, uint8_t* used);
+#if SD_DIR_INDEX_ENTRIES
+    uint8_t dirIndexAdd(const uint8_t* name, uint32_t block, uint8_t index);
+    void    dirIndexCreate(uint32_t key, const uint8_t* name, uint32_t block, uint8_t index);
+    int8_t  dirIndexFind(uint32_t key, const uint8_t* name, uint8_t* index);
+
+    void dirIndexForget(uint32_t key)
+    {
+      if (dirIndexKey_ == key)
+      {
+        dirIndexKey_ = 0;
+      }
+    }
+
+    uint8_t dirIndexFree(uint32_t* block, uint8_t* index);
+    void    dirIndexRemove(uint32_t block, uint8_t index);
+    void    dirIndexSet(uint32_t key, uint32_t freeBlock, uint8_t freeIndex, uint8_t freeTail);
+
+    void dirIndexStart()
+    {
+      dirIndexKey_ = 0;
+      dirIndexCount_ = 0;
+    }
+#endif  // SD_DIR_INDEX_ENTRIES
+#if SD_EXFAT
+    uint8_t  exFatBitmapGet(uint32_t cluster, uint8_t* used);
+    uint8_t  exFatBitmapPut(uint32_t cluster, uint32_t count, uint8_t used);
+    int32_t  exFatFreeClusterCount();
+    uint8_t  exFatFreeChain(uint32_t cluster);
+    uint8_t  exFatInit(uint32_t volumeStartBlock);
+    uint16_t exFatUpcase(uint16_t c);
+    uint8_t  exFatUpcaseLookup(uint16_t c, uint16_t* u);
+#endif  // SD_EXFAT
+    cache_t* fatCacheBlock(uint32_t lba, uint8_t action);
+    uint8_t fatCacheFlush(uint8_t blocking = 1);
+    void    fatCacheInvalidate();
+    void    fatMirrorAdd(uint32_t lba);
+    uint8_t fatMirrorFlush();
+    uint8_t fatGet(uint32_t cluster, uint32_t* value);
     uint8_t fatPut(uint32_t cluster, uint32_t value);
 
     uint8_t fatPutEOC(uint32_t cluster)
     {
-      return fatPut(cluster, 0x0FFFFFFF);
+      return fatPut(cluster, fatType_ == 64 ? EXFAT_EOC : 0x0FFFFFFF);
     }
 
     uint8_t freeChain(uint32_t cluster);
+    uint8_t fsInfoSync();
+
+#if SD_FREE_BITMAP_BYTES
+    uint8_t freeBitmapBuild();
+
+    uint8_t freeBitmapFull(uint32_t cluster) const
+    {
+      cluster >>= freeBitmapShift_;
+      return freeBitmap_[cluster >> 3] & (1 << (cluster & 7));
+    }
+
+    void freeBitmapSet(uint32_t cluster, uint8_t full)
+    {
+      cluster >>= freeBitmapShift_;
+
+      if (full)
+      {
+        freeBitmap_[cluster >> 3] |= 1 << (cluster & 7);
+      }
+      else
+      {
+        freeBitmap_[cluster >> 3] &= ~(1 << (cluster & 7));
+      }
+    }
+#endif  // SD_FREE_BITMAP_BYTES
 
     uint8_t isEOC(uint32_t cluster) const
     {
@@ -785,11 +1237,41 @@ class RP2040_SdVolume
       return sdCard_->readData(block, offset, count, dst);
     }
 
+    uint8_t readStart(uint32_t block)
+    {
+      return sdCard_->readStart(block);
+    }
+
+    uint8_t readData(uint8_t* dst)
+    {
+      return sdCard_->readData(dst);
+    }
+
+    uint8_t readStop()
+    {
+      return sdCard_->readStop();
+    }
+
     uint8_t writeBlock(uint32_t block, const uint8_t* dst, uint8_t blocking = 1)
     {
       return sdCard_->writeBlock(block, dst, blocking);
     }
 
+    uint8_t writeStart(uint32_t block, uint32_t eraseCount)
+    {
+      return sdCard_->writeStart(block, eraseCount);
+    }
+
+    uint8_t writeData(const uint8_t* src)
+    {
+      return sdCard_->writeData(src);
+    }
+
+    uint8_t writeStop()
+    {
+      return sdCard_->writeStop();
+    }
+
     uint8_t isBusy()
     {
       return sdCard_->isBusy();
@@ -797,7 +1279,7 @@ class RP2040_SdVolume
 
     uint8_t isCacheMirrorBlockDirty()
     {
-      return (cacheMirrorBlock_ != 0);
+      return (fatCacheMirror_ != 0);
     }
 };
 #endif  // SdFat_h
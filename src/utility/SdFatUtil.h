@@ -49,15 +49,15 @@ static UNUSEDOK int FreeRam()
   extern int* __brkval;
   int free_memory;
 
-  if (reinterpret_cast<int>(__brkval) == 0)
+  if (__brkval == 0)
   {
     // if no heap use from end of bss section
-    free_memory = reinterpret_cast<int>(&free_memory) - reinterpret_cast<int>(&__bss_end);
+    free_memory = (int)(reinterpret_cast<intptr_t>(&free_memory) - reinterpret_cast<intptr_t>(&__bss_end));
   }
   else
   {
     // use from top of stack to heap
-    free_memory = reinterpret_cast<int>(&free_memory) - reinterpret_cast<int>(__brkval);
+    free_memory = (int)(reinterpret_cast<intptr_t>(&free_memory) - reinterpret_cast<intptr_t>(__brkval));
   }
 
   return free_memory;
@@ -34,6 +34,10 @@
 #include "SdFat.h"
 #include <Arduino.h>
 
+// the only definitions of the option symbols, see SD_CONFIG_CHECK
+SD_CONFIG_DEFINE(FileExtents, SD_FILE_EXTENTS);
+SD_CONFIG_DEFINE(ExFat, SD_EXFAT);
+
 //------------------------------------------------------------------------------
 // callback function for date/time
 void (*RP2040_SdFile::dateTime_)(uint16_t* date, uint16_t* time) = NULL;
@@ -44,19 +48,39 @@ void (*RP2040_SdFile::dateTime_)(uint16_t* date, uint16_t* time) = NULL;
 #endif  // ALLOW_DEPRECATED_FUNCTIONS
 
 //------------------------------------------------------------------------------
-// add a cluster to a file
-uint8_t RP2040_SdFile::addCluster()
+// add up to count clusters to a file with one search of the FAT, curCluster_
+// is set to the first cluster added
+uint8_t RP2040_SdFile::addCluster(uint32_t count)
 {
-  if (!vol_->allocContiguous(1, &curCluster_))
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    return exFatAddCluster(count);
+  }
+
+#endif  // SD_EXFAT
+
+  if (!vol_->allocContiguous(count, &curCluster_, true, &count))
   {
     return false;
   }
 
+  // clusters past the one needed now are released by close()
+  if (count > 1)
+  {
+    allocTail_ = true;
+  }
+
   // if first cluster of file link to directory entry
   if (firstCluster_ == 0)
   {
     firstCluster_ = curCluster_;
     flags_ |= F_FILE_DIR_DIRTY;
+
+#if SD_FILE_EXTENTS
+    extentReset();
+#endif
   }
 
   flags_ |= F_FILE_CLUSTER_ADDED;
@@ -77,9 +101,9 @@ uint8_t RP2040_SdFile::addDirCluster()
   // zero data in cluster insure first cluster is in cache
   uint32_t block = vol_->clusterStartBlock(curCluster_);
 
-  for (uint8_t i = vol_->blocksPerCluster_; i != 0; i--)
+  for (uint16_t i = vol_->blocksPerCluster_; i != 0; i--)
   {
-    if (!RP2040_SdVolume::cacheZeroBlock(block + i - 1))
+    if (!vol_->cacheZeroBlock(block + i - 1))
     {
       return false;
     }
@@ -88,6 +112,16 @@ uint8_t RP2040_SdFile::addDirCluster()
   // Increase directory file size by cluster size
   fileSize_ += 512UL << vol_->clusterSizeShift_;
 
+#if SD_EXFAT
+
+  // exFAT subdirectories have their size in the entry set
+  if (vol_->fatType() == 64 && !isRoot())
+  {
+    flags_ |= F_FILE_DIR_DIRTY;
+  }
+
+#endif  // SD_EXFAT
+
   return true;
 }
 
@@ -96,12 +130,12 @@ uint8_t RP2040_SdFile::addDirCluster()
 // return pointer to cached entry or null for failure
 dir_t* RP2040_SdFile::cacheDirEntry(uint8_t action)
 {
-  if (!RP2040_SdVolume::cacheRawBlock(dirBlock_, action))
+  if (!vol_->cacheRawBlock(dirBlock_, action))
   {
     return NULL;
   }
 
-  return RP2040_SdVolume::cacheBuffer_.dir + dirIndex_;
+  return vol_->cacheAddress()->dir + dirIndex_;
 }
 
 //------------------------------------------------------------------------------
@@ -115,6 +149,12 @@ dir_t* RP2040_SdFile::cacheDirEntry(uint8_t action)
 */
 uint8_t RP2040_SdFile::close()
 {
+  // release the unused part of an allocation batch, not a reservation
+  if (allocTail_ && !truncate(fileSize_))
+  {
+    return false;
+  }
+
   if (!sync())
   {
     return false;
@@ -145,6 +185,18 @@ uint8_t RP2040_SdFile::contiguousRange(uint32_t* bgnBlock, uint32_t* endBlock)
     return false;
   }
 
+#if SD_EXFAT
+
+  if (exFlags_ & EXFAT_FLAG_NO_FAT_CHAIN)
+  {
+    *bgnBlock = vol_->clusterStartBlock(firstCluster_);
+    *endBlock = vol_->clusterStartBlock(firstCluster_ + exClusters_) - 1;
+
+    return true;
+  }
+
+#endif  // SD_EXFAT
+
   for (uint32_t c = firstCluster_; ; c++)
   {
     uint32_t next;
@@ -206,15 +258,31 @@ uint8_t RP2040_SdFile::createContiguous(RP2040_SdFile* dirFile, const char* file
   // calculate number of clusters needed
   uint32_t count = ((size - 1) >> (vol_->clusterSizeShift_ + 9)) + 1;
 
-  // allocate clusters
-  if (!vol_->allocContiguous(count, &firstCluster_))
+  // allocate clusters, an exFAT file needs no FAT chain
+  if (!vol_->allocContiguous(count, &firstCluster_, vol_->fatType() != 64))
   {
     remove();
     return false;
   }
 
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    exFlags_ |= EXFAT_FLAG_ALLOCATION_POSSIBLE | EXFAT_FLAG_NO_FAT_CHAIN;
+    exClusters_ = count;
+  }
+
+#endif  // SD_EXFAT
+
   fileSize_ = size;
 
+#if SD_FILE_EXTENTS
+  // the whole file is one known run
+  extentReset();
+  extent_[0].count = count;
+#endif
+
   // insure sync() will update dir entry
   flags_ |= F_FILE_DIR_DIRTY;
 
@@ -238,6 +306,15 @@ uint8_t RP2040_SdFile::dirEntry(dir_t* dir)
     return false;
   }
 
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    return !isRoot() && exFatDirEntry(dir);
+  }
+
+#endif  // SD_EXFAT
+
   // read entry
   dir_t* p = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_READ);
 
@@ -280,240 +357,1210 @@ void RP2040_SdFile::dirName(const dir_t& dir, char* name)
 
   name[j] = 0;
 }
-
+#if SD_EXFAT
 //------------------------------------------------------------------------------
-/** List directory contents to DEBUG PORT.
-
-   \param[in] flags The inclusive OR of
-
-   LS_DATE - %Print file modification date
-
-   LS_SIZE - %Print file size.
-
-   LS_R - Recursive list of subdirectories.
-
-   \param[in] indent Amount of space before file name. Used for recursive
-   list to indicate subdirectory level.
-*/
-void RP2040_SdFile::ls(uint8_t flags, uint8_t indent)
+// one step of the exFAT name hash and entry set checksum
+static uint16_t exFatHashByte(uint16_t hash, uint8_t b)
 {
-  dir_t* p;
-
-  rewind();
+  return ((hash & 1) ? 0X8000 : 0) + (hash >> 1) + b;
+}
+//------------------------------------------------------------------------------
+// convert a UTF-8 file name to UTF-16, return the length or zero if the
+// name is not a valid exFAT name
+static uint8_t exFatNameFromUtf8(const char* str, uint16_t* name)
+{
+  uint16_t n = 0;
 
-  while ((p = readDirCache()))
+  while (*str)
   {
-    // done if past last used entry
-    if (p->name[0] == DIR_NAME_FREE)
+    uint32_t c = (uint8_t) * str++;
+    uint8_t more;
+
+    if (c < 0X80)
     {
-      break;
+      more = 0;
     }
-
-    // skip deleted entry and entries for . and  ..
-    if (p->name[0] == DIR_NAME_DELETED || p->name[0] == '.')
+    else if (c >= 0XF0)
     {
-      continue;
+      c &= 0X07;
+      more = 3;
     }
-
-    // only list subdirectories and files
-    if (!DIR_IS_FILE_OR_SUBDIR(p))
+    else if (c >= 0XE0)
     {
-      continue;
+      c &= 0X0F;
+      more = 2;
     }
-
-    // print any indent spaces
-    for (int8_t i = 0; i < indent; i++)
+    else if (c >= 0XC0)
     {
-      RP2040_SD_PRINT_SP;
+      c &= 0X1F;
+      more = 1;
     }
-
-    // print file name with possible blank fill
-    printDirName(*p, flags & (LS_DATE | LS_SIZE) ? 14 : 0);
-
-    // print modify date/time if requested
-    if (flags & LS_DATE)
+    else
     {
-      printFatDate(p->lastWriteDate);
-      RP2040_SD_PRINT_SP;
-      printFatTime(p->lastWriteTime);
+      return 0;
     }
 
-    // print size if requested
-    if (!DIR_IS_SUBDIR(p) && (flags & LS_SIZE))
+    while (more--)
     {
-      RP2040_SD_LOG1(' ', p->fileSize);
+      uint8_t b = *str++;
+
+      // also stops at the terminating zero
+      if ((b & 0XC0) != 0X80)
+      {
+        return 0;
+      }
+
+      c = (c << 6) | (b & 0X3F);
     }
 
-    RP2040_SD_PRINTLN();
+    // control characters and characters exFAT does not allow in names
+    if (c < 0X20 || (c < 0X80 && strchr("\"*/:<>?\\|", c)))
+    {
+      return 0;
+    }
 
-    // list subdirectory content if requested
-    if ((flags & LS_R) && DIR_IS_SUBDIR(p))
+    if (c > 0XFFFF)
     {
-      uint16_t index = curPosition() / 32 - 1;
-      RP2040_SdFile s;
+      // surrogate pair
+      if (c > 0X10FFFF || (n + 2) > EXFAT_NAME_MAX)
+      {
+        return 0;
+      }
 
-      if (s.open(this, index, O_READ))
+      c -= 0X10000;
+      name[n++] = 0XD800 | (c >> 10);
+      name[n++] = 0XDC00 | (c & 0X3FF);
+    }
+    else
+    {
+      if (n >= EXFAT_NAME_MAX)
       {
-        s.ls(flags, indent + 2);
+        return 0;
       }
 
-      seekSet(32 * (index + 1));
+      name[n++] = c;
     }
   }
-}
 
+  // "." and ".." are not file names
+  if (n == 0 || (name[0] == '.' && (n == 1 || (n == 2 && name[1] == '.'))))
+  {
+    return 0;
+  }
+
+  return n;
+}
 //------------------------------------------------------------------------------
-// format directory name field from a 8.3 name string
-uint8_t RP2040_SdFile::make83Name(const char* str, uint8_t* name)
+// exFAT name hash of the up-cased UTF-16 name
+uint16_t RP2040_SdFile::exFatNameHash(RP2040_SdVolume* vol, const uint16_t* name, uint8_t length)
 {
-  uint8_t c;
-  uint8_t n = 7;  // max index for part before dot
-  uint8_t i = 0;
+  uint16_t hash = 0;
 
-  // blank fill name and extension
-  while (i < 11)
+  for (uint8_t i = 0; i < length; i++)
   {
-    name[i++] = ' ';
+    uint16_t c = vol->exFatUpcase(name[i]);
+    hash = exFatHashByte(hash, c & 0XFF);
+    hash = exFatHashByte(hash, c >> 8);
   }
 
-  i = 0;
+  return hash;
+}
+//------------------------------------------------------------------------------
+// add up to count clusters to an exFAT file, the file is NoFatChain while its
+// clusters are contiguous and is given a FAT chain when a new run is not
+// adjacent
+uint8_t RP2040_SdFile::exFatAddCluster(uint32_t count)
+{
+  if (firstCluster_ == 0)
+  {
+    // new files start contiguous
+    exFlags_ |= EXFAT_FLAG_ALLOCATION_POSSIBLE | EXFAT_FLAG_NO_FAT_CHAIN;
+    exClusters_ = 0;
+  }
 
-  while ((c = *str++) != '\0')
+  if (exFlags_ & EXFAT_FLAG_NO_FAT_CHAIN)
   {
-    if (c == '.')
-    {
-      if (n == 10)
-      {
-        return false;  // only one dot allowed
-      }
+    // try for the cluster after the run, only the bitmap is changed
+    uint32_t last = exClusters_ ? firstCluster_ + exClusters_ - 1 : 0;
+    uint32_t cluster = last;
 
-      n = 10;  // max index for full 8.3 name
-      i = 8;   // place for extension
+    if (!vol_->allocContiguous(count, &cluster, false, &count))
+    {
+      return false;
     }
-    else
+
+    if (last && cluster != (last + 1))
     {
-      // illegal FAT characters
-      uint8_t b;
+      // write a FAT chain for the old and new runs and link them
+      for (uint32_t c = firstCluster_; c < last; c++)
+      {
+        if (!vol_->fatPut(c, c + 1))
+        {
+          return false;
+        }
+      }
 
-      const uint8_t valid[] = "|<>^+=?/[];,*\"\\";
-      const uint8_t *p = valid;
+      if (!vol_->fatPut(last, cluster))
+      {
+        return false;
+      }
 
-      while ((b = *p++))
+      for (uint32_t c = cluster; c < (cluster + count - 1); c++)
       {
-        if (b == c)
+        if (!vol_->fatPut(c, c + 1))
         {
           return false;
         }
       }
 
-      // check size and only allow ASCII printable characters
-      if (i > n || c < 0X21 || c > 0X7E)
+      if (!vol_->fatPutEOC(cluster + count - 1))
       {
         return false;
       }
 
-      // only upper case allowed in 8.3 names - convert lower to upper
-      name[i++] = c < 'a' || c > 'z' ?  c : c + ('A' - 'a');
+      exFlags_ &= ~EXFAT_FLAG_NO_FAT_CHAIN;
+      flags_ |= F_FILE_DIR_DIRTY;
+    }
+    else
+    {
+      exClusters_ += count;
     }
+
+    curCluster_ = cluster;
+  }
+  else if (!vol_->allocContiguous(count, &curCluster_, true, &count))
+  {
+    return false;
   }
 
-  // must have a file name, extension is optional
-  return name[0] != ' ';
-}
+  // clusters past the one needed now are released by close()
+  if (count > 1)
+  {
+    allocTail_ = true;
+  }
 
-//------------------------------------------------------------------------------
-/** Make a new directory.
+  // if first cluster of file link to directory entry
+  if (firstCluster_ == 0)
+  {
+    firstCluster_ = curCluster_;
+    flags_ |= F_FILE_DIR_DIRTY;
 
-   \param[in] dir An open SdFat instance for the directory that will containing
-   the new directory.
+#if SD_FILE_EXTENTS
+    extentReset();
+#endif
+  }
 
-   \param[in] dirName A valid 8.3 DOS name for the new directory.
+  flags_ |= F_FILE_CLUSTER_ADDED;
 
-   \return The value one, true, is returned for success and
-   the value zero, false, is returned for failure.
-   Reasons for failure include this RP2040_SdFile is already open, \a dir is not a
-   directory, \a dirName is invalid or already exists in \a dir.
-*/
-uint8_t RP2040_SdFile::makeDir(RP2040_SdFile* dir, const char* dirName)
+  return true;
+}
+//------------------------------------------------------------------------------
+// cache entry i of this file's exFAT entry set, the file entry is entry zero
+// return pointer to cached entry or null for failure.  A set of up to 19
+// entries that starts late in a block ends in the second block after it
+exdir_t* RP2040_SdFile::exFatCacheEntry(uint8_t i, uint8_t action)
 {
-  dir_t d;
+  i += dirIndex_;
 
-  // create a normal file
-  if (!open(dir, dirName, O_CREAT | O_EXCL | O_RDWR))
+  if (!vol_->cacheRawBlock(i < 16 ? dirBlock_ : i < 32 ? dirBlock2_ : dirBlock3_, action))
   {
-    return false;
+    return NULL;
   }
 
-  // convert RP2040_SdFile to directory
-  flags_ = O_READ;
-  type_ = FAT_FILE_TYPE_SUBDIR;
+  return vol_->cacheAddress()->exdir + (i & 0XF);
+}
+//------------------------------------------------------------------------------
+// fill a FAT directory entry from this file's exFAT entry set, the name is
+// the long name cut to 8.3 form with case kept
+uint8_t RP2040_SdFile::exFatDirEntry(dir_t* dir)
+{
+  exdir_t* p = exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_READ);
 
-  // allocate and zero first cluster
-  if (!addDirCluster())
+  if (!p)
   {
     return false;
   }
 
-  // force entry to SD
-  if (!sync())
-  {
-    return false;
-  }
+  memset(dir, 0, sizeof(dir_t));
 
-  // cache entry - should already be in cache due to sync() call
-  dir_t* p = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_WRITE);
+  dir->attributes = p->file.attributes & DIR_ATT_DEFINED_BITS;
+  dir->creationTimeTenths = p->file.create10ms;
+  dir->creationTime = p->file.createTimestamp;
+  dir->creationDate = p->file.createTimestamp >> 16;
+  dir->lastWriteTime = p->file.modifyTimestamp;
+  dir->lastWriteDate = p->file.modifyTimestamp >> 16;
+  dir->lastAccessDate = p->file.accessTimestamp >> 16;
+
+  p = exFatCacheEntry(1, RP2040_SdVolume::CACHE_FOR_READ);
 
   if (!p)
   {
     return false;
   }
 
-  // change directory entry  attribute
-  p->attributes = DIR_ATT_DIRECTORY;
+  dir->firstClusterLow = p->stream.firstCluster & 0XFFFF;
+  dir->firstClusterHigh = p->stream.firstCluster >> 16;
+  dir->fileSize = p->stream.validDataLength > 0XFFFFFFFF ? 0XFFFFFFFF : p->stream.validDataLength;
 
-  // make entry for '.'
-  memcpy(&d, p, sizeof(d));
+  uint8_t length = p->stream.nameLength;
+  uint8_t dot = length;
 
-  for (uint8_t i = 1; i < 11; i++)
+  memset(dir->name, ' ', 11);
+
+  // two passes over the name, the extension follows the last dot
+  for (uint8_t pass = 0; pass < 2; pass++)
   {
-    d.name[i] = ' ';
-  }
+    uint8_t j = 0;
 
-  d.name[0] = '.';
+    for (uint8_t k = 0; k < length; k++)
+    {
+      p = exFatCacheEntry(2 + k / EXFAT_NAME_CHARS, RP2040_SdVolume::CACHE_FOR_READ);
 
-  // cache block for '.'  and '..'
-  uint32_t block = vol_->clusterStartBlock(firstCluster_);
+      if (!p)
+      {
+        return false;
+      }
 
-  if (!RP2040_SdVolume::cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_WRITE))
-  {
-    return false;
-  }
+      uint16_t c = p->name.name[k % EXFAT_NAME_CHARS];
 
-  // copy '.' to block
-  memcpy(&RP2040_SdVolume::cacheBuffer_.dir[0], &d, sizeof(d));
+      if (pass == 0)
+      {
+        // a leading dot does not start an extension
+        if (c == '.' && k)
+        {
+          dot = k;
+        }
 
-  // make entry for '..'
-  d.name[1] = '.';
+        continue;
+      }
 
-  if (dir->isRoot())
-  {
-    d.firstClusterLow = 0;
-    d.firstClusterHigh = 0;
+      if (k == dot)
+      {
+        j = 8;
+        continue;
+      }
+
+      if (c == ' ' || c == '.' || (k < dot ? j >= 8 : j >= 11))
+      {
+        continue;
+      }
+
+      // characters not allowed in 8.3 names
+      if (c < 0X21 || c > 0X7E || strchr("|<>^+=?/[];,*\"\\", c))
+      {
+        c = '_';
+      }
+
+      dir->name[j++] = c;
+    }
   }
-  else
+
+  if (dir->name[0] == ' ')
   {
-    d.firstClusterLow = dir->firstCluster_ & 0XFFFF;
-    d.firstClusterHigh = dir->firstCluster_ >> 16;
+    dir->name[0] = '_';
   }
 
-  // copy '..' to block
-  memcpy(&RP2040_SdVolume::cacheBuffer_.dir[1], &d, sizeof(d));
-
-  // set position after '..'
+  return true;
+}
+//------------------------------------------------------------------------------
+// open or create an exFAT file by name
+uint8_t RP2040_SdFile::exFatOpen(RP2040_SdFile* dirFile, const char* fileName, uint8_t oflag)
+{
+  uint16_t name[EXFAT_NAME_MAX];
+  uint8_t length = exFatNameFromUtf8(fileName, name);
+
+  if (length == 0)
+  {
+    return false;
+  }
+
+  vol_ = dirFile->vol_;
+  uint16_t hash = exFatNameHash(vol_, name, length);
+
+  // file, stream extension and name entries
+  uint8_t need = 2 + (length + EXFAT_NAME_CHARS - 1) / EXFAT_NAME_CHARS;
+  uint8_t create = (oflag & (O_CREAT | O_WRITE)) == (O_CREAT | O_WRITE);
+
+  // first run of free entries long enough for a new set
+  uint8_t freeCount = 0;
+  uint8_t freeIndex = 0;
+  uint32_t freeBlock = 0;
+  uint32_t freeBlock2 = 0;
+  uint32_t freeBlock3 = 0;
+
+  dirFile->rewind();
+
+  while (true)
+  {
+    if (dirFile->curPosition_ >= dirFile->fileSize_)
+    {
+      if (!create)
+      {
+        return false;
+      }
+
+      if (freeCount >= need)
+      {
+        break;
+      }
+
+      // add a zero cluster and continue the free run into it, read()
+      // follows the chain from the cluster before the new one
+      uint32_t last = dirFile->curCluster_;
+
+      if (!dirFile->addDirCluster() || !dirFile->sync())
+      {
+        return false;
+      }
+
+      dirFile->curCluster_ = last;
+
+      continue;
+    }
+
+    uint8_t index = 0XF & (dirFile->curPosition_ >> 5);
+    exdir_t* p = reinterpret_cast<exdir_t*>(dirFile->readDirCache());
+
+    if (p == NULL)
+    {
+      return false;
+    }
+
+    if (!(p->type & EXFAT_TYPE_IN_USE))
+    {
+      if (freeCount == 0)
+      {
+        freeIndex = index;
+        freeBlock = vol_->cacheBlockNumber();
+        freeBlock2 = 0;
+        freeBlock3 = 0;
+      }
+      else if (freeCount < need && vol_->cacheBlockNumber() != freeBlock)
+      {
+        if (freeBlock2 == 0)
+        {
+          freeBlock2 = vol_->cacheBlockNumber();
+        }
+        else if (vol_->cacheBlockNumber() != freeBlock2)
+        {
+          freeBlock3 = vol_->cacheBlockNumber();
+        }
+      }
+
+      if (freeCount < need)
+      {
+        freeCount++;
+      }
+
+      // no entries follow end of directory
+      if (p->type == EXFAT_TYPE_END_OF_DIR && (!create || freeCount >= need))
+      {
+        if (!create)
+        {
+          return false;
+        }
+
+        break;
+      }
+
+      continue;
+    }
+
+    if (freeCount < need)
+    {
+      freeCount = 0;
+    }
+
+    if (p->type == EXFAT_TYPE_FILE)
+    {
+      int8_t rtn = exFatOpenSet(dirFile, name, length, hash, oflag);
+
+      if (rtn)
+      {
+        return rtn > 0;
+      }
+    }
+  }
+
+  // write the new entry set
+  dirIndex_ = freeIndex;
+  dirBlock_ = freeBlock;
+  dirBlock2_ = freeBlock2;
+  dirBlock3_ = freeBlock3;
+
+  uint16_t date;
+  uint16_t time;
+
+  if (dateTime_)
+  {
+    // call user function
+    dateTime_(&date, &time);
+  }
+  else
+  {
+    // use default date/time
+    date = FAT_DEFAULT_DATE;
+    time = FAT_DEFAULT_TIME;
+  }
+
+  for (uint8_t i = 0; i < need; i++)
+  {
+    exdir_t* p = exFatCacheEntry(i, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+    if (!p)
+    {
+      return false;
+    }
+
+    memset(p, 0, sizeof(exdir_t));
+
+    if (i == 0)
+    {
+      p->file.type = EXFAT_TYPE_FILE;
+      p->file.secondaryCount = need - 1;
+      p->file.attributes = DIR_ATT_ARCHIVE;
+      p->file.createTimestamp = (uint32_t)date << 16 | time;
+      p->file.modifyTimestamp = p->file.createTimestamp;
+      p->file.accessTimestamp = p->file.createTimestamp;
+    }
+    else if (i == 1)
+    {
+      p->stream.type = EXFAT_TYPE_STREAM;
+      p->stream.flags = EXFAT_FLAG_ALLOCATION_POSSIBLE;
+      p->stream.nameLength = length;
+      p->stream.nameHash = hash;
+    }
+    else
+    {
+      p->name.type = EXFAT_TYPE_NAME;
+
+      for (uint8_t j = 0, k = EXFAT_NAME_CHARS * (i - 2); j < EXFAT_NAME_CHARS && k < length; j++, k++)
+      {
+        p->name.name[j] = name[k];
+      }
+    }
+  }
+
+  // open the new empty file
+  type_ = FAT_FILE_TYPE_NORMAL;
+  flags_ = oflag & (O_ACCMODE | O_SYNC | O_APPEND);
+  firstCluster_ = 0;
+  fileSize_ = 0;
+  curCluster_ = 0;
+  curPosition_ = 0;
+  allocTail_ = false;
+  atPosition_ = 0;
+  exFlags_ = EXFAT_FLAG_ALLOCATION_POSSIBLE;
+  exClusters_ = 0;
+
+#if SD_FILE_EXTENTS
+  extentReset();
+#endif
+
+  // set the checksum and force write of the set to SD
+  if (!exFatSync())
+  {
+    return false;
+  }
+
+  return vol_->cacheFlush();
+}
+//------------------------------------------------------------------------------
+// read the rest of the entry set whose file entry was just read from dirFile
+// and open it if the name matches or name is null
+// return one if opened, zero if not a match and -1 for an error or if the
+// file can not be opened with oflag
+int8_t RP2040_SdFile::exFatOpenSet(RP2040_SdFile* dirFile, const uint16_t* name, uint8_t length,
+                                   uint16_t hash, uint8_t oflag)
+{
+  RP2040_SdVolume* vol = dirFile->vol_;
+  uint32_t block = vol->cacheBlockNumber();
+  uint8_t index = ((dirFile->curPosition_ >> 5) - 1) & 0XF;
+  exfile_t* f = &vol->cacheAddress()->exdir[index].file;
+
+  uint8_t count = f->secondaryCount;
+  uint16_t attributes = f->attributes;
+  uint32_t block2 = 0;
+  uint32_t block3 = 0;
+  uint8_t flags = 0;
+  uint32_t firstCluster = 0;
+  uint64_t validLength = 0;
+  uint64_t dataLength = 0;
+  uint8_t match = true;
+
+  // a stream extension and one to seventeen name entries
+  if (count < 2 || count > 18)
+  {
+    return 0;
+  }
+
+  for (uint8_t i = 1; i <= count; i++)
+  {
+    exdir_t* p = reinterpret_cast<exdir_t*>(dirFile->readDirCache());
+
+    if (p == NULL)
+    {
+      return -1;
+    }
+
+    if (vol->cacheBlockNumber() != block)
+    {
+      if (block2 == 0)
+      {
+        block2 = vol->cacheBlockNumber();
+      }
+      else if (vol->cacheBlockNumber() != block2)
+      {
+        block3 = vol->cacheBlockNumber();
+      }
+    }
+
+    // a free or primary entry ends a damaged set, read it again as the
+    // start of the next set
+    if ((p->type & 0XC0) != 0XC0)
+    {
+      return dirFile->seekSet(dirFile->curPosition_ - 32) ? 0 : -1;
+    }
+
+    if (i == 1)
+    {
+      if (p->type != EXFAT_TYPE_STREAM)
+      {
+        match = false;
+        continue;
+      }
+
+      flags = p->stream.flags;
+      firstCluster = p->stream.firstCluster;
+      validLength = p->stream.validDataLength;
+      dataLength = p->stream.dataLength;
+
+      if (name && (p->stream.nameLength != length || p->stream.nameHash != hash))
+      {
+        match = false;
+      }
+    }
+    else if (name && match)
+    {
+      uint8_t k = EXFAT_NAME_CHARS * (i - 2);
+
+      if (p->type != EXFAT_TYPE_NAME)
+      {
+        // vendor entries may follow the name
+        match = k >= length;
+        continue;
+      }
+
+      // copy before up-case lookups reuse the cache
+      uint16_t chars[EXFAT_NAME_CHARS];
+      memcpy(chars, p->name.name, sizeof(chars));
+
+      // names are not case sensitive
+      for (uint8_t j = 0; j < EXFAT_NAME_CHARS && k < length; j++, k++)
+      {
+        if (vol->exFatUpcase(chars[j]) != vol->exFatUpcase(name[k]))
+        {
+          match = false;
+          break;
+        }
+      }
+    }
+  }
+
+  if (!match)
+  {
+    return 0;
+  }
+
+  // don't open existing file if O_CREAT and O_EXCL
+  if (name && (oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+  {
+    return -1;
+  }
+
+  // write or truncate is an error for a directory or read-only file
+  if ((attributes & (DIR_ATT_READ_ONLY | DIR_ATT_DIRECTORY)) && (oflag & (O_WRITE | O_TRUNC)))
+  {
+    return -1;
+  }
+
+  // size must fit fileSize_ and data past ValidDataLength may only be read,
+  // no access mode is used to look at the entry only
+  if ((oflag & O_ACCMODE) && (dataLength > 0XFFFFFFFF || (validLength != dataLength && (oflag & (O_WRITE | O_TRUNC)))))
+  {
+    return -1;
+  }
+
+  vol_ = vol;
+  dirIndex_ = index;
+  dirBlock_ = block;
+  dirBlock2_ = block2;
+  dirBlock3_ = block3;
+  exFlags_ = flags;
+  firstCluster_ = flags & EXFAT_FLAG_ALLOCATION_POSSIBLE ? firstCluster : 0;
+  exClusters_ = 0;
+
+  // a NoFatChain file has all clusters needed for DataLength
+  if ((flags & EXFAT_FLAG_NO_FAT_CHAIN) && firstCluster_)
+  {
+    exClusters_ = (dataLength + (512UL << vol_->clusterSizeShift_) - 1) >> (vol_->clusterSizeShift_ + 9);
+  }
+
+  if (attributes & DIR_ATT_DIRECTORY)
+  {
+    fileSize_ = dataLength > 0XFFFFFFFF ? 0XFFFFFFFF : dataLength;
+    type_ = FAT_FILE_TYPE_SUBDIR;
+  }
+  else
+  {
+    fileSize_ = validLength > 0XFFFFFFFF ? 0XFFFFFFFF : validLength;
+    type_ = FAT_FILE_TYPE_NORMAL;
+  }
+
+  // save open flags for read/write
+  flags_ = oflag & (O_ACCMODE | O_SYNC | O_APPEND);
+
+  // set to start of file
+  curCluster_ = 0;
+  curPosition_ = 0;
+  allocTail_ = false;
+  atPosition_ = 0;
+
+#if SD_FILE_EXTENTS
+  extentReset();
+#endif
+
+  // truncate file to zero length if requested
+  if (oflag & O_TRUNC)
+  {
+    return truncate(0) ? 1 : -1;
+  }
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+// read the next exFAT entry set of this directory as a FAT directory entry,
+// index is set to the directory index of the set's file entry
+int8_t RP2040_SdFile::exFatReadDir(dir_t* dir, uint16_t* index)
+{
+  while (curPosition_ < fileSize_)
+  {
+    uint16_t i = curPosition_ >> 5;
+    exdir_t* p = reinterpret_cast<exdir_t*>(readDirCache());
+
+    if (p == NULL)
+    {
+      return -1;
+    }
+
+    // last entry if end of directory
+    if (p->type == EXFAT_TYPE_END_OF_DIR)
+    {
+      break;
+    }
+
+    if (p->type != EXFAT_TYPE_FILE)
+    {
+      continue;
+    }
+
+    RP2040_SdFile f;
+    int8_t rtn = f.exFatOpenSet(this, NULL, 0, 0, 0);
+
+    if (rtn < 0)
+    {
+      return -1;
+    }
+
+    // skip damaged set
+    if (rtn == 0)
+    {
+      continue;
+    }
+
+    *index = i;
+
+    return f.exFatDirEntry(dir) ? sizeof(dir_t) : -1;
+  }
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// write size, first cluster and flags to this file's exFAT entry set and
+// update the set checksum
+uint8_t RP2040_SdFile::exFatSync()
+{
+  // root has no entry set
+  if (isRoot())
+  {
+    return true;
+  }
+
+  exdir_t* p = exFatCacheEntry(1, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+  if (!p || p->type != EXFAT_TYPE_STREAM)
+  {
+    return false;
+  }
+
+  p->stream.flags = exFlags_;
+  p->stream.firstCluster = firstCluster_;
+  p->stream.validDataLength = fileSize_;
+  p->stream.dataLength = fileSize_;
+
+  p = exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+  if (!p)
+  {
+    return false;
+  }
+
+  // set modify time if user supplied a callback date/time function
+  if (dateTime_)
+  {
+    uint16_t date;
+    uint16_t time;
+
+    dateTime_(&date, &time);
+
+    p->file.modifyTimestamp = (uint32_t)date << 16 | time;
+    p->file.modify10ms = 0;
+    p->file.accessTimestamp = p->file.modifyTimestamp;
+  }
+
+  uint8_t count = p->file.secondaryCount;
+  uint16_t sum = 0;
+
+  // checksum of all entries in the set except the checksum field
+  for (uint8_t i = 0; i <= count; i++)
+  {
+    p = exFatCacheEntry(i, RP2040_SdVolume::CACHE_FOR_READ);
+
+    if (!p)
+    {
+      return false;
+    }
+
+    uint8_t* b = reinterpret_cast<uint8_t*>(p);
+
+    for (uint8_t j = 0; j < sizeof(exdir_t); j++)
+    {
+      if (i == 0 && (j == 2 || j == 3))
+      {
+        continue;
+      }
+
+      sum = exFatHashByte(sum, b[j]);
+    }
+  }
+
+  p = exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+  if (!p)
+  {
+    return false;
+  }
+
+  p->file.setChecksum = sum;
+
+  return true;
+}
+#endif  // SD_EXFAT
+
+#if SD_FILE_EXTENTS
+//------------------------------------------------------------------------------
+// record that file cluster index is cluster, only the cluster just past the
+// known part of the chain is accepted so extents always start at cluster zero
+void RP2040_SdFile::extentAdd(uint32_t index, uint32_t cluster)
+{
+  if (extentCount_ == 0)
+  {
+    return;
+  }
+
+  extent_t* e = &extent_[extentCount_ - 1];
+
+  if (index != (e->index + e->count))
+  {
+    return;
+  }
+
+  if (cluster == (e->cluster + e->count))
+  {
+    // extend contiguous run
+    e->count++;
+  }
+  else if (extentCount_ < SD_FILE_EXTENTS)
+  {
+    // start new run
+    e++;
+    e->index = index;
+    e->cluster = cluster;
+    e->count = 1;
+    extentCount_++;
+  }
+}
+//------------------------------------------------------------------------------
+// find the known cluster nearest to and not past *index, return false if
+// no cluster is known
+uint8_t RP2040_SdFile::extentFind(uint32_t* index, uint32_t* cluster) const
+{
+  if (extentCount_ == 0)
+  {
+    return false;
+  }
+
+  // binary search for last extent starting at or before index
+  uint8_t lo = 0;
+  uint8_t hi = extentCount_ - 1;
+
+  while (lo < hi)
+  {
+    uint8_t mid = (lo + hi + 1) / 2;
+
+    if (extent_[mid].index <= *index)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+
+  const extent_t* e = &extent_[lo];
+
+  // clamp to end of run
+  if (*index >= (e->index + e->count))
+  {
+    *index = e->index + e->count - 1;
+  }
+
+  *cluster = e->cluster + (*index - e->index);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// start the extent list with the first cluster of the file
+void RP2040_SdFile::extentReset()
+{
+  extentCount_ = 0;
+
+  if (firstCluster_ && type_ != FAT_FILE_TYPE_ROOT16)
+  {
+    extent_[0].index = 0;
+    extent_[0].cluster = firstCluster_;
+    extent_[0].count = 1;
+    extentCount_ = 1;
+  }
+}
+//------------------------------------------------------------------------------
+// forget clusters past the first count clusters of the file
+void RP2040_SdFile::extentTrim(uint32_t count)
+{
+  while (extentCount_ && extent_[extentCount_ - 1].index >= count)
+  {
+    extentCount_--;
+  }
+
+  if (extentCount_)
+  {
+    extent_t* e = &extent_[extentCount_ - 1];
+
+    if ((e->index + e->count) > count)
+    {
+      e->count = count - e->index;
+    }
+  }
+}
+#endif  // SD_FILE_EXTENTS
+//------------------------------------------------------------------------------
+/** List directory contents to DEBUG PORT.
+
+   \param[in] flags The inclusive OR of
+
+   LS_DATE - %Print file modification date
+
+   LS_SIZE - %Print file size.
+
+   LS_R - Recursive list of subdirectories.
+
+   \param[in] indent Amount of space before file name. Used for recursive
+   list to indicate subdirectory level.
+*/
+void RP2040_SdFile::ls(uint8_t flags, uint8_t indent)
+{
+  dir_t d;
+  dir_t* p = &d;
+  uint16_t index;
+
+  rewind();
+
+  // readDir() returns only subdirectories and files
+  while (readDir(p, &index) > 0)
+  {
+    // print any indent spaces
+    for (int8_t i = 0; i < indent; i++)
+    {
+      RP2040_SD_PRINT_SP;
+    }
+
+    // print file name with possible blank fill
+    printDirName(*p, flags & (LS_DATE | LS_SIZE) ? 14 : 0);
+
+    // print modify date/time if requested
+    if (flags & LS_DATE)
+    {
+      printFatDate(p->lastWriteDate);
+      RP2040_SD_PRINT_SP;
+      printFatTime(p->lastWriteTime);
+    }
+
+    // print size if requested
+    if (!DIR_IS_SUBDIR(p) && (flags & LS_SIZE))
+    {
+      RP2040_SD_LOG1(' ', p->fileSize);
+    }
+
+    RP2040_SD_PRINTLN();
+
+    // list subdirectory content if requested
+    if ((flags & LS_R) && DIR_IS_SUBDIR(p))
+    {
+      uint32_t pos = curPosition();
+      RP2040_SdFile s;
+
+      if (s.open(this, index, O_READ))
+      {
+        s.ls(flags, indent + 2);
+      }
+
+      seekSet(pos);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// format directory name field from a 8.3 name string
+uint8_t RP2040_SdFile::make83Name(const char* str, uint8_t* name)
+{
+  uint8_t c;
+  uint8_t n = 7;  // max index for part before dot
+  uint8_t i = 0;
+
+  // blank fill name and extension
+  while (i < 11)
+  {
+    name[i++] = ' ';
+  }
+
+  i = 0;
+
+  while ((c = *str++) != '\0')
+  {
+    if (c == '.')
+    {
+      if (n == 10)
+      {
+        return false;  // only one dot allowed
+      }
+
+      n = 10;  // max index for full 8.3 name
+      i = 8;   // place for extension
+    }
+    else
+    {
+      // illegal FAT characters
+      uint8_t b;
+
+      const uint8_t valid[] = "|<>^+=?/[];,*\"\\";
+      const uint8_t *p = valid;
+
+      while ((b = *p++))
+      {
+        if (b == c)
+        {
+          return false;
+        }
+      }
+
+      // check size and only allow ASCII printable characters
+      if (i > n || c < 0X21 || c > 0X7E)
+      {
+        return false;
+      }
+
+      // only upper case allowed in 8.3 names - convert lower to upper
+      name[i++] = c < 'a' || c > 'z' ?  c : c + ('A' - 'a');
+    }
+  }
+
+  // must have a file name, extension is optional
+  return name[0] != ' ';
+}
+
+//------------------------------------------------------------------------------
+/** Make a new directory.
+
+   \param[in] dir An open SdFat instance for the directory that will containing
+   the new directory.
+
+   \param[in] dirName A valid 8.3 DOS name for the new directory.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+   Reasons for failure include this RP2040_SdFile is already open, \a dir is not a
+   directory, \a dirName is invalid or already exists in \a dir.
+*/
+uint8_t RP2040_SdFile::makeDir(RP2040_SdFile* dir, const char* dirName)
+{
+  dir_t d;
+
+  // create a normal file
+  if (!open(dir, dirName, O_CREAT | O_EXCL | O_RDWR))
+  {
+    return false;
+  }
+
+  // convert RP2040_SdFile to directory
+  flags_ = O_READ;
+  type_ = FAT_FILE_TYPE_SUBDIR;
+
+  // allocate and zero first cluster
+  if (!addDirCluster())
+  {
+    return false;
+  }
+
+#if SD_EXFAT
+
+  // exFAT directories have no '.' and '..' entries
+  if (vol_->fatType() == 64)
+  {
+    exdir_t* x = exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+    if (!x)
+    {
+      return false;
+    }
+
+    x->file.attributes = DIR_ATT_DIRECTORY;
+    flags_ |= F_FILE_DIR_DIRTY;
+
+    return sync();
+  }
+
+#endif  // SD_EXFAT
+
+  // force entry to SD
+  if (!sync())
+  {
+    return false;
+  }
+
+  // cache entry - should already be in cache due to sync() call
+  dir_t* p = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_WRITE);
+
+  if (!p)
+  {
+    return false;
+  }
+
+  // change directory entry  attribute
+  p->attributes = DIR_ATT_DIRECTORY;
+
+  // make entry for '.'
+  memcpy(&d, p, sizeof(d));
+
+  for (uint8_t i = 1; i < 11; i++)
+  {
+    d.name[i] = ' ';
+  }
+
+  d.name[0] = '.';
+
+  // cache block for '.'  and '..'
+  uint32_t block = vol_->clusterStartBlock(firstCluster_);
+
+  if (!vol_->cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_WRITE))
+  {
+    return false;
+  }
+
+  // copy '.' to block
+  memcpy(&vol_->cacheAddress()->dir[0], &d, sizeof(d));
+
+  // make entry for '..'
+  d.name[1] = '.';
+
+  if (dir->isRoot())
+  {
+    d.firstClusterLow = 0;
+    d.firstClusterHigh = 0;
+  }
+  else
+  {
+    d.firstClusterLow = dir->firstCluster_ & 0XFFFF;
+    d.firstClusterHigh = dir->firstCluster_ >> 16;
+  }
+
+  // copy '..' to block
+  memcpy(&vol_->cacheAddress()->dir[1], &d, sizeof(d));
+
+  // set position after '..'
   curPosition_ = 2 * sizeof(d);
 
   // write first block
-  return RP2040_SdVolume::cacheFlush();
+  return vol_->cacheFlush();
+}
+//------------------------------------------------------------------------------
+// get the cluster after curCluster_, index is the file cluster index of the
+// cluster returned in next
+uint8_t RP2040_SdFile::nextCluster(uint32_t index, uint32_t* next)
+{
+#if !SD_EXFAT && !SD_FILE_EXTENTS
+  // index only locates clusters without following the FAT
+  (void)index;
+#endif
+
+#if SD_EXFAT
+
+  // clusters of a NoFatChain file follow the first cluster
+  if (exFlags_ & EXFAT_FLAG_NO_FAT_CHAIN)
+  {
+    *next = index < exClusters_ ? firstCluster_ + index : EXFAT_EOC;
+    return true;
+  }
+
+#endif  // SD_EXFAT
+
+#if SD_FILE_EXTENTS
+  uint32_t i = index;
+  uint32_t cluster;
+
+  if (extentFind(&i, &cluster) && i == index)
+  {
+    *next = cluster;
+    return true;
+  }
+
+#endif  // SD_FILE_EXTENTS
+
+  if (!vol_->fatGet(curCluster_, next))
+  {
+    return false;
+  }
+
+#if SD_FILE_EXTENTS
+
+  if (!vol_->isEOC(*next))
+  {
+    extentAdd(index, *next);
+  }
+
+#endif  // SD_FILE_EXTENTS
+
+  return true;
 }
 //------------------------------------------------------------------------------
 /**
@@ -573,6 +1620,15 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
     return false;
   }
 
+#if SD_EXFAT
+
+  if (dirFile->isDir() && dirFile->vol_->fatType() == 64)
+  {
+    return exFatOpen(dirFile, fileName, oflag);
+  }
+
+#endif  // SD_EXFAT
+
   if (!make83Name(fileName, dname))
   {
     return false;
@@ -584,8 +1640,57 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
   // bool for empty entry found
   uint8_t emptyFound = false;
 
+  // bool to search the directory
+  uint8_t scan = true;
+
+#if SD_DIR_INDEX_ENTRIES
+  // name index key, the FAT16 root has no first cluster
+  uint32_t key = dirFile->type_ == FAT_FILE_TYPE_ROOT16 ? 1 : dirFile->firstCluster_;
+  int8_t indexed = vol_->dirIndexFind(key, dname, &dirIndex_);
+
+  if (indexed > 0)
+  {
+    // don't open existing file if O_CREAT and O_EXCL
+    if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+    {
+      return false;
+    }
+
+    return openCachedEntry(dirIndex_, oflag);
+  }
+
+  if (indexed == 0)
+  {
+    // only create file if O_CREAT and O_WRITE
+    if ((oflag & (O_CREAT | O_WRITE)) != (O_CREAT | O_WRITE))
+    {
+      return false;
+    }
+
+    // skip the scan if the first free entry is known
+    emptyFound = vol_->dirIndexFree(&dirBlock_, &dirIndex_);
+    scan = !emptyFound;
+  }
+
+  // bool to build the index while the directory is searched
+  uint8_t build = scan;
+
+  // entry found while building the index
+  uint32_t foundBlock = 0;
+  uint8_t foundIndex = 0;
+
+  // first empty slot is followed by never used entries
+  uint8_t emptyTail = false;
+
+  if (build)
+  {
+    vol_->dirIndexStart();
+  }
+
+#endif  // SD_DIR_INDEX_ENTRIES
+
   // search for file
-  while (dirFile->curPosition_ < dirFile->fileSize_)
+  while (scan && dirFile->curPosition_ < dirFile->fileSize_)
   {
     uint8_t index = 0XF & (dirFile->curPosition_ >> 5);
     p = dirFile->readDirCache();
@@ -602,7 +1707,10 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
       {
         emptyFound = true;
         dirIndex_ = index;
-        dirBlock_ = RP2040_SdVolume::cacheBlockNumber_;
+        dirBlock_ = vol_->cacheBlockNumber();
+#if SD_DIR_INDEX_ENTRIES
+        emptyTail = p->name[0] == DIR_NAME_FREE;
+#endif  // SD_DIR_INDEX_ENTRIES
       }
 
       // done if no entries follow
@@ -610,9 +1718,39 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
       {
         break;
       }
+
+      continue;
+    }
+
+#if SD_DIR_INDEX_ENTRIES
+
+    if (build && !DIR_IS_LONG_NAME(p))
+    {
+      // give up on the index if the directory does not fit
+      build = vol_->dirIndexAdd(p->name, vol_->cacheBlockNumber(), index);
+
+      if (!build && foundBlock)
+      {
+        break;
+      }
     }
-    else if (!memcmp(dname, p->name, 11))
+
+#endif  // SD_DIR_INDEX_ENTRIES
+
+    if (!memcmp(dname, p->name, 11))
     {
+#if SD_DIR_INDEX_ENTRIES
+
+      // finish the index before opening the entry
+      if (build)
+      {
+        foundBlock = vol_->cacheBlockNumber();
+        foundIndex = index;
+        continue;
+      }
+
+#endif  // SD_DIR_INDEX_ENTRIES
+
       // don't open existing file if O_CREAT and O_EXCL
       if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
       {
@@ -624,6 +1762,32 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
     }
   }
 
+#if SD_DIR_INDEX_ENTRIES
+
+  if (build)
+  {
+    // the whole directory is in the index
+    vol_->dirIndexSet(key, emptyFound ? dirBlock_ : 0, dirIndex_, emptyTail);
+  }
+
+  if (foundBlock)
+  {
+    // don't open existing file if O_CREAT and O_EXCL
+    if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+    {
+      return false;
+    }
+
+    if (!vol_->cacheRawBlock(foundBlock, RP2040_SdVolume::CACHE_FOR_READ))
+    {
+      return false;
+    }
+
+    return openCachedEntry(foundIndex, oflag);
+  }
+
+#endif  // SD_DIR_INDEX_ENTRIES
+
   // only create file if O_CREAT and O_WRITE
   if ((oflag & (O_CREAT | O_WRITE)) != (O_CREAT | O_WRITE))
   {
@@ -655,7 +1819,7 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
 
     // use first entry in cluster
     dirIndex_ = 0;
-    p = RP2040_SdVolume::cacheBuffer_.dir;
+    p = vol_->cacheAddress()->dir;
   }
 
   // initialize as empty file
@@ -680,11 +1844,15 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, const char* fileName, uint8_
   p->lastWriteTime = p->creationTime;
 
   // force write of entry to SD
-  if (!RP2040_SdVolume::cacheFlush())
+  if (!vol_->cacheFlush())
   {
     return false;
   }
 
+#if SD_DIR_INDEX_ENTRIES
+  vol_->dirIndexCreate(key, dname, vol_->cacheBlockNumber(), dirIndex_);
+#endif  // SD_DIR_INDEX_ENTRIES
+
   // open entry in cache
   return openCachedEntry(dirIndex_, oflag);
 }
@@ -733,6 +1901,21 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, uint16_t index, uint8_t ofla
     return false;
   }
 
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    // index must be the file entry of an entry set
+    if (reinterpret_cast<exdir_t*>(p)->type != EXFAT_TYPE_FILE)
+    {
+      return false;
+    }
+
+    return exFatOpenSet(dirFile, NULL, 0, 0, oflag) > 0;
+  }
+
+#endif  // SD_EXFAT
+
   // error if empty slot or '.' or '..'
   if (p->name[0] == DIR_NAME_FREE || p->name[0] == DIR_NAME_DELETED || p->name[0] == '.')
   {
@@ -747,7 +1930,7 @@ uint8_t RP2040_SdFile::open(RP2040_SdFile* dirFile, uint16_t index, uint8_t ofla
 uint8_t RP2040_SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag)
 {
   // location of entry in cache
-  dir_t* p = RP2040_SdVolume::cacheBuffer_.dir + dirIndex;
+  dir_t* p = vol_->cacheAddress()->dir + dirIndex;
 
   // write or truncate is an error for a directory or read-only file
   if (p->attributes & (DIR_ATT_READ_ONLY | DIR_ATT_DIRECTORY))
@@ -760,7 +1943,7 @@ uint8_t RP2040_SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag)
 
   // remember location of directory entry on SD
   dirIndex_ = dirIndex;
-  dirBlock_ = RP2040_SdVolume::cacheBlockNumber_;
+  dirBlock_ = vol_->cacheBlockNumber();
 
   // copy first cluster number for directory fields
   firstCluster_ = (uint32_t)p->firstClusterHigh << 16;
@@ -789,17 +1972,77 @@ uint8_t RP2040_SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag)
   // save open flags for read/write
   flags_ = oflag & (O_ACCMODE | O_SYNC | O_APPEND);
 
-  // set to start of file
-  curCluster_ = 0;
-  curPosition_ = 0;
+  // set to start of file
+  curCluster_ = 0;
+  curPosition_ = 0;
+  allocTail_ = false;
+  atPosition_ = 0;
+
+#if SD_EXFAT
+  exFlags_ = 0;
+#endif
+
+#if SD_FILE_EXTENTS
+  extentReset();
+#endif
+
+  // truncate file to zero length if requested
+  if (oflag & O_TRUNC)
+  {
+    return truncate(0);
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/**
+   Open a subdirectory for read from the location of its directory entry.
+   Used to reopen a directory found by an earlier open() without a search of
+   its parent.
+
+   \param[in] vol The FAT16 or FAT32 volume containing the subdirectory.
+
+   \param[in] block The block that holds the directory entry, see dirBlock().
+
+   \param[in] index The index of the entry in \a block, see dirIndex().
+
+   \param[in] cluster The first cluster the entry must still have.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+   Reasons for failure include this RP2040_SdFile is already open, \a vol is
+   exFAT or the entry is no longer a subdirectory starting at \a cluster.
+*/
+uint8_t RP2040_SdFile::openDirEntry(RP2040_SdVolume* vol, uint32_t block, uint8_t index,
+                                    uint32_t cluster)
+{
+  // error if file is already open
+  if (isOpen() || vol->fatType() == 64 || index > 0XF)
+  {
+    return false;
+  }
+
+  if (!vol->cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_READ))
+  {
+    return false;
+  }
+
+  dir_t* p = vol->cacheAddress()->dir + index;
+
+  // entry may have been removed or reused since it was found
+  if (p->name[0] == DIR_NAME_FREE || p->name[0] == DIR_NAME_DELETED || !DIR_IS_SUBDIR(p))
+  {
+    return false;
+  }
 
-  // truncate file to zero length if requested
-  if (oflag & O_TRUNC)
+  if ((((uint32_t)p->firstClusterHigh << 16) | p->firstClusterLow) != cluster)
   {
-    return truncate(0);
+    return false;
   }
 
-  return true;
+  vol_ = vol;
+
+  return openCachedEntry(index, O_READ);
 }
 //------------------------------------------------------------------------------
 /**
@@ -826,8 +2069,9 @@ uint8_t RP2040_SdFile::openRoot(RP2040_SdVolume* vol)
     firstCluster_ = 0;
     fileSize_ = 32 * vol->rootDirEntryCount();
   }
-  else if (vol->fatType() == 32)
+  else if (vol->fatType() == 32 || vol->fatType() == 64)
   {
+    // the exFAT root directory is a FAT chain like FAT32
     type_ = FAT_FILE_TYPE_ROOT32;
     firstCluster_ = vol->rootDirStart();
 
@@ -849,6 +2093,16 @@ uint8_t RP2040_SdFile::openRoot(RP2040_SdVolume* vol)
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
+  allocTail_ = false;
+  atPosition_ = 0;
+
+#if SD_EXFAT
+  exFlags_ = 0;
+#endif
+
+#if SD_FILE_EXTENTS
+  extentReset();
+#endif
 
   // root has no directory entry
   dirBlock_ = 0;
@@ -857,6 +2111,106 @@ uint8_t RP2040_SdFile::openRoot(RP2040_SdVolume* vol)
   return true;
 }
 //------------------------------------------------------------------------------
+/**
+   Reserve clusters so a file can grow to \a bytes bytes without cluster
+   allocation.  The file size is not changed.  Clusters are added after the
+   last cluster of the file so the reservation is contiguous where free space
+   allows.  Reserved clusters that have not been written are released by
+   truncate().  On FAT16 and FAT32 they stay with the file after close() so
+   it grows into them when opened again, exFAT records no clusters past the
+   file size so close() releases them there.
+
+   \param[in] bytes The file size to reserve space for.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+   Reasons for failure include file is read only, file is a directory,
+   the volume is full or an I/O error occurs.
+*/
+uint8_t RP2040_SdFile::preallocate(uint32_t bytes)
+{
+  // error if not a normal file or read-only
+  if (!isFile() || !(flags_ & O_WRITE))
+  {
+    return false;
+  }
+
+  // an allocation batch past the end of file is not part of a reservation
+  if (allocTail_ && !truncate(fileSize_))
+  {
+    return false;
+  }
+
+  // clusters needed for bytes
+  uint32_t need = bytes ? ((bytes - 1) >> (vol_->clusterSizeShift_ + 9)) + 1 : 0;
+
+  // remember position for seek after allocation
+  uint32_t pos = curPosition_;
+
+  // position to last cluster of file data
+  if (!seekSet(fileSize_))
+  {
+    return false;
+  }
+
+  uint32_t last = curCluster_;
+
+  // clusters in the chain so far
+  uint32_t have = fileSize_ ? ((fileSize_ - 1) >> (vol_->clusterSizeShift_ + 9)) + 1 : 0;
+
+  if (have == 0 && firstCluster_)
+  {
+    // empty file with clusters reserved by an earlier call
+    curCluster_ = firstCluster_;
+    have = 1;
+  }
+
+  for (;;)
+  {
+    if (have)
+    {
+      uint32_t next;
+
+      // follow clusters already reserved past the end of file
+      if (!nextCluster(have, &next))
+      {
+        return false;
+      }
+
+      if (!vol_->isEOC(next))
+      {
+        curCluster_ = next;
+        have++;
+        continue;
+      }
+    }
+
+    if (have >= need)
+    {
+      break;
+    }
+
+    if (!addCluster(need - have))
+    {
+      return false;
+    }
+
+#if SD_FILE_EXTENTS
+    extentAdd(have, curCluster_);
+#endif
+
+    have++;
+  }
+
+  // addCluster() marks a batch for close() to release, keep the reservation
+  allocTail_ = vol_->fatType() == 64;
+
+  // curCluster_ must match curPosition_ for the seek
+  curCluster_ = last;
+
+  return seekSet(pos);
+}
+//------------------------------------------------------------------------------
 /** %Print the name field of a directory entry in 8.3 format to DEBUG PORT
 
    \param[in] dir The directory structure containing the name.
@@ -983,6 +2337,7 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
   {
     uint32_t block;  // raw device block number
     uint16_t offset = curPosition_ & 0X1FF;  // offset in block
+    uint16_t blockOfCluster = 0;
 
     if (type_ == FAT_FILE_TYPE_ROOT16)
     {
@@ -990,7 +2345,7 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
     }
     else
     {
-      uint8_t blockOfCluster = vol_->blockOfCluster(curPosition_);
+      blockOfCluster = vol_->blockOfCluster(curPosition_);
 
       if (offset == 0 && blockOfCluster == 0)
       {
@@ -1002,8 +2357,8 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
         }
         else
         {
-          // get next cluster from FAT
-          if (!vol_->fatGet(curCluster_, &curCluster_))
+          // get next cluster from extents or FAT
+          if (!nextCluster(curPosition_ >> (vol_->clusterSizeShift_ + 9), &curCluster_))
           {
             return -1;
           }
@@ -1013,6 +2368,82 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
       block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
     }
 
+    // use a multiple block read if two or more whole blocks are wanted
+    if (offset == 0 && toRead >= 1024 && !unbufferedRead())
+    {
+      // number of whole blocks wanted
+      uint16_t nb = toRead >> 9;
+
+      // number of contiguous blocks starting at block
+      uint16_t run = nb;
+
+      if (type_ != FAT_FILE_TYPE_ROOT16)
+      {
+        run = vol_->blocksPerCluster_ - blockOfCluster;
+
+        // file cluster index of curCluster_
+        uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
+
+        // extend run while next cluster follows current cluster
+        while (run < nb)
+        {
+          uint32_t next;
+
+          if (!nextCluster(++index, &next))
+          {
+            return -1;
+          }
+
+          if (next != (curCluster_ + 1))
+          {
+            break;
+          }
+
+          curCluster_ = next;
+          run += vol_->blocksPerCluster_;
+        }
+
+        if (run > nb)
+        {
+          run = nb;
+        }
+      }
+
+      if (run > 1)
+      {
+        // write any dirty cache block so the card has current data
+        if (!vol_->cacheFlush())
+        {
+          return -1;
+        }
+
+        if (!vol_->readStart(block))
+        {
+          return -1;
+        }
+
+        for (uint16_t i = 0; i < run; i++)
+        {
+          if (!vol_->readData(dst))
+          {
+            return -1;
+          }
+
+          dst += 512;
+        }
+
+        if (!vol_->readStop())
+        {
+          return -1;
+        }
+
+        curPosition_ += 512UL * run;
+        toRead -= 512 * run;
+
+        continue;
+      }
+    }
+
     uint16_t n = toRead;
 
     // amount to be read from current block
@@ -1022,7 +2453,7 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
     }
 
     // no buffering needed if n == 512 or user requests no buffering
-    if ((unbufferedRead() || n == 512) && block != RP2040_SdVolume::cacheBlockNumber_)
+    if ((unbufferedRead() || n == 512) && vol_->cacheFind(block) < 0)
     {
       if (!vol_->readData(block, offset, n, dst))
       {
@@ -1034,12 +2465,12 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
     else
     {
       // read block to cache and copy data to caller
-      if (!RP2040_SdVolume::cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_READ))
+      if (!vol_->cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_READ))
       {
         return -1;
       }
 
-      uint8_t* src = RP2040_SdVolume::cacheBuffer_.data + offset;
+      uint8_t* src = vol_->cacheAddress()->data + offset;
       uint8_t* end = src + n;
 
       while (src != end)
@@ -1055,6 +2486,43 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
   return nbyte;
 }
 //------------------------------------------------------------------------------
+/**
+   Read data from a file at a given position without moving the file's
+   current position.
+
+   The cluster that holds \a pos is found from the current position or the
+   cluster of the last readAt() or writeAt(), whichever is closer, so
+   repeated reads of fixed offsets between sequential reads or writes do
+   not follow the cluster chain from the start of the file.
+
+   \param[in] pos The position in bytes from the beginning of the file.
+
+   \param[out] buf Pointer to the location that will receive the data.
+
+   \param[in] nbyte Maximum number of bytes to read.
+
+   \return For success readAt() returns the number of bytes read, less
+   than \a nbyte if the end of file is reached.  If an error occurs,
+   readAt() returns -1.  Possible errors include \a pos is past the end of
+   file, the file is not open or an I/O error occurred.
+*/
+int16_t RP2040_SdFile::readAt(uint32_t pos, void* buf, uint16_t nbyte)
+{
+  uint32_t position = curPosition_;
+  uint32_t cluster = curCluster_;
+  int16_t n = -1;
+
+  if (seekAt(pos))
+  {
+    n = read(buf, nbyte);
+  }
+
+  curPosition_ = position;
+  curCluster_ = cluster;
+
+  return n;
+}
+//------------------------------------------------------------------------------
 /**
    Read the next directory entry from a directory file.
 
@@ -1067,6 +2535,15 @@ int16_t RP2040_SdFile::read(void* buf, uint16_t nbyte)
    a directory file or an I/O error occurred.
 */
 int8_t RP2040_SdFile::readDir(dir_t* dir)
+{
+  uint16_t index;
+
+  return readDir(dir, &index);
+}
+//------------------------------------------------------------------------------
+// read the next file or subdirectory entry, index is set to the directory
+// index for open() of the entry
+int8_t RP2040_SdFile::readDir(dir_t* dir, uint16_t* index)
 {
   int8_t n;
 
@@ -1076,6 +2553,15 @@ int8_t RP2040_SdFile::readDir(dir_t* dir)
     return -1;
   }
 
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    return exFatReadDir(dir, index);
+  }
+
+#endif  // SD_EXFAT
+
   while ((n = read(dir, sizeof(dir_t))) == sizeof(dir_t))
   {
     // last entry if DIR_NAME_FREE
@@ -1093,6 +2579,7 @@ int8_t RP2040_SdFile::readDir(dir_t* dir)
     // return if normal file or subdirectory
     if (DIR_IS_FILE_OR_SUBDIR(dir))
     {
+      *index = curPosition_ / 32 - 1;
       return n;
     }
   }
@@ -1124,7 +2611,156 @@ dir_t* RP2040_SdFile::readDirCache()
   curPosition_ += 31;
 
   // return pointer to entry
-  return (RP2040_SdVolume::cacheBuffer_.dir + i);
+  return (vol_->cacheAddress()->dir + i);
+}
+//------------------------------------------------------------------------------
+// store a file or subdirectory entry that passes the readDirEntries() filter
+static uint8_t dirInfoAdd(dirinfo_t* info, const dir_t* p, uint16_t index,
+                          uint8_t attrMask, uint8_t attrValue, const uint8_t* ext)
+{
+  // skip empty entries, entries for . and .. and volume labels
+  if (p->name[0] == DIR_NAME_DELETED || p->name[0] == '.' || !DIR_IS_FILE_OR_SUBDIR(p))
+  {
+    return false;
+  }
+
+  if ((p->attributes & attrMask) != attrValue)
+  {
+    return false;
+  }
+
+  if (ext)
+  {
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      if (toupper(p->name[8 + i]) != ext[i])
+      {
+        return false;
+      }
+    }
+  }
+
+  RP2040_SdFile::dirName(*p, info->name);
+  info->attributes = p->attributes;
+  info->index = index;
+  info->size = p->fileSize;
+  info->firstCluster = (uint32_t)p->firstClusterHigh << 16 | p->firstClusterLow;
+  info->creationDate = p->creationDate;
+  info->creationTime = p->creationTime;
+  info->lastWriteDate = p->lastWriteDate;
+  info->lastWriteTime = p->lastWriteTime;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/**
+   Read the next file and subdirectory entries of a directory into an array.
+
+   Entries are taken from each cached directory block in place, so a
+   listing needs one block read per sixteen entries and no open file.
+   Deleted entries, volume labels and the . and .. entries are skipped.
+   Call again to continue the listing and rewind() to start over.
+
+   \param[out] list Array for the entries.
+
+   \param[in] count Number of entries \a list can hold.
+
+   \param[in] attrMask Attribute bits to test, zero for all entries.
+
+   \param[in] attrValue Required value of the bits in \a attrMask, for
+   example \a attrMask DIR_ATT_DIRECTORY with \a attrValue zero lists
+   files only.
+
+   \param[in] ext Extension the 8.3 name must have, any case, "" for none,
+   or NULL for all entries.
+
+   \return The number of entries stored in \a list, zero at the end of the
+   directory or -1 if an error occurs.  Possible errors include this is not
+   a directory file or an I/O error occurred.
+*/
+int16_t RP2040_SdFile::readDirEntries(dirinfo_t* list, uint16_t count, uint8_t attrMask,
+                                      uint8_t attrValue, const char* ext)
+{
+  uint8_t x[3];
+  uint16_t n = 0;
+
+  // if not a directory file or miss-positioned return an error
+  if (!isDir() || (0X1F & curPosition_))
+  {
+    return -1;
+  }
+
+  // extension as the space padded upper case name field
+  if (ext)
+  {
+    for (uint8_t i = 0; i < 3; i++)
+    {
+      x[i] = *ext ? toupper(*ext++) : ' ';
+    }
+  }
+
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    dir_t dir;
+    uint16_t index;
+
+    while (n < count)
+    {
+      int8_t rtn = exFatReadDir(&dir, &index);
+
+      if (rtn <= 0)
+      {
+        return rtn < 0 ? -1 : n;
+      }
+
+      if (dirInfoAdd(list + n, &dir, index, attrMask, attrValue, ext ? x : NULL))
+      {
+        n++;
+      }
+    }
+
+    return n;
+  }
+
+#endif  // SD_EXFAT
+
+  while (n < count && curPosition_ < fileSize_)
+  {
+    // cache the block of the next entry
+    dir_t* p = readDirCache();
+
+    if (p == NULL)
+    {
+      return -1;
+    }
+
+    // scan the rest of the block in the cache
+    while (true)
+    {
+      // last entry if DIR_NAME_FREE
+      if (p->name[0] == DIR_NAME_FREE)
+      {
+        return n;
+      }
+
+      if (dirInfoAdd(list + n, p, (curPosition_ >> 5) - 1, attrMask, attrValue, ext ? x : NULL))
+      {
+        n++;
+      }
+
+      if (n == count || (0X1FF & curPosition_) == 0 || curPosition_ >= fileSize_)
+      {
+        break;
+      }
+
+      p++;
+      curPosition_ += 32;
+    }
+  }
+
+  return n;
 }
 //------------------------------------------------------------------------------
 /**
@@ -1136,19 +2772,55 @@ dir_t* RP2040_SdFile::readDirCache()
    file that has a long name. For example if a file has the long name
    "New Text Document.txt" you should not delete the 8.3 name "NEWTEX~1.TXT".
 
-   \return The value one, true, is returned for success and
-   the value zero, false, is returned for failure.
-   Reasons for failure include the file read-only, is a directory,
-   or an I/O error occurred.
-*/
-uint8_t RP2040_SdFile::remove()
-{
-  // free any clusters - will fail if read-only or directory
-  if (!truncate(0))
-  {
-    return false;
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+   Reasons for failure include the file read-only, is a directory,
+   or an I/O error occurred.
+*/
+uint8_t RP2040_SdFile::remove()
+{
+#if SD_DIR_INDEX_ENTRIES
+  // the index must not outlive a directory removed by rmDir()
+  vol_->dirIndexForget(firstCluster_);
+#endif  // SD_DIR_INDEX_ENTRIES
+
+  // free any clusters - will fail if read-only or directory
+  if (!truncate(0))
+  {
+    return false;
+  }
+
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    exdir_t* x = exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_READ);
+
+    if (!x)
+    {
+      return false;
+    }
+
+    // mark all entries of the set free
+    for (uint8_t i = 0, count = x->file.secondaryCount; i <= count; i++)
+    {
+      x = exFatCacheEntry(i, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+      if (!x)
+      {
+        return false;
+      }
+
+      x->type &= ~EXFAT_TYPE_IN_USE;
+    }
+
+    type_ = FAT_FILE_TYPE_CLOSED;
+
+    return vol_->cacheFlush();
   }
 
+#endif  // SD_EXFAT
+
   // cache directory entry
   dir_t* d = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_WRITE);
 
@@ -1160,11 +2832,15 @@ uint8_t RP2040_SdFile::remove()
   // mark entry deleted
   d->name[0] = DIR_NAME_DELETED;
 
+#if SD_DIR_INDEX_ENTRIES
+  vol_->dirIndexRemove(dirBlock_, dirIndex_);
+#endif  // SD_DIR_INDEX_ENTRIES
+
   // set this RP2040_SdFile closed
   type_ = FAT_FILE_TYPE_CLOSED;
 
   // write entry to SD
-  return RP2040_SdVolume::cacheFlush();
+  return vol_->cacheFlush();
 }
 //------------------------------------------------------------------------------
 /**
@@ -1222,33 +2898,12 @@ uint8_t RP2040_SdFile::rmDir()
 
   rewind();
 
-  // make sure directory is empty
-  while (curPosition_ < fileSize_)
-  {
-    dir_t* p = readDirCache();
-
-    if (p == NULL)
-    {
-      return false;
-    }
-
-    // done if past last used entry
-    if (p->name[0] == DIR_NAME_FREE)
-    {
-      break;
-    }
-
-    // skip empty slot or '.' or '..'
-    if (p->name[0] == DIR_NAME_DELETED || p->name[0] == '.')
-    {
-      continue;
-    }
+  // make sure directory is empty, readDir() skips '.' and '..'
+  dir_t d;
 
-    // error not empty
-    if (DIR_IS_FILE_OR_SUBDIR(p))
-    {
-      return false;
-    }
+  if (readDir(&d) != 0)
+  {
+    return false;
   }
 
   // convert empty directory to normal file for remove
@@ -1275,139 +2930,395 @@ uint8_t RP2040_SdFile::rmDir()
 */
 uint8_t RP2040_SdFile::rmRfStar()
 {
+  dir_t d;
+  uint16_t index;
+  int8_t n;
+
+  rewind();
+
+  // readDir() skips long name entries, volume labels, '.' and '..'
+  while ((n = readDir(&d, &index)) > 0)
+  {
+    RP2040_SdFile f;
+
+    // remember position
+    uint32_t pos = curPosition_;
+
+    if (!f.open(this, index, O_READ))
+    {
+      return false;
+    }
+
+    if (f.isSubDir())
+    {
+      // recursively delete
+      if (!f.rmRfStar())
+      {
+        return false;
+      }
+    }
+    else
+    {
+      // ignore read-only
+      f.flags_ |= O_WRITE;
+
+      if (!f.remove())
+      {
+        return false;
+      }
+    }
+
+    // position to next entry if required
+    if (curPosition_ != pos)
+    {
+      if (!seekSet(pos))
+      {
+        return false;
+      }
+    }
+  }
+
+  if (n < 0)
+  {
+    return false;
+  }
+
+  // don't try to delete root
+  if (isRoot())
+  {
+    return true;
+  }
+
+  return rmDir();
+}
+//------------------------------------------------------------------------------
+// set the position to pos starting from the current position or the start
+// of the cluster used by the last readAt() or writeAt(), whichever is closer
+// behind pos, then remember the start of the cluster that holds pos
+uint8_t RP2040_SdFile::seekAt(uint32_t pos)
+{
+  if (atPosition_ && atPosition_ <= pos && (curPosition_ > pos || atPosition_ > curPosition_))
+  {
+    curPosition_ = atPosition_;
+    curCluster_ = atCluster_;
+  }
+
+  if (!seekSet(pos))
+  {
+    return false;
+  }
+
+  // curCluster_ holds byte pos - 1, so does the first byte of its cluster
+  if (pos && curCluster_)
+  {
+    atPosition_ = ((pos - 1) & ~((512UL << vol_->clusterSizeShift_) - 1)) + 1;
+    atCluster_ = curCluster_;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/**
+   Sets a file's position.
+
+   \param[in] pos The new position in bytes from the beginning of the file.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t RP2040_SdFile::seekSet(uint32_t pos)
+{
+  // error if file not open or seek past end of file
+  if (!isOpen() || pos > fileSize_)
+  {
+    return false;
+  }
+
+  if (type_ == FAT_FILE_TYPE_ROOT16)
+  {
+    curPosition_ = pos;
+    return true;
+  }
+
+  if (pos == 0)
+  {
+    // set position to start of file
+    curCluster_ = 0;
+    curPosition_ = 0;
+    return true;
+  }
+
+  // calculate cluster index for cur and new position
+  uint32_t nCur = (curPosition_ - 1) >> (vol_->clusterSizeShift_ + 9);
+  uint32_t nNew = (pos - 1) >> (vol_->clusterSizeShift_ + 9);
+
+#if SD_EXFAT
+
+  // no FAT access for a NoFatChain file
+  if (exFlags_ & EXFAT_FLAG_NO_FAT_CHAIN)
+  {
+    curCluster_ = firstCluster_ + nNew;
+    curPosition_ = pos;
+    return true;
+  }
+
+#endif  // SD_EXFAT
+
+  // file cluster index of curCluster_ when following the chain
+  uint32_t index;
+
+  if (nNew < nCur || curPosition_ == 0)
+  {
+    // must follow chain from first cluster
+    curCluster_ = firstCluster_;
+    index = 0;
+  }
+  else
+  {
+    // advance from curPosition
+    index = nCur;
+  }
+
+#if SD_FILE_EXTENTS
+  uint32_t known = nNew;
+  uint32_t cluster;
+
+  // start from the nearest known cluster if it is closer
+  if (extentFind(&known, &cluster) && known > index)
+  {
+    curCluster_ = cluster;
+    index = known;
+  }
+
+#endif  // SD_FILE_EXTENTS
+
+  while (index < nNew)
+  {
+    if (!nextCluster(++index, &curCluster_))
+    {
+      return false;
+    }
+  }
+
+  curPosition_ = pos;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+/**
+   Look up files and subdirectories of this directory by name without
+   opening them.  All names are found with one pass over the directory.
+   On exFAT a name is only compared in full with an entry set of the same
+   name hash and length, read again from its first entry.
+
+   \param[in] names Array of \a count file names.
+
+   \param[in] count Number of names.
+
+   \param[out] list Array of \a count entries.  The entry for each name
+   found holds the name, size, attributes, timestamps, first cluster and
+   directory index of the file.  The entry of a name not found has an empty
+   name.
+
+   \return The number of names found or -1 if an error occurs.  Possible
+   errors include this is not a directory file or an I/O error occurred.
+
+   \note The directory's position is changed.
+*/
+int16_t RP2040_SdFile::statEntries(const char* const* names, uint16_t count, dirinfo_t* list)
+{
+  uint16_t found = 0;
+  uint16_t left = 0;
+
+  if (!isDir())
+  {
+    return -1;
+  }
+
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    uint16_t name[EXFAT_NAME_MAX];
+
+    // the name hash and length of each name wait in the size field of list,
+    // attributes 0XFF until found
+    for (uint16_t i = 0; i < count; i++)
+    {
+      uint8_t length = exFatNameFromUtf8(names[i], name);
+
+      list[i].name[0] = 0;
+      list[i].attributes = 0;
+
+      if (length)
+      {
+        list[i].size = (uint32_t)exFatNameHash(vol_, name, length) << 8 | length;
+        list[i].attributes = 0XFF;
+        left++;
+      }
+    }
+
+    rewind();
+
+    while (left && curPosition_ < fileSize_)
+    {
+      exdir_t* p = reinterpret_cast<exdir_t*>(readDirCache());
+
+      if (p == NULL)
+      {
+        return -1;
+      }
+
+      if (p->type == EXFAT_TYPE_END_OF_DIR)
+      {
+        break;
+      }
+
+      if (p->type != EXFAT_TYPE_FILE || curPosition_ >= fileSize_)
+      {
+        continue;
+      }
+
+      // position of the file entry, the stream extension follows it
+      uint32_t pos = curPosition_ - 32;
+      p = reinterpret_cast<exdir_t*>(readDirCache());
+
+      if (p == NULL)
+      {
+        return -1;
+      }
+
+      if (p->type != EXFAT_TYPE_STREAM)
+      {
+        // a damaged set, the entry may start the next one
+        if (!seekSet(curPosition_ - 32))
+        {
+          return -1;
+        }
+
+        continue;
+      }
+
+      uint32_t key = (uint32_t)p->stream.nameHash << 8 | p->stream.nameLength;
+
+      // only a name with the same hash and length is compared in full
+      for (uint16_t i = 0; i < count; i++)
+      {
+        if (list[i].attributes != 0XFF || list[i].size != key)
+        {
+          continue;
+        }
+
+        RP2040_SdFile f;
+        dir_t dir;
+        uint8_t length = exFatNameFromUtf8(names[i], name);
+
+        // read the set again from its file entry, no access mode only reads it
+        if (!seekSet(pos) || readDirCache() == NULL)
+        {
+          return -1;
+        }
+
+        int8_t rtn = f.exFatOpenSet(this, name, length, key >> 8, 0);
+
+        if (rtn < 0)
+        {
+          return -1;
+        }
+
+        if (rtn == 0)
+        {
+          continue;
+        }
+
+        if (!f.exFatDirEntry(&dir))
+        {
+          return -1;
+        }
+
+        dirInfoAdd(list + i, &dir, pos >> 5, 0, 0, NULL);
+        found++;
+        left--;
+      }
+    }
+
+    // names not in the directory
+    for (uint16_t i = 0; i < count; i++)
+    {
+      if (list[i].attributes == 0XFF)
+      {
+        list[i].attributes = 0;
+      }
+    }
+
+    return found;
+  }
+
+#endif  // SD_EXFAT
+
+  // the 8.3 name field of each name waits in list, attributes 0XFF until found
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (make83Name(names[i], (uint8_t*)list[i].name))
+    {
+      list[i].attributes = 0XFF;
+      left++;
+    }
+    else
+    {
+      list[i].name[0] = 0;
+      list[i].attributes = 0;
+    }
+  }
+
   rewind();
 
-  while (curPosition_ < fileSize_)
+  while (left && curPosition_ < fileSize_)
   {
-    RP2040_SdFile f;
-
-    // remember position
-    uint16_t index = curPosition_ / 32;
-
     dir_t* p = readDirCache();
 
-    if (!p)
+    if (p == NULL)
     {
-      return false;
+      return -1;
     }
 
-    // done if past last entry
+    // last entry if DIR_NAME_FREE
     if (p->name[0] == DIR_NAME_FREE)
     {
       break;
     }
 
-    // skip empty slot or '.' or '..'
-    if (p->name[0] == DIR_NAME_DELETED || p->name[0] == '.')
-    {
-      continue;
-    }
-
-    // skip if part of long file name or volume label in root
-    if (!DIR_IS_FILE_OR_SUBDIR(p))
+    if (p->name[0] == DIR_NAME_DELETED || !DIR_IS_FILE_OR_SUBDIR(p))
     {
       continue;
     }
 
-    if (!f.open(this, index, O_READ))
-    {
-      return false;
-    }
-
-    if (f.isSubDir())
-    {
-      // recursively delete
-      if (!f.rmRfStar())
-      {
-        return false;
-      }
-    }
-    else
+    for (uint16_t i = 0; i < count; i++)
     {
-      // ignore read-only
-      f.flags_ |= O_WRITE;
-
-      if (!f.remove())
+      if (list[i].attributes == 0XFF && p->name[0] == (uint8_t)list[i].name[0] &&
+          !memcmp(p->name, list[i].name, 11))
       {
-        return false;
-      }
-    }
+        if (dirInfoAdd(list + i, p, (curPosition_ >> 5) - 1, 0, 0, NULL))
+        {
+          found++;
+        }
 
-    // position to next entry if required
-    if (curPosition_ != (32u * (index + 1)))
-    {
-      if (!seekSet(32u * (index + 1)))
-      {
-        return false;
+        left--;
       }
     }
   }
 
-  // don't try to delete root
-  if (isRoot())
-  {
-    return true;
-  }
-
-  return rmDir();
-}
-//------------------------------------------------------------------------------
-/**
-   Sets a file's position.
-
-   \param[in] pos The new position in bytes from the beginning of the file.
-
-   \return The value one, true, is returned for success and
-   the value zero, false, is returned for failure.
-*/
-uint8_t RP2040_SdFile::seekSet(uint32_t pos)
-{
-  // error if file not open or seek past end of file
-  if (!isOpen() || pos > fileSize_)
-  {
-    return false;
-  }
-
-  if (type_ == FAT_FILE_TYPE_ROOT16)
-  {
-    curPosition_ = pos;
-    return true;
-  }
-
-  if (pos == 0)
-  {
-    // set position to start of file
-    curCluster_ = 0;
-    curPosition_ = 0;
-    return true;
-  }
-
-  // calculate cluster index for cur and new position
-  uint32_t nCur = (curPosition_ - 1) >> (vol_->clusterSizeShift_ + 9);
-  uint32_t nNew = (pos - 1) >> (vol_->clusterSizeShift_ + 9);
-
-  if (nNew < nCur || curPosition_ == 0)
-  {
-    // must follow chain from first cluster
-    curCluster_ = firstCluster_;
-  }
-  else
-  {
-    // advance from curPosition
-    nNew -= nCur;
-  }
-
-  while (nNew--)
+  // names not in the directory
+  for (uint16_t i = 0; i < count; i++)
   {
-    if (!vol_->fatGet(curCluster_, &curCluster_))
+    if (list[i].attributes == 0XFF)
     {
-      return false;
+      list[i].name[0] = 0;
+      list[i].attributes = 0;
     }
   }
 
-  curPosition_ = pos;
-
-  return true;
+  return found;
 }
 //------------------------------------------------------------------------------
 /**
@@ -1429,6 +3340,21 @@ uint8_t RP2040_SdFile::sync(uint8_t blocking)
     return false;
   }
 
+#if SD_EXFAT
+
+  if ((flags_ & F_FILE_DIR_DIRTY) && vol_->fatType() == 64)
+  {
+    if (!exFatSync())
+    {
+      return false;
+    }
+
+    // clear directory dirty
+    flags_ &= ~F_FILE_DIR_DIRTY;
+  }
+
+#endif  // SD_EXFAT
+
   if (flags_ & F_FILE_DIR_DIRTY)
   {
     dir_t* d = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_WRITE);
@@ -1464,7 +3390,21 @@ uint8_t RP2040_SdFile::sync(uint8_t blocking)
     flags_ &= ~F_FILE_NON_BLOCKING_WRITE;
   }
 
-  return RP2040_SdVolume::cacheFlush(blocking);
+  if (blocking)
+  {
+    // update FSINFO free count and next free hint
+    if (!vol_->fsInfoSync())
+    {
+      return false;
+    }
+
+#if SD_FAT_MIRROR_MODE == 1
+    // write deferred second FAT blocks
+    return vol_->sync();
+#endif
+  }
+
+  return vol_->cacheFlush(blocking);
 }
 
 //------------------------------------------------------------------------------
@@ -1511,6 +3451,47 @@ uint8_t RP2040_SdFile::timestamp(uint8_t flags, uint16_t year, uint8_t month, ui
     return false;
   }
 
+  uint16_t dirDate = FAT_DATE(year, month, day);
+  uint16_t dirTime = FAT_TIME(hour, minute, second);
+
+#if SD_EXFAT
+
+  if (vol_->fatType() == 64)
+  {
+    exdir_t* x = isRoot() ? NULL : exFatCacheEntry(0, RP2040_SdVolume::CACHE_FOR_WRITE);
+
+    if (!x)
+    {
+      return false;
+    }
+
+    uint32_t stamp = (uint32_t)dirDate << 16 | dirTime;
+
+    if (flags & T_ACCESS)
+    {
+      x->file.accessTimestamp = stamp;
+    }
+
+    if (flags & T_CREATE)
+    {
+      x->file.createTimestamp = stamp;
+      x->file.create10ms = second & 1 ? 100 : 0;
+    }
+
+    if (flags & T_WRITE)
+    {
+      x->file.modifyTimestamp = stamp;
+      x->file.modify10ms = second & 1 ? 100 : 0;
+    }
+
+    // sync() updates the set checksum
+    flags_ |= F_FILE_DIR_DIRTY;
+
+    return sync();
+  }
+
+#endif  // SD_EXFAT
+
   dir_t* d = cacheDirEntry(RP2040_SdVolume::CACHE_FOR_WRITE);
 
   if (!d)
@@ -1518,9 +3499,6 @@ uint8_t RP2040_SdFile::timestamp(uint8_t flags, uint16_t year, uint8_t month, ui
     return false;
   }
 
-  uint16_t dirDate = FAT_DATE(year, month, day);
-  uint16_t dirTime = FAT_TIME(hour, minute, second);
-
   if (flags & T_ACCESS)
   {
     d->lastAccessDate = dirDate;
@@ -1540,7 +3518,7 @@ uint8_t RP2040_SdFile::timestamp(uint8_t flags, uint16_t year, uint8_t month, ui
     d->lastWriteTime = dirTime;
   }
 
-  RP2040_SdVolume::cacheSetDirty();
+  vol_->cacheSetDirty();
 
   return sync();
 }
@@ -1571,8 +3549,12 @@ uint8_t RP2040_SdFile::truncate(uint32_t length)
     return false;
   }
 
-  // fileSize and length are zero - nothing to do
-  if (fileSize_ == 0)
+  // clusters past length are released
+  allocTail_ = false;
+  atPosition_ = 0;
+
+  // fileSize and length are zero and no cluster allocated - nothing to do
+  if (fileSize_ == 0 && firstCluster_ == 0)
   {
     return true;
   }
@@ -1586,6 +3568,31 @@ uint8_t RP2040_SdFile::truncate(uint32_t length)
     return false;
   }
 
+#if SD_EXFAT
+
+  if (exFlags_ & EXFAT_FLAG_NO_FAT_CHAIN)
+  {
+    // release clusters past the new end in the allocation bitmap
+    uint32_t keep = length ? ((length - 1) >> (vol_->clusterSizeShift_ + 9)) + 1 : 0;
+
+    if (keep < exClusters_ && !vol_->exFatBitmapPut(firstCluster_ + keep, exClusters_ - keep, 0))
+    {
+      return false;
+    }
+
+    exClusters_ = keep;
+
+    if (keep == 0)
+    {
+      firstCluster_ = 0;
+    }
+
+#if SD_FILE_EXTENTS
+    extentTrim(keep);
+#endif
+  }
+  else
+#endif  // SD_EXFAT
   if (length == 0)
   {
     // free all clusters
@@ -1595,6 +3602,10 @@ uint8_t RP2040_SdFile::truncate(uint32_t length)
     }
 
     firstCluster_ = 0;
+
+#if SD_FILE_EXTENTS
+    extentReset();
+#endif
   }
   else
   {
@@ -1618,6 +3629,11 @@ uint8_t RP2040_SdFile::truncate(uint32_t length)
       {
         return false;
       }
+
+#if SD_FILE_EXTENTS
+      // clusters past curCluster_ are gone
+      extentTrim(((length - 1) >> (vol_->clusterSizeShift_ + 9)) + 1);
+#endif
     }
   }
 
@@ -1678,18 +3694,27 @@ size_t RP2040_SdFile::write(const void* buf, uint16_t nbyte)
 
   while (nToWrite > 0)
   {
-    uint8_t blockOfCluster = vol_->blockOfCluster(curPosition_);
+    uint16_t blockOfCluster = vol_->blockOfCluster(curPosition_);
     uint16_t blockOffset = curPosition_ & 0X1FF;
 
     if (blockOfCluster == 0 && blockOffset == 0)
     {
+      // clusters to allocate if the file must grow, enough for the rest
+      // of the write and at least SD_ALLOC_CLUSTERS
+      uint32_t count = ((uint32_t)nToWrite + (512UL << vol_->clusterSizeShift_) - 1) >> (vol_->clusterSizeShift_ + 9);
+
+      if (count < SD_ALLOC_CLUSTERS)
+      {
+        count = SD_ALLOC_CLUSTERS;
+      }
+
       // start of new cluster
       if (curCluster_ == 0)
       {
         if (firstCluster_ == 0)
         {
           // allocate first cluster of file
-          if (!addCluster())
+          if (!addCluster(count))
           {
             goto writeErrorReturn;
           }
@@ -1702,19 +3727,24 @@ size_t RP2040_SdFile::write(const void* buf, uint16_t nbyte)
       else
       {
         uint32_t next;
+        uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
 
-        if (!vol_->fatGet(curCluster_, &next))
+        if (!nextCluster(index, &next))
         {
           return false;
         }
 
         if (vol_->isEOC(next))
         {
-          // add cluster if at end of chain
-          if (!addCluster())
+          // add clusters if at end of chain
+          if (!addCluster(count))
           {
             goto writeErrorReturn;
           }
+
+#if SD_FILE_EXTENTS
+          extentAdd(index, curCluster_);
+#endif
         }
         else
         {
@@ -1723,6 +3753,100 @@ size_t RP2040_SdFile::write(const void* buf, uint16_t nbyte)
       }
     }
 
+    // block for data write
+    uint32_t block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
+
+    // use a multiple block write if two or more whole blocks are to be written
+    if (blocking && blockOffset == 0 && nToWrite >= 1024)
+    {
+      // number of whole blocks to write
+      uint16_t nb = nToWrite >> 9;
+
+      // number of contiguous blocks starting at block
+      uint16_t run = vol_->blocksPerCluster_ - blockOfCluster;
+
+      // file cluster index of curCluster_
+      uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
+
+      // extend run while next cluster follows current cluster
+      while (run < nb)
+      {
+        uint32_t next;
+
+        if (!nextCluster(++index, &next))
+        {
+          goto writeErrorReturn;
+        }
+
+        if (vol_->isEOC(next))
+        {
+          uint8_t used;
+
+          // only add a cluster if it will be contiguous
+          if (!vol_->clusterUsed(curCluster_ + 1, &used) || used)
+          {
+            break;
+          }
+
+          if (!addCluster())
+          {
+            goto writeErrorReturn;
+          }
+
+#if SD_FILE_EXTENTS
+          extentAdd(index, curCluster_);
+#endif
+        }
+        else if (next == (curCluster_ + 1))
+        {
+          curCluster_ = next;
+        }
+        else
+        {
+          break;
+        }
+
+        run += vol_->blocksPerCluster_;
+      }
+
+      if (run > nb)
+      {
+        run = nb;
+      }
+
+      if (run > 1)
+      {
+        // invalidate cache entries for blocks in the run
+        vol_->cacheInvalidate(block, run);
+
+        // pre-erase run blocks
+        if (!vol_->writeStart(block, run))
+        {
+          goto writeErrorReturn;
+        }
+
+        for (uint16_t i = 0; i < run; i++)
+        {
+          if (!vol_->writeData(src))
+          {
+            goto writeErrorReturn;
+          }
+
+          src += 512;
+        }
+
+        if (!vol_->writeStop())
+        {
+          goto writeErrorReturn;
+        }
+
+        nToWrite -= 512 * run;
+        curPosition_ += 512UL * run;
+
+        continue;
+      }
+    }
+
     // max space in block
     uint16_t n = 512 - blockOffset;
 
@@ -1732,17 +3856,11 @@ size_t RP2040_SdFile::write(const void* buf, uint16_t nbyte)
       n = nToWrite;
     }
 
-    // block for data write
-    uint32_t block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
-
     if (n == 512)
     {
       // full block - don't need to use cache
       // invalidate cache if block is in cache
-      if (RP2040_SdVolume::cacheBlockNumber_ == block)
-      {
-        RP2040_SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-      }
+      vol_->cacheInvalidate(block);
 
       if (!vol_->writeBlock(block, src, blocking))
       {
@@ -1756,24 +3874,21 @@ size_t RP2040_SdFile::write(const void* buf, uint16_t nbyte)
       if (blockOffset == 0 && curPosition_ >= fileSize_)
       {
         // start of new block don't need to read into cache
-        if (!RP2040_SdVolume::cacheFlush())
+        if (!vol_->cacheRawBlock(block, RP2040_SdVolume::CACHE_RESERVE_FOR_WRITE))
         {
           goto writeErrorReturn;
         }
-
-        RP2040_SdVolume::cacheBlockNumber_ = block;
-        RP2040_SdVolume::cacheSetDirty();
       }
       else
       {
         // rewrite part of block
-        if (!RP2040_SdVolume::cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_WRITE))
+        if (!vol_->cacheRawBlock(block, RP2040_SdVolume::CACHE_FOR_WRITE))
         {
           goto writeErrorReturn;
         }
       }
 
-      uint8_t* dst = RP2040_SdVolume::cacheBuffer_.data + blockOffset;
+      uint8_t* dst = vol_->cacheAddress()->data + blockOffset;
       uint8_t* end = dst + n;
 
       while (dst != end)
@@ -1836,6 +3951,48 @@ size_t RP2040_SdFile::write(const char* str)
 {
   return write(str, strlen(str));
 }
+//------------------------------------------------------------------------------
+/**
+   Write data to a file at a given position without moving the file's
+   current position.  The O_APPEND flag does not apply, data at or after
+   \a pos is overwritten and the file grows if the write passes its end.
+
+   The cluster that holds \a pos is found as for readAt().
+
+   \param[in] pos The position in bytes from the beginning of the file, at
+   most the file size.
+
+   \param[in] buf Pointer to the location of the data to be written.
+
+   \param[in] nbyte Number of bytes to write.
+
+   \return For success writeAt() returns the number of bytes written, always
+   \a nbyte.  If an error occurs, writeAt() returns 0.  Possible errors
+   include \a pos is past the end of file and the errors of write().
+*/
+size_t RP2040_SdFile::writeAt(uint32_t pos, const void* buf, uint16_t nbyte)
+{
+  uint32_t position = curPosition_;
+  uint32_t cluster = curCluster_;
+  uint8_t append = flags_ & O_APPEND;
+  size_t n = 0;
+
+  if (seekAt(pos))
+  {
+    flags_ &= ~O_APPEND;
+    n = write(buf, nbyte);
+    flags_ |= append;
+  }
+  else
+  {
+    setWriteError();
+  }
+
+  curPosition_ = position;
+  curCluster_ = cluster;
+
+  return n;
+}
 
 //------------------------------------------------------------------------------
 /**
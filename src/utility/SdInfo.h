@@ -57,8 +57,10 @@ enum
   CMD8    = 0x08,     // SEND_IF_COND - verify SD Memory Card interface operating condition.
   CMD9    = 0x09,     // SEND_CSD - read the Card Specific Data (CSD register)
   CMD10   = 0x0A,     // SEND_CID - read the card identification information (CID register)
+  CMD12   = 0x0C,     // STOP_TRANSMISSION - end multiple block read sequence
   CMD13   = 0x0D,     // SEND_STATUS - read the card status register
   CMD17   = 0x11,     // READ_BLOCK - read a single data block from the card
+  CMD18   = 0x12,     // READ_MULTIPLE_BLOCK - read blocks of data until a STOP_TRANSMISSION
   CMD24   = 0x18,     // WRITE_BLOCK - write a single data block to the card
   CMD25   = 0x19,     // WRITE_MULTIPLE_BLOCK - write blocks of data until a STOP_TRANSMISSION
   CMD32   = 0x20,     // ERASE_WR_BLK_START - sets the address of the first block to be erased
@@ -33,18 +33,19 @@
 
 #include "SdFat.h"
 
-//------------------------------------------------------------------------------
-// raw block cache
-// init cacheBlockNumber_to invalid SD block number
-uint32_t RP2040_SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-cache_t  RP2040_SdVolume::cacheBuffer_;                           // 512 byte cache for Sd2Card
-Sd2Card* RP2040_SdVolume::sdCard_;                                // pointer to SD card object
-uint8_t  RP2040_SdVolume::cacheDirty_ = 0;                        // cacheFlush() will write block if true
-uint32_t RP2040_SdVolume::cacheMirrorBlock_ = 0;                  // mirror  block for second FAT
+// the only definitions of the option symbols, see SD_CONFIG_CHECK
+SD_CONFIG_DEFINE(CacheBlocks, SD_CACHE_BLOCKS);
+SD_CONFIG_DEFINE(FatCacheBlocks, SD_FAT_CACHE_BLOCKS);
+SD_CONFIG_DEFINE(FreeBitmapBytes, SD_FREE_BITMAP_BYTES);
+SD_CONFIG_DEFINE(DirIndexEntries, SD_DIR_INDEX_ENTRIES);
 
 //------------------------------------------------------------------------------
-// find a contiguous group of clusters
-uint8_t RP2040_SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster)
+// find a contiguous group of clusters, link is false for an exFAT NoFatChain
+// run that is only recorded in the allocation bitmap.  If allocated is not
+// null a shorter run that ends at a cluster in use is taken and its length
+// returned in allocated, so the run starts at the first free cluster found
+uint8_t RP2040_SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster, uint8_t link,
+                                         uint32_t* allocated)
 {
   // start of group
   uint32_t bgnCluster;
@@ -63,279 +64,1584 @@ uint8_t RP2040_SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster)
   }
   else
   {
-    // start at likely place for free cluster
-    bgnCluster = allocSearchStart_;
-
-    // save next search start if one cluster
-    setStart = 1 == count;
+    // start at likely place for free cluster
+    bgnCluster = allocSearchStart_;
+
+    // save next search start if no free cluster can be skipped
+    setStart = 1 == count || allocated;
+  }
+
+  // end of group
+  uint32_t endCluster = bgnCluster;
+
+  // last cluster of FAT
+  uint32_t fatEnd = clusterCount_ + 1;
+
+#if SD_FREE_BITMAP_BYTES
+  // last cluster of a group is (cluster | groupMask)
+  uint32_t groupMask = (1UL << freeBitmapShift_) - 1;
+
+  // group scan started at its first cluster and no free cluster seen yet
+  uint8_t groupWhole = (endCluster & groupMask) == 0;
+  uint8_t groupFree = false;
+#endif  // SD_FREE_BITMAP_BYTES
+
+  // search the FAT for free clusters
+  for (uint32_t n = 0;; n++, endCluster++)
+  {
+    // take a shorter run that ends at the last cluster checked
+    if (allocated && endCluster > bgnCluster && (n >= clusterCount_ || endCluster > fatEnd))
+    {
+      endCluster--;
+      break;
+    }
+
+    // can't find space checked all clusters
+    if (n >= clusterCount_)
+    {
+      return false;
+    }
+
+    // past end - start from beginning of FAT
+    if (endCluster > fatEnd)
+    {
+      bgnCluster = endCluster = 2;
+
+#if SD_FREE_BITMAP_BYTES
+      // clusters zero and one are reserved
+      groupWhole = true;
+      groupFree = false;
+#endif
+    }
+
+#if SD_FREE_BITMAP_BYTES
+
+    if (freeBitmapValid_)
+    {
+      if ((endCluster & groupMask) == 0)
+      {
+        groupWhole = true;
+        groupFree = false;
+      }
+
+      if (freeBitmapFull(endCluster))
+      {
+        if (allocated && endCluster > bgnCluster)
+        {
+          // take the shorter run before this group
+          endCluster--;
+          break;
+        }
+
+        // no free cluster in group - continue at start of next group
+        uint32_t skip = groupMask - (endCluster & groupMask);
+        n += skip;
+        endCluster += skip;
+        bgnCluster = endCluster + 1;
+        continue;
+      }
+    }
+
+#endif  // SD_FREE_BITMAP_BYTES
+
+    uint8_t used;
+
+    if (!clusterUsed(endCluster, &used))
+    {
+      return false;
+    }
+
+    if (used)
+    {
+      if (allocated && endCluster > bgnCluster)
+      {
+        // take the shorter run that ends here
+        endCluster--;
+        break;
+      }
+
+      // cluster in use try next cluster as bgnCluster
+      bgnCluster = endCluster + 1;
+    }
+    else if ((endCluster - bgnCluster + 1) == count)
+    {
+      // done - found space
+      break;
+    }
+
+#if SD_FREE_BITMAP_BYTES
+
+    if (!used)
+    {
+      groupFree = true;
+    }
+
+    if (freeBitmapValid_ && ((endCluster & groupMask) == groupMask || endCluster == fatEnd))
+    {
+      // whole group checked and in use
+      if (groupWhole && !groupFree)
+      {
+        freeBitmapSet(endCluster, true);
+      }
+
+      groupWhole = false;
+    }
+
+#endif  // SD_FREE_BITMAP_BYTES
+  }
+
+  if (allocated)
+  {
+    count = endCluster - bgnCluster + 1;
+    *allocated = count;
+  }
+
+#if SD_EXFAT
+
+  // exFAT records allocation in the bitmap, the FAT only holds chains
+  if (fatType_ == 64 && !exFatBitmapPut(bgnCluster, count, 1))
+  {
+    return false;
+  }
+
+#endif  // SD_EXFAT
+
+  if (link)
+  {
+    // mark end of chain
+    if (!fatPutEOC(endCluster))
+    {
+      return false;
+    }
+
+    // link clusters
+    while (endCluster > bgnCluster)
+    {
+      if (!fatPut(endCluster - 1, endCluster))
+      {
+        return false;
+      }
+
+      endCluster--;
+    }
+
+    if (*curCluster != 0)
+    {
+      // connect chains
+      if (!fatPut(*curCluster, bgnCluster))
+      {
+        return false;
+      }
+    }
+  }
+
+  // return first cluster number to caller
+  *curCluster = bgnCluster;
+
+  // remember possible next free cluster, past the run if a growing file
+  // took the cluster the search would start at
+  if (setStart || (allocSearchStart_ >= bgnCluster && allocSearchStart_ < bgnCluster + count))
+  {
+    allocSearchStart_ = bgnCluster + count;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// return the cache entry holding blockNumber or -1 if not cached
+int8_t RP2040_SdVolume::cacheFind(uint32_t blockNumber)
+{
+  // most lookups repeat the last block
+  if (cacheLastUse_[cacheIndex_] && cacheBlockNumber_[cacheIndex_] == blockNumber)
+  {
+    return cacheIndex_;
+  }
+
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++)
+  {
+    if (cacheLastUse_[i] && cacheBlockNumber_[i] == blockNumber)
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+//------------------------------------------------------------------------------
+// write all dirty entries and FAT blocks, a non-blocking flush starts at
+// most one write
+uint8_t RP2040_SdVolume::cacheFlush(uint8_t blocking)
+{
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++)
+  {
+    if (cacheDirty_[i])
+    {
+      if (!cacheFlushEntry(i, blocking))
+      {
+        return false;
+      }
+
+      if (!blocking)
+      {
+        return true;
+      }
+    }
+  }
+
+  return fatCacheFlush(blocking);
+}
+//------------------------------------------------------------------------------
+uint8_t RP2040_SdVolume::cacheFlushEntry(uint8_t i, uint8_t blocking)
+{
+  if (cacheDirty_[i])
+  {
+    if (!sdCard_->writeBlock(cacheBlockNumber_[i], cacheBuffer_[i].data, blocking))
+    {
+      return false;
+    }
+
+    if (!blocking)
+    {
+      return true;
+    }
+
+    cacheDirty_[i] = 0;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// drop cached copies of blocks that are about to be overwritten on the device
+void RP2040_SdVolume::cacheInvalidate(uint32_t firstBlock, uint32_t count)
+{
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++)
+  {
+    if (cacheBlockNumber_[i] >= firstBlock && (cacheBlockNumber_[i] - firstBlock) < count)
+    {
+      cacheBlockNumber_[i] = 0XFFFFFFFF;
+      cacheLastUse_[i] = 0;
+      cacheDirty_[i] = 0;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// write pending mirror FAT blocks, a non-blocking flush starts at most one write
+uint8_t RP2040_SdVolume::cacheMirrorBlockFlush(uint8_t blocking)
+{
+  for (uint8_t i = 0; i < fatCacheCount_; i++)
+  {
+    if (fatCacheMirror_ & (1UL << i))
+    {
+      if (!sdCard_->writeBlock(fatCacheBlock_ + fatCacheMirrorOffset_ + i, fatCache_[i].data, blocking))
+      {
+        return false;
+      }
+
+      fatCacheMirror_ &= ~(1UL << i);
+
+      if (!blocking)
+      {
+        return true;
+      }
+    }
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// make blockNumber the current cache entry, reusing the least recently
+// used entry on a miss
+uint8_t RP2040_SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action)
+{
+  int8_t i = cacheFind(blockNumber);
+
+  if (i >= 0)
+  {
+    cacheHits_++;
+  }
+  else
+  {
+    cacheMisses_++;
+
+    // pick a free entry or the least recently used one
+    i = 0;
+
+    for (uint8_t j = 1; j < SD_CACHE_BLOCKS; j++)
+    {
+      if (cacheLastUse_[j] < cacheLastUse_[i])
+      {
+        i = j;
+      }
+    }
+
+    if (!cacheFlushEntry(i))
+    {
+      return false;
+    }
+
+    // entry is free until the read succeeds
+    cacheLastUse_[i] = 0;
+
+    if (!(action & CACHE_OPTION_NO_READ))
+    {
+      if (!sdCard_->readBlock(blockNumber, cacheBuffer_[i].data))
+      {
+        return false;
+      }
+    }
+
+    cacheBlockNumber_[i] = blockNumber;
+  }
+
+  cacheIndex_ = i;
+  cacheLastUse_[i] = ++cacheUseCount_;
+  cacheDirty_[i] |= action & CACHE_FOR_WRITE;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// cache a zero block for blockNumber
+uint8_t RP2040_SdVolume::cacheZeroBlock(uint32_t blockNumber)
+{
+  if (!cacheRawBlock(blockNumber, CACHE_RESERVE_FOR_WRITE))
+  {
+    return false;
+  }
+
+  // loop take less flash than memset(p, 0, 512);
+  uint8_t* p = cacheBuffer_[cacheIndex_].data;
+
+  for (uint16_t i = 0; i < 512; i++)
+  {
+    p[i] = 0;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// return the size in bytes of a cluster chain
+uint8_t RP2040_SdVolume::chainSize(uint32_t cluster, uint32_t* size)
+{
+  uint32_t s = 0;
+
+  do
+  {
+    if (!fatGet(cluster, &cluster))
+    {
+      return false;
+    }
+
+    s += 512UL << clusterSizeShift_;
+  } while (!isEOC(cluster));
+
+  *size = s;
+  return true;
+}
+//------------------------------------------------------------------------------
+// set *used true if cluster is allocated
+uint8_t RP2040_SdVolume::clusterUsed(uint32_t cluster, uint8_t* used)
+{
+#if SD_EXFAT
+
+  if (fatType_ == 64)
+  {
+    return exFatBitmapGet(cluster, used);
+  }
+
+#endif  // SD_EXFAT
+
+  uint32_t f;
+
+  if (!fatGet(cluster, &f))
+  {
+    return false;
+  }
+
+  *used = f != 0;
+
+  return true;
+}
+#if SD_DIR_INDEX_ENTRIES
+//------------------------------------------------------------------------------
+// FNV-1a hash of an 8.3 name folded to 16 bits
+static uint16_t dirIndexHash(const uint8_t* name)
+{
+  uint32_t h = 2166136261UL;
+
+  for (uint8_t i = 0; i < 11; i++)
+  {
+    h = (h ^ name[i]) * 16777619UL;
+  }
+
+  return h ^ (h >> 16);
+}
+//------------------------------------------------------------------------------
+// add a named entry while the index is built, return false if it is full
+uint8_t RP2040_SdVolume::dirIndexAdd(const uint8_t* name, uint32_t block, uint8_t index)
+{
+  if (dirIndexCount_ >= SD_DIR_INDEX_ENTRIES)
+  {
+    return false;
+  }
+
+  dirindex_t* e = &dirIndexTable_[dirIndexCount_++];
+  e->block = block;
+  e->hash = dirIndexHash(name);
+  e->index = index;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// record an entry created in directory key and move the free entry past it
+void RP2040_SdVolume::dirIndexCreate(uint32_t key, const uint8_t* name,
+                                     uint32_t block, uint8_t index)
+{
+  if (dirIndexKey_ != key)
+  {
+    return;
+  }
+
+  if (!dirIndexAdd(name, block, index))
+  {
+    dirIndexKey_ = 0;
+    return;
+  }
+
+  // no free entry means the directory was full and block is a new cluster
+  uint8_t tail = dirIndexFreeBlock_ == 0 || dirIndexFreeTail_;
+
+  if (dirIndexFreeBlock_ && (dirIndexFreeBlock_ != block || dirIndexFreeIndex_ != index))
+  {
+    return;
+  }
+
+  dirIndexFreeBlock_ = 0;
+
+  if (!tail)
+  {
+    // a reused deleted entry, the next free entry is not known
+    return;
+  }
+
+  if (index < 15)
+  {
+    dirIndexFreeBlock_ = block;
+    dirIndexFreeIndex_ = index + 1;
+    return;
+  }
+
+  // first entry of the next block if it is in the same cluster or FAT16 root
+  if (key == 1)
+  {
+    if (block + 1 < rootDirStart_ + (rootDirEntryCount_ >> 4))
+    {
+      dirIndexFreeBlock_ = block + 1;
+    }
+  }
+  else if ((block + 1 - dataStartBlock_) & (blocksPerCluster_ - 1))
+  {
+    dirIndexFreeBlock_ = block + 1;
+  }
+
+  dirIndexFreeIndex_ = 0;
+}
+//------------------------------------------------------------------------------
+// look up name in directory key, return -1 if key is not indexed, zero if
+// name is not in the directory or one with its block cached and *index set
+int8_t RP2040_SdVolume::dirIndexFind(uint32_t key, const uint8_t* name, uint8_t* index)
+{
+  if (key == 0 || dirIndexKey_ != key)
+  {
+    return -1;
+  }
+
+  uint16_t h = dirIndexHash(name);
+
+  for (uint16_t i = 0; i < dirIndexCount_; i++)
+  {
+    dirindex_t* e = &dirIndexTable_[i];
+
+    if (e->hash != h)
+    {
+      continue;
+    }
+
+    if (!cacheRawBlock(e->block, CACHE_FOR_READ))
+    {
+      return -1;
+    }
+
+    if (!memcmp(name, cacheBuffer_[cacheIndex_].dir[e->index].name, 11))
+    {
+      *index = e->index;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+// cache the first free entry of the indexed directory, false if not known
+uint8_t RP2040_SdVolume::dirIndexFree(uint32_t* block, uint8_t* index)
+{
+  if (dirIndexFreeBlock_ == 0 || !cacheRawBlock(dirIndexFreeBlock_, CACHE_FOR_READ))
+  {
+    return false;
+  }
+
+  uint8_t c = cacheBuffer_[cacheIndex_].dir[dirIndexFreeIndex_].name[0];
+
+  if (c != DIR_NAME_FREE && c != DIR_NAME_DELETED)
+  {
+    // directory changed behind the index
+    dirIndexKey_ = 0;
+    return false;
+  }
+
+  *block = dirIndexFreeBlock_;
+  *index = dirIndexFreeIndex_;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// drop a deleted entry from the index
+void RP2040_SdVolume::dirIndexRemove(uint32_t block, uint8_t index)
+{
+  if (dirIndexKey_ == 0)
+  {
+    return;
+  }
+
+  for (uint16_t i = 0; i < dirIndexCount_; i++)
+  {
+    if (dirIndexTable_[i].block == block && dirIndexTable_[i].index == index)
+    {
+      dirIndexTable_[i] = dirIndexTable_[--dirIndexCount_];
+
+      if (dirIndexFreeBlock_ == 0)
+      {
+        dirIndexFreeBlock_ = block;
+        dirIndexFreeIndex_ = index;
+        dirIndexFreeTail_ = false;
+      }
+
+      return;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// index built by a complete scan of directory key
+void RP2040_SdVolume::dirIndexSet(uint32_t key, uint32_t freeBlock,
+                                  uint8_t freeIndex, uint8_t freeTail)
+{
+  dirIndexKey_ = key;
+  dirIndexFreeBlock_ = freeBlock;
+  dirIndexFreeIndex_ = freeIndex;
+  dirIndexFreeTail_ = freeTail;
+}
+#endif  // SD_DIR_INDEX_ENTRIES
+#if SD_EXFAT
+//------------------------------------------------------------------------------
+// set *used true if the exFAT allocation bitmap marks cluster in use
+uint8_t RP2040_SdVolume::exFatBitmapGet(uint32_t cluster, uint8_t* used)
+{
+  if (cluster < 2 || cluster > (clusterCount_ + 1))
+  {
+    return false;
+  }
+
+  // bit zero of the bitmap is cluster two
+  cluster -= 2;
+
+  if (!cacheRawBlock(exBitmapStartBlock_ + (cluster >> 12), CACHE_FOR_READ))
+  {
+    return false;
+  }
+
+  *used = (cacheAddress()->data[(cluster >> 3) & 511] >> (cluster & 7)) & 1;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// mark count clusters starting at cluster used or free in the exFAT
+// allocation bitmap
+uint8_t RP2040_SdVolume::exFatBitmapPut(uint32_t cluster, uint32_t count, uint8_t used)
+{
+  if (cluster < 2 || cluster > (clusterCount_ + 1) || count > (clusterCount_ + 2 - cluster))
+  {
+    return false;
+  }
+
+  cluster -= 2;
+
+  for (; count; count--, cluster++)
+  {
+    if (!cacheRawBlock(exBitmapStartBlock_ + (cluster >> 12), CACHE_FOR_WRITE))
+    {
+      return false;
+    }
+
+    uint8_t* p = &cacheAddress()->data[(cluster >> 3) & 511];
+    uint8_t mask = 1 << (cluster & 7);
+
+    if (((*p & mask) != 0) == (used != 0))
+    {
+      continue;
+    }
+
+    *p ^= mask;
+
+    // track free cluster count
+    if (freeClusters_ != 0XFFFFFFFF)
+    {
+      if (used)
+      {
+        freeClusters_--;
+      }
+      else
+      {
+        freeClusters_++;
+      }
+    }
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// count free clusters with one streaming pass over the exFAT allocation bitmap
+int32_t RP2040_SdVolume::exFatFreeClusterCount()
+{
+  // the card must have any bitmap blocks changed in the cache
+  if (!cacheFlush())
+  {
+    return -1;
+  }
+
+  // use the FAT window as the read buffer
+  if (!fatCacheFlush())
+  {
+    return -1;
+  }
+
+  fatCacheCount_ = 0;
+
+  uint32_t nb = (clusterCount_ + 4095) >> 12;
+  uint32_t used = 0;
+  cache_t* pc = &fatCache_[0];
+
+  if (!sdCard_->readStart(exBitmapStartBlock_))
+  {
+    return -1;
+  }
+
+  for (uint32_t b = 0; b < nb; b++)
+  {
+    if (!sdCard_->readData(pc->data))
+    {
+      return -1;
+    }
+
+    // bits in the final block past the last cluster are ignored
+    uint32_t bits = clusterCount_ - (b << 12);
+
+    for (uint8_t i = 0; i < 128 && bits; i++)
+    {
+      uint32_t w = pc->fat32[i];
+
+      if (bits < 32)
+      {
+        w &= (1UL << bits) - 1;
+        bits = 0;
+      }
+      else
+      {
+        bits -= 32;
+      }
+
+      used += __builtin_popcount(w);
+    }
+  }
+
+  if (!sdCard_->readStop())
+  {
+    return -1;
+  }
+
+  freeClusters_ = clusterCount_ - used;
+
+  return freeClusters_;
+}
+//------------------------------------------------------------------------------
+// free an exFAT cluster chain, only the allocation bitmap is changed
+uint8_t RP2040_SdVolume::exFatFreeChain(uint32_t cluster)
+{
+  // clear runs of contiguous clusters with one bitmap update
+  uint32_t bgn = cluster;
+  uint32_t count = 0;
+
+  do
+  {
+    uint32_t next;
+
+    if (!fatGet(cluster, &next))
+    {
+      return false;
+    }
+
+    count++;
+
+    // the next search starts at the lowest free cluster it may have skipped
+    if (cluster < allocSearchStart_)
+    {
+      allocSearchStart_ = cluster;
+    }
+
+    if (next != (cluster + 1))
+    {
+      if (!exFatBitmapPut(bgn, count, 0))
+      {
+        return false;
+      }
+
+      bgn = next;
+      count = 0;
+    }
+
+    cluster = next;
+  } while (!isEOC(cluster));
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// mount the exFAT volume whose boot sector is in the cache
+uint8_t RP2040_SdVolume::exFatInit(uint32_t volumeStartBlock)
+{
+  exfbs_t* fbs = &cacheAddress()->exfbs;
+
+  // only 512 byte sectors, cluster size must fit blocksPerCluster_ and
+  // cluster numbers must stay below the FAT32 end of chain values
+  if (fbs->bytesPerSectorShift != 9 || fbs->sectorsPerClusterShift > 15 || fbs->numberOfFats == 0
+      || fbs->clusterCount == 0 || fbs->clusterCount > (FAT32EOC_MIN - 3))
+  {
+    return false;
+  }
+
+  // select the active FAT and bitmap of a TexFAT volume
+  uint8_t activeFat = fbs->numberOfFats > 1 && (fbs->volumeFlags & EXFAT_VOLUME_FLAG_ACTIVE_FAT);
+
+  fatType_ = 64;
+  fatCount_ = 1;
+  clusterSizeShift_ = fbs->sectorsPerClusterShift;
+  blocksPerCluster_ = 1 << clusterSizeShift_;
+  blocksPerFat_ = fbs->fatLength;
+  fatStartBlock_ = volumeStartBlock + fbs->fatOffset + activeFat * blocksPerFat_;
+  dataStartBlock_ = volumeStartBlock + fbs->clusterHeapOffset;
+  clusterCount_ = fbs->clusterCount;
+  rootDirEntryCount_ = 0;
+  rootDirStart_ = fbs->rootDirectoryCluster;
+
+  // fbs is not valid after this point, find the bitmap and up-case table
+  // in the root directory
+  uint32_t bitmapCluster = 0;
+  uint32_t bitmapLength = 0;
+  uint32_t upcaseCluster = 0;
+  exUpcaseLength_ = 0;
+
+  for (uint32_t cluster = rootDirStart_; !isEOC(cluster);)
+  {
+    for (uint16_t b = 0; b < blocksPerCluster_; b++)
+    {
+      if (!cacheRawBlock(clusterStartBlock(cluster) + b, CACHE_FOR_READ))
+      {
+        return false;
+      }
+
+      for (uint8_t i = 0; i < 16; i++)
+      {
+        exsystem_t* p = &cacheAddress()->exdir[i].system;
+
+        if (p->type == EXFAT_TYPE_END_OF_DIR)
+        {
+          goto done;
+        }
+
+        if (p->type == EXFAT_TYPE_BITMAP && (p->flags & 1) == activeFat)
+        {
+          bitmapCluster = p->firstCluster;
+          bitmapLength = p->dataLength;
+        }
+        else if (p->type == EXFAT_TYPE_UPCASE)
+        {
+          upcaseCluster = p->firstCluster;
+          exUpcaseLength_ = p->dataLength;
+        }
+      }
+    }
+
+    if (!fatGet(cluster, &cluster))
+    {
+      return false;
+    }
+  }
+
+done:
+
+  if (bitmapLength < ((clusterCount_ + 7) >> 3) || exUpcaseLength_ < 2)
+  {
+    return false;
+  }
+
+  // the bitmap and up-case table are addressed as contiguous block ranges
+  uint32_t lengths[2] = {bitmapLength, exUpcaseLength_};
+  uint32_t clusters[2] = {bitmapCluster, upcaseCluster};
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    uint32_t n = ((lengths[i] - 1) >> (clusterSizeShift_ + 9)) + 1;
+
+    for (uint32_t c = clusters[i]; --n; c++)
+    {
+      uint32_t next;
+
+      if (!fatGet(c, &next) || next != (c + 1))
+      {
+        return false;
+      }
+    }
+  }
+
+  exBitmapStartBlock_ = clusterStartBlock(bitmapCluster);
+  exUpcaseStartBlock_ = clusterStartBlock(upcaseCluster);
+
+  // names are mostly ASCII so keep that part of the up-case table in RAM
+  for (uint8_t c = 0; c < 128; c++)
+  {
+    uint16_t u;
+
+    if (!exFatUpcaseLookup(c, &u))
+    {
+      return false;
+    }
+
+    exUpcase_[c] = u < 128 ? u : c;
+  }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+// up-case a UTF-16 code unit for exFAT name compare and name hash
+uint16_t RP2040_SdVolume::exFatUpcase(uint16_t c)
+{
+  if (c < 128)
+  {
+    return exUpcase_[c];
+  }
+
+  uint16_t u;
+
+  // a read error leaves the character unchanged, the next directory access
+  // will report the I/O error
+  return exFatUpcaseLookup(c, &u) ? u : c;
+}
+//------------------------------------------------------------------------------
+// find c in the compressed up-case table, a 0XFFFF entry is followed by the
+// length of a run of characters that map to themselves
+uint8_t RP2040_SdVolume::exFatUpcaseLookup(uint16_t c, uint16_t* u)
+{
+  // code point mapped by the next table entry
+  uint32_t cp = 0;
+  uint8_t identityRun = false;
+
+  for (uint32_t offset = 0; offset < exUpcaseLength_; offset += 2)
+  {
+    if ((offset & 511) == 0 && !cacheRawBlock(exUpcaseStartBlock_ + (offset >> 9), CACHE_FOR_READ))
+    {
+      return false;
+    }
+
+    uint16_t v = cacheAddress()->fat16[(offset >> 1) & 0XFF];
+
+    if (identityRun)
+    {
+      cp += v;
+      identityRun = false;
+
+      if (cp > c)
+      {
+        break;
+      }
+    }
+    else if (v == 0XFFFF)
+    {
+      identityRun = true;
+    }
+    else if (cp++ == c)
+    {
+      *u = v;
+      return true;
+    }
+  }
+
+  // not in table or in a run of unchanged characters
+  *u = c;
+
+  return true;
+}
+#endif  // SD_EXFAT
+
+//------------------------------------------------------------------------------
+// return the FAT window block for lba, loading the window if lba is not in it
+cache_t* RP2040_SdVolume::fatCacheBlock(uint32_t lba, uint8_t action)
+{
+  uint32_t i = lba - fatCacheBlock_;
+
+  if (lba >= fatCacheBlock_ && i < fatCacheCount_)
+  {
+    fatCacheHits_++;
+  }
+  else
+  {
+    fatCacheMisses_++;
+
+    if (!fatCacheFlush())
+    {
+      return 0;
+    }
+
+    // align the window in the FAT and stop at the end of the first FAT
+    uint32_t first = lba - (lba - fatStartBlock_) % SD_FAT_CACHE_BLOCKS;
+    uint32_t n = fatStartBlock_ + blocksPerFat_ - first;
+
+    if (n > SD_FAT_CACHE_BLOCKS)
+    {
+      n = SD_FAT_CACHE_BLOCKS;
+    }
+
+    // window is empty until the read succeeds
+    fatCacheCount_ = 0;
+
+    if (n == 1)
+    {
+      if (!sdCard_->readBlock(first, fatCache_[0].data))
+      {
+        return 0;
+      }
+    }
+    else
+    {
+      // fill the window with one multiple block read
+      if (!sdCard_->readStart(first))
+      {
+        return 0;
+      }
+
+      for (uint8_t j = 0; j < n; j++)
+      {
+        if (!sdCard_->readData(fatCache_[j].data))
+        {
+          return 0;
+        }
+      }
+
+      if (!sdCard_->readStop())
+      {
+        return 0;
+      }
+    }
+
+    fatCacheBlock_ = first;
+    fatCacheCount_ = n;
+    fatCacheMirrorOffset_ = fatCount_ > 1 ? blocksPerFat_ : 0;
+    i = lba - first;
+  }
+
+  if (action & CACHE_FOR_WRITE)
+  {
+    fatCacheDirty_ |= 1UL << i;
+
+    // mirror second FAT
+    if (fatCacheMirrorOffset_)
+    {
+#if SD_FAT_MIRROR_MODE
+      fatMirrorAdd(lba);
+#else
+      fatCacheMirror_ |= 1UL << i;
+#endif
+    }
+  }
+
+  return &fatCache_[i];
+}
+//------------------------------------------------------------------------------
+// write dirty FAT window blocks and their mirrors
+uint8_t RP2040_SdVolume::fatCacheFlush(uint8_t blocking)
+{
+  for (uint8_t i = 0; i < fatCacheCount_; i++)
+  {
+    if (fatCacheDirty_ & (1UL << i))
+    {
+      if (!sdCard_->writeBlock(fatCacheBlock_ + i, fatCache_[i].data, blocking))
+      {
+        return false;
+      }
+
+      if (!blocking)
+      {
+        return true;
+      }
+
+      fatCacheDirty_ &= ~(1UL << i);
+    }
+  }
+
+  return cacheMirrorBlockFlush(blocking);
+}
+//------------------------------------------------------------------------------
+// discard the FAT window
+void RP2040_SdVolume::fatCacheInvalidate()
+{
+  fatCacheCount_ = 0;
+  fatCacheDirty_ = 0;
+  fatCacheMirror_ = 0;
+  fatMirrorCount_ = 0;
+}
+//------------------------------------------------------------------------------
+// record a first FAT block whose mirror has not been written
+void RP2040_SdVolume::fatMirrorAdd(uint32_t lba)
+{
+  uint8_t i = 0;
+
+  // skip ranges that end before lba
+  while (i < fatMirrorCount_ && fatMirrorEnd_[i] < lba)
+  {
+    i++;
+  }
+
+  if (i < fatMirrorCount_ && fatMirrorBegin_[i] <= (lba + 1))
+  {
+    // lba is in or next to range i
+    if (lba < fatMirrorBegin_[i])
+    {
+      fatMirrorBegin_[i] = lba;
+    }
+    else if (lba == fatMirrorEnd_[i])
+    {
+      fatMirrorEnd_[i] = lba + 1;
+
+      // join next range if now touching
+      if ((i + 1) < fatMirrorCount_ && fatMirrorBegin_[i + 1] == fatMirrorEnd_[i])
+      {
+        fatMirrorEnd_[i] = fatMirrorEnd_[i + 1];
+        fatMirrorCount_--;
+
+        for (uint8_t j = i + 1; j < fatMirrorCount_; j++)
+        {
+          fatMirrorBegin_[j] = fatMirrorBegin_[j + 1];
+          fatMirrorEnd_[j] = fatMirrorEnd_[j + 1];
+        }
+      }
+    }
+
+    return;
+  }
+
+  // insert new range at i, there is always room for one extra range
+  for (uint8_t j = fatMirrorCount_; j > i; j--)
+  {
+    fatMirrorBegin_[j] = fatMirrorBegin_[j - 1];
+    fatMirrorEnd_[j] = fatMirrorEnd_[j - 1];
+  }
+
+  fatMirrorBegin_[i] = lba;
+  fatMirrorEnd_[i] = lba + 1;
+
+  if (++fatMirrorCount_ <= SD_FAT_MIRROR_RANGES)
+  {
+    return;
+  }
+
+  // list is full, join the two ranges with the smallest gap.  Copying the
+  // unchanged blocks between them is harmless.
+  i = 0;
+
+  for (uint8_t j = 1; (j + 1) < fatMirrorCount_; j++)
+  {
+    if ((fatMirrorBegin_[j + 1] - fatMirrorEnd_[j]) < (fatMirrorBegin_[i + 1] - fatMirrorEnd_[i]))
+    {
+      i = j;
+    }
+  }
+
+  fatMirrorEnd_[i] = fatMirrorEnd_[i + 1];
+  fatMirrorCount_--;
+
+  for (uint8_t j = i + 1; j < fatMirrorCount_; j++)
+  {
+    fatMirrorBegin_[j] = fatMirrorBegin_[j + 1];
+    fatMirrorEnd_[j] = fatMirrorEnd_[j + 1];
+  }
+}
+//------------------------------------------------------------------------------
+// copy deferred first FAT ranges to the second FAT using the FAT window as
+// the buffer and multiple block transfers
+uint8_t RP2040_SdVolume::fatMirrorFlush()
+{
+  // the first FAT must be current before it is copied
+  if (!fatCacheFlush())
+  {
+    return false;
   }
 
-  // end of group
-  uint32_t endCluster = bgnCluster;
-
-  // last cluster of FAT
-  uint32_t fatEnd = clusterCount_ + 1;
-
-  // search the FAT for free clusters
-  for (uint32_t n = 0;; n++, endCluster++)
+  while (fatMirrorCount_)
   {
-    // can't find space checked all clusters
-    if (n >= clusterCount_)
-    {
-      return false;
-    }
+    uint32_t block = fatMirrorBegin_[0];
+    uint32_t n = fatMirrorEnd_[0] - block;
 
-    // past end - start from beginning of FAT
-    if (endCluster > fatEnd)
+    if (n > SD_FAT_CACHE_BLOCKS)
     {
-      bgnCluster = endCluster = 2;
+      n = SD_FAT_CACHE_BLOCKS;
     }
 
-    uint32_t f;
+    uint8_t first = 0;
 
-    if (!fatGet(endCluster, &f))
+    if (block >= fatCacheBlock_ && (block + n) <= (fatCacheBlock_ + fatCacheCount_))
     {
-      return false;
+      // blocks are already in the window
+      first = block - fatCacheBlock_;
+    }
+    else
+    {
+      // window is empty until the read succeeds
+      fatCacheCount_ = 0;
+
+      if (n == 1)
+      {
+        if (!sdCard_->readBlock(block, fatCache_[0].data))
+        {
+          return false;
+        }
+      }
+      else
+      {
+        if (!sdCard_->readStart(block))
+        {
+          return false;
+        }
+
+        for (uint8_t j = 0; j < n; j++)
+        {
+          if (!sdCard_->readData(fatCache_[j].data))
+          {
+            return false;
+          }
+        }
+
+        if (!sdCard_->readStop())
+        {
+          return false;
+        }
+      }
+
+      fatCacheBlock_ = block;
+      fatCacheCount_ = n;
     }
 
-    if (f != 0)
+    if (n == 1)
     {
-      // cluster in use try next cluster as bgnCluster
-      bgnCluster = endCluster + 1;
+      if (!sdCard_->writeBlock(block + fatCacheMirrorOffset_, fatCache_[first].data))
+      {
+        return false;
+      }
     }
-    else if ((endCluster - bgnCluster + 1) == count)
+    else
     {
-      // done - found space
-      break;
+      if (!sdCard_->writeStart(block + fatCacheMirrorOffset_, n))
+      {
+        return false;
+      }
+
+      for (uint8_t j = 0; j < n; j++)
+      {
+        if (!sdCard_->writeData(fatCache_[first + j].data))
+        {
+          return false;
+        }
+      }
+
+      if (!sdCard_->writeStop())
+      {
+        return false;
+      }
+    }
+
+    // remove copied blocks from the list
+    fatMirrorBegin_[0] += n;
+
+    if (fatMirrorBegin_[0] == fatMirrorEnd_[0])
+    {
+      fatMirrorCount_--;
+
+      for (uint8_t j = 0; j < fatMirrorCount_; j++)
+      {
+        fatMirrorBegin_[j] = fatMirrorBegin_[j + 1];
+        fatMirrorEnd_[j] = fatMirrorEnd_[j + 1];
+      }
     }
   }
 
-  // mark end of chain
-  if (!fatPutEOC(endCluster))
+  return true;
+}
+//------------------------------------------------------------------------------
+// Fetch a FAT entry
+uint8_t RP2040_SdVolume::fatGet(uint32_t cluster, uint32_t* value)
+{
+  if (cluster > (clusterCount_ + 1))
+  {
+    return false;
+  }
+
+  uint32_t lba = fatStartBlock_;
+  lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+
+  cache_t* pc = fatCacheBlock(lba, CACHE_FOR_READ);
+
+  if (!pc)
   {
     return false;
   }
 
-  // link clusters
-  while (endCluster > bgnCluster)
+  if (fatType_ == 16)
   {
-    if (!fatPut(endCluster - 1, endCluster))
+    *value = pc->fat16[cluster & 0XFF];
+  }
+  else
+  {
+    // exFAT entries use all 32 bits
+    *value = pc->fat32[cluster & 0X7F];
+
+    if (fatType_ == 32)
     {
-      return false;
+      *value &= FAT32MASK;
     }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Store a FAT entry
+uint8_t RP2040_SdVolume::fatPut(uint32_t cluster, uint32_t value)
+{
+  // error if reserved cluster
+  if (cluster < 2)
+  {
+    return false;
+  }
 
-    endCluster--;
+  // error if not in FAT
+  if (cluster > (clusterCount_ + 1))
+  {
+    return false;
   }
 
-  if (*curCluster != 0)
+  // calculate block address for entry
+  uint32_t lba = fatStartBlock_;
+  lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+
+  cache_t* pc = fatCacheBlock(lba, CACHE_FOR_WRITE);
+
+  if (!pc)
   {
-    // connect chains
-    if (!fatPut(*curCluster, bgnCluster))
-    {
-      return false;
-    }
+    return false;
   }
 
-  // return first cluster number to caller
-  *curCluster = bgnCluster;
+  // store entry
+  uint32_t old;
 
-  // remember possible next free cluster
-  if (setStart)
+  if (fatType_ == 16)
   {
-    allocSearchStart_ = bgnCluster + 1;
+    old = pc->fat16[cluster & 0XFF];
+    pc->fat16[cluster & 0XFF] = value;
+  }
+  else
+  {
+    old = pc->fat32[cluster & 0X7F] & FAT32MASK;
+    pc->fat32[cluster & 0X7F] = value;
   }
 
-  return true;
-}
-//------------------------------------------------------------------------------
-uint8_t RP2040_SdVolume::cacheFlush(uint8_t blocking)
-{
-  if (cacheDirty_)
+  // track free cluster count, the exFAT count follows the allocation bitmap
+  if ((old == 0) != (value == 0) && freeClusters_ != 0XFFFFFFFF && fatType_ != 64)
   {
-    if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data, blocking))
+    if (value)
     {
-      return false;
+      freeClusters_--;
     }
-
-    if (!blocking)
+    else
     {
-      return true;
+      freeClusters_++;
     }
 
-    // mirror FAT tables
-    if (!cacheMirrorBlockFlush(blocking))
-    {
-      return false;
-    }
+    fsInfoDirty_ = true;
+  }
 
-    cacheDirty_ = 0;
+#if SD_FREE_BITMAP_BYTES
+
+  // a group with a free cluster is never marked full, a group of one
+  // cluster is full when its cluster is used
+  if (freeBitmapValid_ && (value == 0 || freeBitmapShift_ == 0))
+  {
+    freeBitmapSet(cluster, value != 0);
   }
 
+#endif  // SD_FREE_BITMAP_BYTES
+
   return true;
 }
+#if SD_FREE_BITMAP_BYTES
 //------------------------------------------------------------------------------
-uint8_t RP2040_SdVolume::cacheMirrorBlockFlush(uint8_t blocking)
+// build the free cluster bitmap with one streaming pass over the first FAT
+uint8_t RP2040_SdVolume::freeBitmapBuild()
 {
-  if (cacheMirrorBlock_)
+  uint32_t lastCluster = clusterCount_ + 1;
+
+  freeBitmapValid_ = false;
+
+  // smallest group size that fits in the bitmap
+  freeBitmapShift_ = 0;
+
+  while ((lastCluster >> freeBitmapShift_) >= (8UL * SD_FREE_BITMAP_BYTES))
   {
-    if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data, blocking))
-    {
-      return false;
-    }
+    freeBitmapShift_++;
+  }
+
+  // mark all groups full then clear groups with a free cluster
+  memset(freeBitmap_, 0XFF, sizeof(freeBitmap_));
 
-    cacheMirrorBlock_ = 0;
+  // use the FAT window as the read buffer
+  if (!fatCacheFlush())
+  {
+    return false;
   }
 
-  return true;
-}
-//------------------------------------------------------------------------------
-uint8_t RP2040_SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action)
-{
-  if (cacheBlockNumber_ != blockNumber)
+  fatCacheCount_ = 0;
+
+  if (!sdCard_->readStart(fatStartBlock_))
   {
-    if (!cacheFlush())
+    return false;
+  }
+
+  uint32_t cluster = 0;
+  uint32_t freeCount = 0;
+  cache_t* pc = &fatCache_[0];
+
+  while (cluster <= lastCluster)
+  {
+    if (!sdCard_->readData(pc->data))
     {
       return false;
     }
 
-    if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data))
+    if (fatType_ == 16)
     {
-      return false;
+      for (uint16_t i = 0; i < 256 && cluster <= lastCluster; i++, cluster++)
+      {
+        if (pc->fat16[i] == 0 && cluster >= 2)
+        {
+          freeBitmapSet(cluster, false);
+          freeCount++;
+        }
+      }
+    }
+    else
+    {
+      for (uint16_t i = 0; i < 128 && cluster <= lastCluster; i++, cluster++)
+      {
+        if ((pc->fat32[i] & FAT32MASK) == 0 && cluster >= 2)
+        {
+          freeBitmapSet(cluster, false);
+          freeCount++;
+        }
+      }
     }
+  }
 
-    cacheBlockNumber_ = blockNumber;
+  if (!sdCard_->readStop())
+  {
+    return false;
   }
 
-  cacheDirty_ |= action;
+  freeBitmapValid_ = true;
+
+  // exact count replaces any FSINFO hint
+  if (freeClusters_ != freeCount)
+  {
+    freeClusters_ = freeCount;
+    fsInfoDirty_ = true;
+  }
 
   return true;
 }
+#endif  // SD_FREE_BITMAP_BYTES
 //------------------------------------------------------------------------------
-// cache a zero block for blockNumber
-uint8_t RP2040_SdVolume::cacheZeroBlock(uint32_t blockNumber)
+// update the cached FSINFO sector if the free count or next free hint changed
+uint8_t RP2040_SdVolume::fsInfoSync()
 {
-  if (!cacheFlush())
+  // the hint moves without a known free count, so it is compared on its own
+  if (!fsInfoBlock_ || (!fsInfoDirty_ && fsInfoNextFree_ == allocSearchStart_))
   {
-    return false;
+    return true;
   }
 
-  // loop take less flash than memset(cacheBuffer_.data, 0, 512);
-  for (uint16_t i = 0; i < 512; i++)
+  if (!cacheRawBlock(fsInfoBlock_, CACHE_FOR_WRITE))
   {
-    cacheBuffer_.data[i] = 0;
+    return false;
   }
 
-  cacheBlockNumber_ = blockNumber;
-  cacheSetDirty();
+  fsinfo_t* fsi = &cacheAddress()->fsinfo;
+  fsi->freeCount = freeClusters_;
+  fsi->nextFree = allocSearchStart_;
+  fsInfoDirty_ = false;
+  fsInfoNextFree_ = allocSearchStart_;
 
   return true;
 }
 //------------------------------------------------------------------------------
-// return the size in bytes of a cluster chain
-uint8_t RP2040_SdVolume::chainSize(uint32_t cluster, uint32_t* size) const
+// count zero FAT16 entries in a block, two entries per word without branches
+static uint16_t fat16FreeCount(const uint32_t* p)
 {
-  uint32_t s = 0;
+  uint32_t n = 0;
 
-  do
+  for (uint8_t i = 0; i < 128; i++)
   {
-    if (!fatGet(cluster, &cluster))
-    {
-      return false;
-    }
+    uint32_t w = p[i];
 
-    s += 512UL << clusterSizeShift_;
-  } while (!isEOC(cluster));
+    // high bit of each 16-bit half is set if that half is zero
+    uint32_t z = ~(((w & 0X7FFF7FFF) + 0X7FFF7FFF) | w | 0X7FFF7FFF);
 
-  *size = s;
-  return true;
+    // each half of n counts at most 128 entries
+    n += (z >> 15) & 0X10001;
+  }
+
+  return (n & 0XFFFF) + (n >> 16);
 }
+//------------------------------------------------------------------------------
+// count zero FAT32 entries in a block without branches
+static uint16_t fat32FreeCount(const uint32_t* p)
+{
+  uint32_t n = 0;
+
+  for (uint8_t i = 0; i < 128; i++)
+  {
+    // borrow sets bit 31 only if the masked entry is zero
+    n += ((p[i] & FAT32MASK) - 1) >> 31;
+  }
 
+  return n;
+}
 //------------------------------------------------------------------------------
-// Fetch a FAT entry
-uint8_t RP2040_SdVolume::fatGet(uint32_t cluster, uint32_t* value) const
+/**
+   Count free clusters on the volume.
+
+   The count is kept up to date once known so only the first call after
+   mount may need to read the FAT.  A FAT32 FSINFO free count or the free
+   cluster bitmap also make the count known at mount.
+
+   \return The number of free clusters or -1 if an error occurs.
+*/
+int32_t RP2040_SdVolume::freeClusterCount()
 {
-  if (cluster > (clusterCount_ + 1))
+  if (freeClusters_ != 0XFFFFFFFF)
   {
-    return false;
+    return freeClusters_;
   }
 
-  uint32_t lba = fatStartBlock_;
-  lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+#if SD_EXFAT
 
-  if (lba != cacheBlockNumber_)
+  if (fatType_ == 64)
   {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ))
-    {
-      return false;
-    }
+    return exFatFreeClusterCount();
   }
 
-  if (fatType_ == 16)
+#endif  // SD_EXFAT
+
+  if (fatType_ != 16 && fatType_ != 32)
   {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    return -1;
   }
-  else
+
+  // use the FAT window as the read buffer
+  if (!fatCacheFlush())
   {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    return -1;
   }
 
-  return true;
-}
+  fatCacheCount_ = 0;
 
-//------------------------------------------------------------------------------
-// Store a FAT entry
-uint8_t RP2040_SdVolume::fatPut(uint32_t cluster, uint32_t value)
-{
-  // error if reserved cluster
-  if (cluster < 2)
+  uint32_t lastCluster = clusterCount_ + 1;
+  uint16_t shift = fatType_ == 16 ? 8 : 7;
+  uint32_t nb = (lastCluster >> shift) + 1;
+  uint32_t n = 0;
+  cache_t* pc = &fatCache_[0];
+
+  // stream the first FAT with one multiple block read
+  if (!sdCard_->readStart(fatStartBlock_))
   {
-    return false;
+    return -1;
   }
 
-  // error if not in FAT
-  if (cluster > (clusterCount_ + 1))
+  for (uint32_t b = 0; b < nb; b++)
   {
-    return false;
-  }
+    if (!sdCard_->readData(pc->data))
+    {
+      return -1;
+    }
 
-  // calculate block address for entry
-  uint32_t lba = fatStartBlock_;
-  lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+    n += fatType_ == 16 ? fat16FreeCount(pc->fat32) : fat32FreeCount(pc->fat32);
 
-  if (lba != cacheBlockNumber_)
-  {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ))
+    // entries zero and one are reserved
+    if (b == 0)
     {
-      return false;
+      for (uint8_t i = 0; i < 2; i++)
+      {
+        if ((fatType_ == 16 ? pc->fat16[i] : pc->fat32[i] & FAT32MASK) == 0)
+        {
+          n--;
+        }
+      }
     }
   }
 
-  // store entry
-  if (fatType_ == 16)
-  {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
-  }
-  else
+  if (!sdCard_->readStop())
   {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    return -1;
   }
 
-  cacheSetDirty();
-
-  // mirror second FAT
-  if (fatCount_ > 1)
+  // remove zero entries past the last cluster in the final block
+  for (uint32_t c = lastCluster + 1; c < (nb << shift); c++)
   {
-    cacheMirrorBlock_ = lba + blocksPerFat_;
+    if ((fatType_ == 16 ? pc->fat16[c & 0XFF] : pc->fat32[c & 0X7F] & FAT32MASK) == 0)
+    {
+      n--;
+    }
   }
 
-  return true;
+  freeClusters_ = n;
+  fsInfoDirty_ = true;
+
+  return n;
 }
 //------------------------------------------------------------------------------
 // free a cluster chain
 uint8_t RP2040_SdVolume::freeChain(uint32_t cluster)
 {
-  // clear free cluster location
-  allocSearchStart_ = 2;
+#if SD_EXFAT
+
+  if (fatType_ == 64)
+  {
+    return exFatFreeChain(cluster);
+  }
+
+#endif  // SD_EXFAT
 
   do
   {
@@ -346,6 +1652,12 @@ uint8_t RP2040_SdVolume::freeChain(uint32_t cluster)
       return false;
     }
 
+    // the next search starts at the lowest free cluster it may have skipped
+    if (cluster < allocSearchStart_)
+    {
+      allocSearchStart_ = cluster;
+    }
+
     // free cluster
     if (!fatPut(cluster, 0))
     {
@@ -358,26 +1670,69 @@ uint8_t RP2040_SdVolume::freeChain(uint32_t cluster)
   return true;
 }
 //------------------------------------------------------------------------------
+/**
+   Write all cached blocks, the FAT32 FSINFO sector and any deferred second
+   FAT blocks to the device.  Call before removing the card when
+   SD_FAT_MIRROR_MODE is 2.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t RP2040_SdVolume::sync()
+{
+  if (!fsInfoSync() || !cacheFlush())
+  {
+    return false;
+  }
+
+  return fatMirrorFlush();
+}
+//------------------------------------------------------------------------------
 /**
    Initialize a FAT volume.
 
-   \param[in] dev The SD card where the volume is located.
+   \param[in] dev The SD card or other block device where the volume is located.
 
    \param[in] part The partition to be used.  Legal values for \a part are
    1-4 to use the corresponding partition on a device formatted with
    a MBR, Master Boot Record, or zero if the device is formatted as
    a super floppy with the FAT boot sector in block zero.
 
+   \note init() writes nothing.  Changes to a volume mounted before that
+   are not yet written are discarded, so call sync() before mounting again.
+
    \return The value one, true, is returned for success and
    the value zero, false, is returned for failure.  Reasons for
    failure include not finding a valid partition, not finding a valid
    FAT file system in the specified partition or an I/O error.
 */
-uint8_t RP2040_SdVolume::init(Sd2Card* dev, uint8_t part)
+uint8_t RP2040_SdVolume::init(RP2040_BlockDevice* dev, uint8_t part)
 {
   uint32_t volumeStartBlock = 0;
+  uint16_t fsInfoSector = 0;
+
+  // drop every cached block and pending write without writing, the same
+  // device object may now hold a different card
+  cacheInvalidate(0, 0XFFFFFFFF);
+  fatCacheInvalidate();
+
   sdCard_ = dev;
 
+  // allocation hints and indexes describe the previous volume
+#if SD_FREE_BITMAP_BYTES
+  freeBitmapValid_ = false;
+#endif
+
+#if SD_DIR_INDEX_ENTRIES
+  dirIndexStart();
+  dirIndexFreeBlock_ = 0;
+#endif
+
+  allocSearchStart_ = 2;
+  freeClusters_ = 0XFFFFFFFF;
+  fsInfoBlock_ = 0;
+  fsInfoDirty_ = false;
+
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
   if (part)
@@ -392,7 +1747,7 @@ uint8_t RP2040_SdVolume::init(Sd2Card* dev, uint8_t part)
       return false;
     }
 
-    part_t* p = &cacheBuffer_.mbr.part[part - 1];
+    part_t* p = &cacheAddress()->mbr.part[part - 1];
 
     if ((p->boot & 0X7F) != 0 || p->totalSectors < 100 || p->firstSector == 0)
     {
@@ -408,7 +1763,16 @@ uint8_t RP2040_SdVolume::init(Sd2Card* dev, uint8_t part)
     return false;
   }
 
-  bpb_t* bpb = &cacheBuffer_.fbs.bpb;
+#if SD_EXFAT
+
+  if (!memcmp(cacheAddress()->exfbs.fileSystemName, "EXFAT   ", 8))
+  {
+    return exFatInit(volumeStartBlock);
+  }
+
+#endif  // SD_EXFAT
+
+  bpb_t* bpb = &cacheAddress()->fbs.bpb;
 
   if (bpb->bytesPerSector != 512 || bpb->fatCount == 0 || bpb->reservedSectorCount == 0 || bpb->sectorsPerCluster == 0)
   {
@@ -465,8 +1829,47 @@ uint8_t RP2040_SdVolume::init(Sd2Card* dev, uint8_t part)
   else
   {
     rootDirStart_ = bpb->fat32RootCluster;
+    fsInfoSector = bpb->fat32FSInfo;
     fatType_ = 32;
   }
 
+  // use FSINFO hints, bpb is not valid after the cacheRawBlock() call
+  if (fsInfoSector)
+  {
+    if (!cacheRawBlock(volumeStartBlock + fsInfoSector, CACHE_FOR_READ))
+    {
+      return false;
+    }
+
+    fsinfo_t* fsi = &cacheAddress()->fsinfo;
+
+    if (fsi->leadSignature == FSINFO_LEAD_SIG && fsi->structSignature == FSINFO_STRUCT_SIG)
+    {
+      fsInfoBlock_ = volumeStartBlock + fsInfoSector;
+
+      if (fsi->freeCount <= clusterCount_)
+      {
+        freeClusters_ = fsi->freeCount;
+      }
+
+      if (fsi->nextFree >= 2 && fsi->nextFree <= (clusterCount_ + 1))
+      {
+        allocSearchStart_ = fsi->nextFree;
+      }
+
+      // an invalid hint is left alone until the search start moves
+      fsInfoNextFree_ = allocSearchStart_;
+    }
+  }
+
+#if SD_FREE_BITMAP_BYTES
+
+  if (fatType_ != 12 && !freeBitmapBuild())
+  {
+    return false;
+  }
+
+#endif  // SD_FREE_BITMAP_BYTES
+
   return true;
 }